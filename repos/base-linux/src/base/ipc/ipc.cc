@@ -24,6 +24,7 @@
 #include <base/internal/native_thread.h>
 #include <base/internal/ipc_server.h>
 #include <base/internal/server_socket_pair.h>
+#include <base/internal/reply_channel.h>
 
 /* Linux includes */
 #include <linux_syscalls.h>
@@ -49,6 +50,15 @@ using namespace Genode;
  * replies). This data word is never fetched from memory but transferred via
  * the first short-IPC register. The 'protocol_word' is needed as a spacer
  * between the header fields define above and the regular message payload..
+ *
+ * The message payload is always transferred by value via the socket. Handing
+ * out a shared-memory message area per session instead would save the copy
+ * into the kernel but would allow the client to modify the arguments while
+ * the server is processing them. Servers, however, validate RPC arguments
+ * (e.g., the size and termination of 'Rpc_in_buffer' strings) before using
+ * them and must be able to rely on the validated content. Furthermore, the
+ * payload of a 'Msgbuf' is bounded by the RPC interface to a few KiB such
+ * that the copy is cheap compared to the system calls needed anyway.
  */
 struct Protocol_header
 {
@@ -320,6 +330,50 @@ static inline void lx_reply(int reply_socket, Rpc_exception_code exception_code,
 }
 
 
+/*******************
+ ** Reply channel **
+ *******************/
+
+void Genode::destroy_reply_channel(Reply_channel &channel)
+{
+	if (channel.local_sd  != -1) lx_close(channel.local_sd);
+	if (channel.remote_sd != -1) lx_close(channel.remote_sd);
+
+	channel = Reply_channel();
+}
+
+
+/**
+ * Return reply channel of the calling thread, create it on demand
+ */
+static Reply_channel &reply_channel_of_myself()
+{
+	/*
+	 * The main thread has no 'Thread_base' object. Because there exists only
+	 * one main thread, its reply channel can be kept in a static variable.
+	 */
+	static Reply_channel main_thread_reply_channel;
+
+	Thread_base * const myself = Thread_base::myself();
+
+	Reply_channel &channel = myself ? myself->native_thread().reply_channel
+	                                : main_thread_reply_channel;
+	if (channel.valid())
+		return channel;
+
+	int sd[2] = { -1, -1 };
+	int const ret = lx_socketpair(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0, sd);
+	if (ret < 0) {
+		PRAW("[%d] lx_socketpair failed with %d", lx_getpid(), ret);
+		throw Genode::Ipc_error();
+	}
+
+	channel.local_sd  = sd[0];
+	channel.remote_sd = sd[1];
+	return channel;
+}
+
+
 /****************
  ** IPC client **
  ****************/
@@ -335,41 +389,18 @@ Rpc_exception_code Genode::ipc_call(Native_capability dst,
 	                sizeof(Protocol_header) + snd_msgbuf.data_size());
 
 	/*
-	 * Create reply channel
+	 * Obtain reply channel
 	 *
-	 * The reply channel will be closed when leaving the scope of 'lx_call'.
+	 * The reply channel is created on the first call of the thread and
+	 * reused by all subsequent calls, which saves the creation and
+	 * destruction of a socket pair per RPC.
 	 */
-	struct Reply_channel
-	{
-		enum { LOCAL_SOCKET = 0, REMOTE_SOCKET = 1 };
-		int sd[2];
-
-		Reply_channel()
-		{
-			sd[LOCAL_SOCKET] = -1; sd[REMOTE_SOCKET] = -1;
-
-			int ret = lx_socketpair(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0, sd);
-			if (ret < 0) {
-				PRAW("[%d] lx_socketpair failed with %d", lx_getpid(), ret);
-				throw Genode::Ipc_error();
-			}
-		}
-
-		~Reply_channel()
-		{
-			if (sd[LOCAL_SOCKET]  != -1) lx_close(sd[LOCAL_SOCKET]);
-			if (sd[REMOTE_SOCKET] != -1) lx_close(sd[REMOTE_SOCKET]);
-		}
-
-		int local_socket()  const { return sd[LOCAL_SOCKET];  }
-		int remote_socket() const { return sd[REMOTE_SOCKET]; }
-
-	} reply_channel;
+	Reply_channel &reply_channel = reply_channel_of_myself();
 
 	/* assemble message */
 
 	/* marshal reply capability */
-	snd_msg.marshal_socket(reply_channel.remote_socket());
+	snd_msg.marshal_socket(reply_channel.remote_sd);
 
 	/* marshal capabilities contained in 'snd_msgbuf' */
 	insert_sds_into_message(snd_msg, snd_header, snd_msgbuf);
@@ -378,6 +409,7 @@ Rpc_exception_code Genode::ipc_call(Native_capability dst,
 	if (send_ret < 0) {
 		PRAW("[%d] lx_sendmsg to sd %d failed with %d in lx_call()",
 		     lx_getpid(), dst.dst().socket, send_ret);
+		destroy_reply_channel(reply_channel);
 		throw Genode::Ipc_error();
 	}
 
@@ -390,14 +422,24 @@ Rpc_exception_code Genode::ipc_call(Native_capability dst,
 	rcv_msg.accept_sockets(Message::MAX_SDS_PER_MSG);
 
 	rcv_msgbuf.reset();
-	int const recv_ret = lx_recvmsg(reply_channel.local_socket(), rcv_msg.msg(), 0);
+	int const recv_ret = lx_recvmsg(reply_channel.local_sd, rcv_msg.msg(), 0);
 
-	/* system call got interrupted by a signal */
-	if (recv_ret == -LX_EINTR)
+	/*
+	 * System call got interrupted by a signal
+	 *
+	 * The server may still deliver the reply of the canceled call later on.
+	 * To prevent the next call from picking up this stale reply, we drop the
+	 * reply channel. The server's attempt to reply via the closed channel
+	 * is ignored by 'lx_reply'.
+	 */
+	if (recv_ret == -LX_EINTR) {
+		destroy_reply_channel(reply_channel);
 		throw Genode::Blocking_canceled();
+	}
 
 	if (recv_ret < 0) {
 		PRAW("[%d] lx_recvmsg failed with %d in lx_call()", lx_getpid(), recv_ret);
+		destroy_reply_channel(reply_channel);
 		throw Genode::Ipc_error();
 	}
 
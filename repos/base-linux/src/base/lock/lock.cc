@@ -0,0 +1,87 @@
+/*
+ * \brief  Linux-specific lock implementation based on futexes
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-15
+ *
+ * In contrast to the generic implementation, the lock does not maintain a
+ * queue of applicants. The lock word itself is the futex, which blocked
+ * threads wait for. Acquiring a free lock and releasing a lock without
+ * waiters do not enter the kernel. The remaining members of
+ * 'Cancelable_lock' are unused.
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+/* Genode includes */
+#include <base/cancelable_lock.h>
+#include <cpu/atomic.h>
+
+/* Linux includes */
+#include <linux_syscalls.h>
+
+using namespace Genode;
+
+
+enum {
+	FUTEX_UNLOCKED  = 0,
+	FUTEX_LOCKED    = 1,  /* locked, no thread is blocked */
+	FUTEX_CONTENDED = 2,  /* locked, threads may be blocked */
+
+	LX_EINTR = 4,
+};
+
+
+/**
+ * Atomically replace value at 'dest' and return the previous value
+ */
+static inline int exchange(volatile int *dest, int new_val)
+{
+	for (;;) {
+		int const old_val = *dest;
+		if (cmpxchg(dest, old_val, new_val))
+			return old_val;
+	}
+}
+
+
+void Cancelable_lock::lock()
+{
+	if (cmpxchg(&_state, FUTEX_UNLOCKED, FUTEX_LOCKED))
+		return;
+
+	/*
+	 * Mark the lock as contended, which makes the next 'unlock' wake up a
+	 * blocked thread. If the lock got released meanwhile, we own it now.
+	 */
+	while (exchange(&_state, FUTEX_CONTENDED) != FUTEX_UNLOCKED) {
+
+		/*
+		 * The futex call returns immediately if the lock word changed
+		 * since the exchange above. An interruption by a signal reflects
+		 * the cancellation of the blocking via core.
+		 */
+		if (lx_futex((int *)&_state, LX_FUTEX_WAIT, FUTEX_CONTENDED) == -LX_EINTR)
+			throw Blocking_canceled();
+	}
+}
+
+
+void Cancelable_lock::unlock()
+{
+	if (exchange(&_state, FUTEX_UNLOCKED) == FUTEX_CONTENDED)
+		lx_futex((int *)&_state, LX_FUTEX_WAKE, 1);
+}
+
+
+Cancelable_lock::Cancelable_lock(Cancelable_lock::State initial)
+:
+	_spinlock_state(0),
+	_state(initial == LOCKED ? FUTEX_LOCKED : FUTEX_UNLOCKED),
+	_last_applicant(0),
+	_owner(0)
+{ }
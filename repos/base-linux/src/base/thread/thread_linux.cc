@@ -119,6 +119,9 @@ void Thread_base::_deinit_platform_thread()
 		lx_nanosleep(&ts, 0);
 	}
 
+	/* release the sockets used for receiving RPC replies */
+	destroy_reply_channel(native_thread().reply_channel);
+
 	/* inform core about the killed thread */
 	_cpu_session->kill_thread(_thread_cap);
 }
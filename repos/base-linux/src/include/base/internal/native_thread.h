@@ -16,6 +16,7 @@
 
 #include <base/stdint.h>
 #include <base/internal/server_socket_pair.h>
+#include <base/internal/reply_channel.h>
 
 namespace Genode { struct Native_thread; }
 
@@ -48,6 +49,11 @@ struct Genode::Native_thread
 
 	Socket_pair socket_pair;
 
+	/**
+	 * Socket pair used for receiving replies when acting as RPC client
+	 */
+	Reply_channel reply_channel;
+
 	Native_thread() { }
 };
 
@@ -0,0 +1,43 @@
+/*
+ * \brief  Per-thread socket pair used for receiving RPC replies
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-12
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+#ifndef _INCLUDE__BASE__INTERNAL__REPLY_CHANNEL_H_
+#define _INCLUDE__BASE__INTERNAL__REPLY_CHANNEL_H_
+
+namespace Genode {
+
+	/*
+	 * The local socket is used by the client thread to receive replies. The
+	 * remote socket is handed out to the server as reply capability along
+	 * with each call. Both sockets are created lazily on the first RPC call
+	 * of a thread and kept for the lifetime of the thread.
+	 */
+	struct Reply_channel
+	{
+		int local_sd  = -1;
+		int remote_sd = -1;
+
+		bool valid() const { return local_sd != -1; }
+	};
+
+	/*
+	 * Helper to close the sockets of a reply channel
+	 *
+	 * The function is called when a thread vanishes or when the reply channel
+	 * may contain a stale reply, e.g., after a canceled RPC call. In the
+	 * latter case, the next call transparently creates a fresh channel.
+	 */
+	void destroy_reply_channel(Reply_channel &);
+}
+
+#endif /* _INCLUDE__BASE__INTERNAL__REPLY_CHANNEL_H_ */
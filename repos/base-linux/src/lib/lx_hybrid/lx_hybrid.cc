@@ -5,7 +5,7 @@
  */
 
 /*
- * Copyright (C) 2011-2013 Genode Labs GmbH
+ * Copyright (C) 2011-2016 Genode Labs GmbH
  *
  * This file is part of the Genode OS framework, which is distributed
  * under the terms of the GNU General Public License version 2.
@@ -152,6 +152,9 @@ int main()
 using namespace Genode;
 
 
+static void adopted_thread_exit(void *tls);
+
+
 /**
  * Return TLS key used to storing the thread meta data
  */
@@ -163,7 +166,7 @@ static pthread_key_t tls_key()
 
 		Tls_key()
 		{
-			pthread_key_create(&key, 0);
+			pthread_key_create(&key, adopted_thread_exit);
 		}
 	};
 
@@ -336,6 +339,32 @@ namespace Genode {
 }
 
 
+extern "C" void free(void *ptr);
+
+
+/**
+ * Release the resources of an adopted thread when it exits
+ *
+ * Called by the pthread library for each exiting thread with a TLS entry.
+ * The meta data of threads created via the 'Thread_base' constructor is
+ * released by the 'Thread_base' destructor instead.
+ */
+static void adopted_thread_exit(void *tls)
+{
+	Thread_meta_data_adopted *meta_data =
+		dynamic_cast<Thread_meta_data_adopted *>((Native_thread::Meta_data *)tls);
+
+	if (!meta_data)
+		return;
+
+	destroy_reply_channel(meta_data->native_thread.reply_channel);
+
+	Thread_base *thread = meta_data->thread_base;
+	delete meta_data;
+	free(thread);
+}
+
+
 static void adopt_thread(Native_thread::Meta_data *meta_data)
 {
 	lx_sigaltstack(signal_stack, sizeof(signal_stack));
@@ -413,10 +442,8 @@ Thread_base *Thread_base::myself()
 	 * Create dummy 'Thread_base' object but suppress the execution of its
 	 * constructor. If we called the constructor, we would create a new Genode
 	 * thread, which is not what we want. For the allocation, we use glibc
-	 * malloc because 'Genode::env()->heap()->alloc()' uses IPC.
-	 *
-	 * XXX  Both the 'Thread_base' and 'Native_thread::Meta_data' objects are
-	 *      never freed.
+	 * malloc because 'Genode::env()->heap()->alloc()' uses IPC. Both objects
+	 * are freed by 'adopted_thread_exit' when the thread exits.
 	 */
 	Thread_base *thread = (Thread_base *)malloc(sizeof(Thread_base));
 	memset(thread, 0, sizeof(*thread));
@@ -500,6 +527,9 @@ Thread_base::~Thread_base()
 			     ret, errno);
 	}
 
+	/* release the sockets used for receiving RPC replies */
+	destroy_reply_channel(native_thread().reply_channel);
+
 	Thread_meta_data_created *meta_data =
 		dynamic_cast<Thread_meta_data_created *>(native_thread().meta_data);
 
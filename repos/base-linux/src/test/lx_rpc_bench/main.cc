@@ -0,0 +1,157 @@
+/*
+ * \brief  Benchmark for measuring the RPC throughput on Linux
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-12
+ *
+ * The benchmark performs RPC calls to a local entrypoint for a fixed amount
+ * of time and reports the number of calls per second. It is meant to be
+ * executed before and after changes of the socket-based IPC implementation
+ * to quantify their effect.
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+/* Genode includes */
+#include <base/printf.h>
+#include <base/thread.h>
+#include <base/env.h>
+#include <base/rpc_server.h>
+#include <base/rpc_client.h>
+#include <cap_session/connection.h>
+#include <timer_session/connection.h>
+
+namespace Test {
+
+	struct Session;
+	struct Client;
+	struct Component;
+	struct Client_thread;
+}
+
+
+/**
+ * Test session interface definition
+ */
+struct Test::Session : Genode::Session
+{
+	static const char *service_name() { return "LX_RPC_BENCH"; }
+
+	typedef Genode::Rpc_in_buffer<1024> Payload;
+
+	GENODE_RPC(Rpc_null, void, null);
+	GENODE_RPC(Rpc_payload, Genode::size_t, payload, Payload const &);
+	GENODE_RPC_INTERFACE(Rpc_null, Rpc_payload);
+};
+
+
+struct Test::Client : Genode::Rpc_client<Session>
+{
+	Client(Genode::Capability<Session> cap) : Rpc_client<Session>(cap) { }
+
+	void null() { call<Rpc_null>(); }
+
+	Genode::size_t payload(Payload const &payload) {
+		return call<Rpc_payload>(payload); }
+};
+
+
+struct Test::Component : Genode::Rpc_object<Session, Component>
+{
+	void null() { }
+
+	Genode::size_t payload(Payload const &payload) { return payload.size(); }
+};
+
+
+/* duration of each individual measurement in milliseconds */
+enum { DURATION_MS = 2000 };
+
+
+static Timer::Session &timer()
+{
+	static Timer::Connection inst;
+	return inst;
+}
+
+
+/**
+ * Perform calls for 'DURATION_MS' and return the number of calls per second
+ */
+template <typename FUNC>
+static unsigned long measure(FUNC const &func)
+{
+	unsigned long const start_ms = timer().elapsed_ms();
+	unsigned long       calls    = 0;
+	unsigned long       now_ms   = start_ms;
+
+	/* query the timer only once per batch of calls to limit its overhead */
+	enum { BATCH = 1000 };
+
+	for (; now_ms - start_ms < DURATION_MS; now_ms = timer().elapsed_ms()) {
+		for (unsigned i = 0; i < BATCH; i++)
+			func();
+		calls += BATCH;
+	}
+
+	return (calls*1000)/(now_ms - start_ms);
+}
+
+
+static void run_benchmarks(Test::Client &client, char const *who)
+{
+	using namespace Genode;
+
+	printf("%s: null RPC:           %lu calls/s\n", who,
+	       measure([&] () { client.null(); }));
+
+	static char buf[Test::Session::Payload::MAX_SIZE];
+	memset(buf, 'x', sizeof(buf));
+	Test::Session::Payload const payload(buf, sizeof(buf));
+
+	printf("%s: RPC with 1K payload: %lu calls/s\n", who,
+	       measure([&] () { client.payload(payload); }));
+}
+
+
+struct Test::Client_thread : Genode::Thread<8*1024*sizeof(long)>
+{
+	Client &client;
+
+	Client_thread(Client &client)
+	: Genode::Thread<8*1024*sizeof(long)>("client"), client(client) { }
+
+	void entry() { run_benchmarks(client, "secondary thread"); }
+};
+
+
+int main(int argc, char **argv)
+{
+	using namespace Genode;
+
+	printf("--- test-lx_rpc_bench started ---\n");
+
+	enum { STACK_SIZE = 8*1024*sizeof(long) };
+
+	static Cap_connection cap;
+	static Rpc_entrypoint ep(&cap, STACK_SIZE, "rpc_bench_ep");
+
+	static Test::Component component;
+	static Test::Client    client(ep.manage(&component));
+
+	/* the main thread has no 'Thread_base' object and is measured separately */
+	run_benchmarks(client, "main thread");
+
+	static Test::Client_thread thread(client);
+	thread.start();
+	thread.join();
+
+	ep.dissolve(&component);
+
+	printf("--- test-lx_rpc_bench finished ---\n");
+	return 0;
+}
@@ -0,0 +1,3 @@
+TARGET = test-lx_rpc_bench
+SRC_CC = main.cc
+LIBS   = base
@@ -0,0 +1,369 @@
+/*
+ * \brief  Allocator with per-thread caches of small blocks
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-14
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+#ifndef _INCLUDE__BASE__MAGAZINE_ALLOCATOR_H_
+#define _INCLUDE__BASE__MAGAZINE_ALLOCATOR_H_
+
+#include <base/allocator.h>
+#include <base/lock.h>
+#include <base/thread.h>
+#include <cpu/memory_barrier.h>
+#include <util/construct_at.h>
+
+namespace Genode { class Magazine_allocator; }
+
+
+/**
+ * Allocator that caches free blocks per thread
+ *
+ * Small blocks are grouped into size classes. Each thread owns a magazine
+ * of free blocks per size class, which serves allocations and takes
+ * deallocations without acquiring any lock. Only if a magazine runs empty
+ * or full, a batch of blocks is exchanged with a depot shared by all
+ * threads, or with the backing store. Large blocks are allocated at the
+ * backing store directly.
+ *
+ * The backing store must be thread safe, e.g., a 'Heap'. A thread that
+ * finishes its work with the allocator should call 'release_thread_cache'
+ * to hand its cached blocks back. Threads without 'Thread_base' object,
+ * e.g., the main thread, and threads exceeding 'MAX_THREADS' use the depot
+ * directly.
+ */
+class Genode::Magazine_allocator : public Allocator
+{
+	public:
+
+		enum {
+			NUM_CLASSES   = 13,
+			MAGAZINE_SIZE = 32,                /* blocks per thread and class */
+			BATCH         = MAGAZINE_SIZE / 2, /* blocks exchanged at once    */
+			DEPOT_LIMIT   = 8*MAGAZINE_SIZE,   /* blocks kept in the depot    */
+			MAX_THREADS   = 32,
+		};
+
+	private:
+
+		/**
+		 * Meta data in front of each block
+		 */
+		struct Header { size_t size; };
+
+		/**
+		 * Free block as linked in the depot
+		 */
+		struct Free_block : Header { Free_block *next; };
+
+		struct Magazine
+		{
+			unsigned count = 0;
+			Header  *blocks[MAGAZINE_SIZE];
+		};
+
+		struct Thread_cache { Magazine magazines[NUM_CLASSES]; };
+
+		struct Depot
+		{
+			Lock        lock;
+			Free_block *first = nullptr;
+			unsigned    count = 0;
+		};
+
+		enum Slot_state { UNUSED, USED, RELEASED };
+
+		Allocator &_backing_store;
+
+		Depot _depots[NUM_CLASSES];
+
+		/*
+		 * Slots of thread caches, found via open addressing by the
+		 * 'Thread_base' pointer of the owner. Slots are assigned with
+		 * '_slot_lock' held and looked up without lock.
+		 */
+		Lock                 _slot_lock;
+		Thread_base *        _owners[MAX_THREADS];
+		Thread_cache *       _caches[MAX_THREADS];
+		Slot_state volatile  _states[MAX_THREADS];
+
+		/**
+		 * Return block size of size class
+		 */
+		static size_t _class_size(unsigned c)
+		{
+			static size_t const sizes[NUM_CLASSES] = {
+				32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048 };
+			return sizes[c];
+		}
+
+		/**
+		 * Return size class for block size, or NUM_CLASSES for large blocks
+		 */
+		static unsigned _class(size_t size)
+		{
+			unsigned c = 0;
+			while (c < NUM_CLASSES && _class_size(c) < size)
+				c++;
+			return c;
+		}
+
+		static unsigned _hash(Thread_base const *t) {
+			return ((addr_t)t / sizeof(addr_t)) % MAX_THREADS; }
+
+		/**
+		 * Return cache of calling thread, or nullptr if none is available
+		 */
+		Thread_cache *_thread_cache()
+		{
+			Thread_base * const myself = Thread_base::myself();
+			if (!myself)
+				return nullptr;
+
+			unsigned const start = _hash(myself);
+			for (unsigned i = start, n = 0; n < MAX_THREADS;
+			     i = (i + 1) % MAX_THREADS, n++) {
+
+				if (_states[i] == UNUSED)
+					break;
+
+				if (_states[i] == USED) {
+					memory_barrier();
+					if (_owners[i] == myself)
+						return _caches[i];
+				}
+			}
+
+			return _assign_thread_cache(myself);
+		}
+
+		/**
+		 * Assign slot to calling thread
+		 */
+		Thread_cache *_assign_thread_cache(Thread_base *myself)
+		{
+			Lock::Guard guard(_slot_lock);
+
+			unsigned const start = _hash(myself);
+			for (unsigned i = start, n = 0; n < MAX_THREADS;
+			     i = (i + 1) % MAX_THREADS, n++) {
+
+				if (_states[i] == USED)
+					continue;
+
+				/* reuse memory of released cache */
+				if (!_caches[i]) {
+					void *cache = nullptr;
+					if (!_backing_store.alloc(sizeof(Thread_cache), &cache))
+						return nullptr;
+					_caches[i] = construct_at<Thread_cache>(cache);
+				}
+
+				_owners[i] = myself;
+				memory_barrier();
+				_states[i] = USED;
+				return _caches[i];
+			}
+			return nullptr;
+		}
+
+		/**
+		 * Allocate block from the backing store
+		 */
+		Header *_backing_alloc(size_t size)
+		{
+			void *block = nullptr;
+			if (!_backing_store.alloc(size, &block))
+				return nullptr;
+
+			Header *h = (Header *)block;
+			h->size = size;
+			return h;
+		}
+
+		/**
+		 * Move up to 'count' blocks of the depot to the magazine
+		 *
+		 * Blocks missing in the depot are allocated at the backing store.
+		 */
+		void _refill(unsigned c, Magazine &m, unsigned count)
+		{
+			Depot &d = _depots[c];
+			{
+				Lock::Guard guard(d.lock);
+				for (; m.count < count && d.first; d.count--) {
+					m.blocks[m.count++] = d.first;
+					d.first = d.first->next;
+				}
+			}
+
+			for (Header *h; m.count < count &&
+			                (h = _backing_alloc(_class_size(c))); )
+				m.blocks[m.count++] = h;
+		}
+
+		/**
+		 * Move 'count' blocks of the magazine to the depot
+		 *
+		 * Blocks exceeding the depot limit are freed at the backing store.
+		 */
+		void _flush(unsigned c, Magazine &m, unsigned count)
+		{
+			Depot &d = _depots[c];
+			Free_block *excess = nullptr;
+			{
+				Lock::Guard guard(d.lock);
+				for (; count && m.count; count--) {
+					Free_block *b = static_cast<Free_block *>(m.blocks[--m.count]);
+					if (d.count < DEPOT_LIMIT) {
+						b->next = d.first, d.first = b, d.count++;
+					} else {
+						b->next = excess, excess = b;
+					}
+				}
+			}
+
+			while (Free_block *b = excess) {
+				excess = b->next;
+				_backing_store.free(b, b->size);
+			}
+		}
+
+	public:
+
+		/**
+		 * Constructor
+		 *
+		 * \param backing_store  thread-safe allocator used for blocks
+		 *                       and meta data
+		 */
+		Magazine_allocator(Allocator &backing_store)
+		: _backing_store(backing_store)
+		{
+			for (unsigned i = 0; i < MAX_THREADS; i++) {
+				_owners[i] = nullptr;
+				_caches[i] = nullptr;
+				_states[i] = UNUSED;
+			}
+		}
+
+		~Magazine_allocator()
+		{
+			for (unsigned i = 0; i < MAX_THREADS; i++) {
+				if (!_caches[i])
+					continue;
+
+				for (unsigned c = 0; c < NUM_CLASSES; c++) {
+					Magazine &m = _caches[i]->magazines[c];
+					while (m.count)
+						_backing_store.free(m.blocks[--m.count],
+						                    _class_size(c));
+				}
+				_backing_store.free(_caches[i], sizeof(Thread_cache));
+			}
+
+			for (unsigned c = 0; c < NUM_CLASSES; c++)
+				while (Free_block *b = _depots[c].first) {
+					_depots[c].first = b->next;
+					_backing_store.free(b, b->size);
+				}
+		}
+
+		/**
+		 * Hand the blocks cached by the calling thread back to the depot
+		 */
+		void release_thread_cache()
+		{
+			Thread_base * const myself = Thread_base::myself();
+
+			Lock::Guard guard(_slot_lock);
+
+			for (unsigned i = 0; i < MAX_THREADS; i++) {
+				if (_states[i] != USED || _owners[i] != myself)
+					continue;
+
+				for (unsigned c = 0; c < NUM_CLASSES; c++) {
+					Magazine &m = _caches[i]->magazines[c];
+					_flush(c, m, m.count);
+				}
+
+				_states[i] = RELEASED;
+				return;
+			}
+		}
+
+
+		/*************************
+		 ** Allocator interface **
+		 *************************/
+
+		bool alloc(size_t size, void **out_addr) override
+		{
+			size_t   const total = size + sizeof(Header);
+			unsigned const c     = _class(total);
+
+			Header *h = nullptr;
+
+			if (c == NUM_CLASSES) {
+				h = _backing_alloc(total);
+
+			} else if (Thread_cache *cache = _thread_cache()) {
+				Magazine &m = cache->magazines[c];
+				if (!m.count)
+					_refill(c, m, BATCH);
+				if (m.count)
+					h = m.blocks[--m.count];
+
+			} else {
+				Magazine m;
+				_refill(c, m, 1);
+				if (m.count)
+					h = m.blocks[0];
+			}
+
+			if (!h)
+				return false;
+
+			*out_addr = h + 1;
+			return true;
+		}
+
+		void free(void *addr, size_t) override
+		{
+			Header * const h = (Header *)addr - 1;
+			unsigned const c = _class(h->size);
+
+			if (c == NUM_CLASSES) {
+				_backing_store.free(h, h->size);
+				return;
+			}
+
+			if (Thread_cache *cache = _thread_cache()) {
+				Magazine &m = cache->magazines[c];
+				if (m.count == MAGAZINE_SIZE)
+					_flush(c, m, BATCH);
+				m.blocks[m.count++] = h;
+				return;
+			}
+
+			Magazine m;
+			m.blocks[m.count++] = h;
+			_flush(c, m, 1);
+		}
+
+		size_t consumed() const override { return _backing_store.consumed(); }
+
+		size_t overhead(size_t size) const override {
+			return sizeof(Header) + _backing_store.overhead(size); }
+
+		bool need_size_for_free() const override { return false; }
+};
+
+#endif /* _INCLUDE__BASE__MAGAZINE_ALLOCATOR_H_ */
@@ -5,7 +5,7 @@
  */
 
 /*
- * Copyright (C) 2013 Genode Labs GmbH
+ * Copyright (C) 2013-2016 Genode Labs GmbH
  *
  * This file is part of the Genode OS framework, which is distributed
  * under the terms of the GNU General Public License version 2.
@@ -17,12 +17,16 @@
 #include <base/stdint.h>
 #include <base/thread.h>
 #include <cpu_session/cpu_session.h>
+#include <cpu/memory_barrier.h>
 
 namespace Genode { namespace Trace { class Buffer; } }
 
 
 /**
  * Buffer shared between CPU client thread and TRACE client
+ *
+ * Both parties synchronize via the header fields only. Memory barriers
+ * order the accesses to the header with respect to the entry data.
  */
 class Genode::Trace::Buffer
 {
@@ -32,10 +36,18 @@ class Genode::Trace::Buffer
 		unsigned volatile _size;         /* in bytes */
 		unsigned volatile _wrapped;      /* count of buffer wraps */
 
+		/*
+		 * End of the bytes reserved by the CPU client in the current round,
+		 * which never decreases within the round. The CPU client publishes
+		 * a reservation before writing to it so that a 'Reader' can tell
+		 * whether an entry that is not yet committed overlaps its position.
+		 */
+		unsigned volatile _reserved_end;
+
 		struct _Entry
 		{
-			size_t len;
-			char   data[0];
+			size_t volatile len;
+			char            data[0];
 		};
 
 		_Entry _entries[0];
@@ -44,8 +56,22 @@ class Genode::Trace::Buffer
 
 		void _buffer_wrapped()
 		{
+			/* entries of the finished round precede the wrap */
+			Genode::memory_barrier();
+
 			_head_offset = 0;
+			Genode::memory_barrier();
 			_wrapped++;
+			_reserved_end = 0;
+		}
+
+		void _reserve(size_t len)
+		{
+			size_t const end = _head_offset + sizeof(_Entry) + len;
+			size_t const max = end < _size ? end : _size;
+
+			if (max > _reserved_end)
+				_reserved_end = max;
 		}
 
 		/*
@@ -69,10 +95,18 @@ class Genode::Trace::Buffer
 			_size = size - header_size;
 
 			_wrapped = 0;
+
+			_reserved_end = 0;
 		}
 
 		char *reserve(size_t len)
 		{
+			/* also covers the end-of-round mark written below */
+			_reserve(len);
+
+			/* publish the reservation before writing to it */
+			Genode::memory_barrier();
+
 			if (_head_offset + sizeof(_Entry) + len <= _size)
 				return _head_entry()->data;
 
@@ -81,6 +115,8 @@ class Genode::Trace::Buffer
 				_head_entry()->len = 0;
 
 			_buffer_wrapped();
+			_reserve(len);
+			Genode::memory_barrier();
 
 			return _head_entry()->data;
 		}
@@ -91,7 +127,14 @@ class Genode::Trace::Buffer
 			if (len == 0)
 				return;
 
+			/*
+			 * The data is written before the length, and the length before
+			 * the head offset advances, so a 'Reader' never sees an entry
+			 * without its length or content.
+			 */
+			Genode::memory_barrier();
 			_head_entry()->len = len;
+			Genode::memory_barrier();
 
 			/* advance head offset, wrap when reaching buffer boundary */
 			_head_offset += sizeof(_Entry) + len;
@@ -123,6 +166,8 @@ class Genode::Trace::Buffer
 				bool        is_last() const { return _entry == 0; }
 		};
 
+		class Reader;
+
 		Entry first() const
 		{
 			return _entries->len ? Entry(_entries) : Entry(0);
@@ -144,4 +189,173 @@ class Genode::Trace::Buffer
 		}
 };
 
+
+/**
+ * Reader that follows the buffer while the CPU client keeps writing
+ *
+ * In contrast to iterating from 'Buffer::first', the reader hands out only
+ * the entries written since its previous call. The CPU client never waits
+ * for the reader. If it overwrites entries before the reader got to them,
+ * the reader detects the loss by comparing the number of buffer wraps and
+ * the extent of the CPU client's writes with its own position. This extent
+ * includes the entry that the CPU client reserved but did not commit yet.
+ */
+class Genode::Trace::Buffer::Reader
+{
+	private:
+
+		Buffer const &_buffer;
+
+		unsigned      _wrapped = 0;  /* buffer wraps at the read offset */
+		unsigned      _offset  = 0;  /* in bytes, relative to 'entries' */
+		unsigned long _lost    = 0;  /* number of detected losses      */
+
+		/**
+		 * Obtain write position of the CPU client
+		 */
+		void _head(unsigned &wrapped, unsigned &offset) const
+		{
+			do {
+				wrapped = _buffer._wrapped;
+				Genode::memory_barrier();
+				offset  = _buffer._head_offset;
+				Genode::memory_barrier();
+			} while (wrapped != _buffer._wrapped);
+
+			/*
+			 * The CPU client resets the offset before it increments the
+			 * wrap count. An offset behind the read position thereby
+			 * denotes the end of the current round.
+			 */
+			if (wrapped == _wrapped && offset < _offset)
+				wrapped++, offset = 0;
+		}
+
+		/**
+		 * Return true if the CPU client overwrote data at the given position
+		 */
+		bool _overwritten(unsigned wrapped, unsigned offset) const
+		{
+			/* data read before must not be read after the check */
+			Genode::memory_barrier();
+
+			unsigned head_wrapped = 0, head_offset = 0, reserved_end = 0;
+			do {
+				head_wrapped = _buffer._wrapped;
+				Genode::memory_barrier();
+				head_offset  = _buffer._head_offset;
+				reserved_end = _buffer._reserved_end;
+				Genode::memory_barrier();
+			} while (head_wrapped != _buffer._wrapped);
+
+			/*
+			 * Within the round of the read position, the CPU client writes
+			 * only behind the committed entries, which the reader never
+			 * passes.
+			 */
+			if (head_wrapped == wrapped)
+				return false;
+
+			unsigned const end = reserved_end > head_offset ? reserved_end
+			                                                : head_offset;
+
+			return head_wrapped != wrapped + 1 || end > offset;
+		}
+
+		/**
+		 * Apply 'fn' to the entries from the read offset up to 'limit'
+		 *
+		 * \param limit  end of the entries, or the buffer size for the end
+		 *               of the current round
+		 * \return       false if the entries are inconsistent
+		 */
+		template <typename FN>
+		bool _read(size_t limit, FN const &fn)
+		{
+			size_t const size   = _buffer._size;
+			bool   const to_end = (limit == size);
+
+			while (_offset < limit) {
+
+				if (_offset + sizeof(_Entry) > size)
+					return to_end;
+
+				_Entry const *e = (_Entry const *)((addr_t)_buffer._entries + _offset);
+				size_t const len = e->len;
+
+				/* entry of length 0 marks the end of the round */
+				if (len == 0)
+					return to_end;
+
+				if (_offset + sizeof(_Entry) + len > size)
+					return false;
+
+				fn(Entry(e));
+
+				_offset += sizeof(_Entry) + len;
+			}
+			return true;
+		}
+
+	public:
+
+		Reader(Buffer const &buffer) : _buffer(buffer) { }
+
+		/**
+		 * Apply 'fn' to each entry written since the previous call
+		 *
+		 * The functor is called with a 'Buffer::Entry' as argument.
+		 *
+		 * \return  false if the CPU client overwrote entries while they
+		 *          were passed to 'fn', in which case the caller must
+		 *          discard the data obtained during this call
+		 *
+		 * Entries overwritten before this call are skipped. Either way,
+		 * the loss is reflected by 'lost'.
+		 */
+		template <typename FN>
+		bool for_each_new_entry(FN const &fn)
+		{
+			unsigned head_wrapped = 0, head_offset = 0;
+			_head(head_wrapped, head_offset);
+
+			/* skip entries that were overwritten already */
+			if (_overwritten(_wrapped, _offset)) {
+				_lost++;
+				_wrapped = head_wrapped;
+				_offset  = 0;
+			}
+
+			unsigned const start_wrapped = _wrapped;
+			unsigned const start_offset  = _offset;
+
+			bool consistent = true;
+
+			/* finish the current round */
+			if (head_wrapped != _wrapped) {
+				consistent = _read(_buffer._size, fn);
+				_wrapped++;
+				_offset = 0;
+			}
+
+			if (consistent)
+				consistent = _read(head_offset, fn);
+
+			if (consistent && !_overwritten(start_wrapped, start_offset))
+				return true;
+
+			/* resume at the write position */
+			_lost++;
+			_head(head_wrapped, head_offset);
+			_wrapped = head_wrapped;
+			_offset  = head_offset;
+			return false;
+		}
+
+		/**
+		 * Return number of detected losses of entries
+		 */
+		unsigned long lost() const { return _lost; }
+};
+
 #endif /* _INCLUDE__BASE__TRACE__BUFFER_H_ */
@@ -0,0 +1,441 @@
+/*
+ * \brief  Index of the structure of an XML node
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-21
+ *
+ * 'Xml_node' re-tokenizes the XML data on each access to a sub node or an
+ * attribute. Walking all sub nodes via 'sub_node(i)' is thereby quadratic
+ * in the number of sub nodes. The index scans the XML data once and records
+ * the nodes, their sub nodes, and their attributes. Accessing the Nth sub
+ * node or attribute of an indexed node takes constant time.
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+#ifndef _INCLUDE__UTIL__XML_INDEX_H_
+#define _INCLUDE__UTIL__XML_INDEX_H_
+
+#include <util/xml_node.h>
+#include <util/noncopyable.h>
+#include <base/allocator.h>
+
+namespace Genode { class Xml_index; }
+
+
+/**
+ * Index of an XML node and all its sub nodes
+ *
+ * The index refers to the XML data of the node, which must stay unchanged
+ * while the index is in use. The memory of the index is obtained from the
+ * allocator passed to the constructor. Any allocator can be used, e.g., an
+ * 'Allocator_avl' managing a buffer embedded in the user of the index.
+ */
+class Genode::Xml_index : Noncopyable
+{
+	private:
+
+		typedef Xml_node::Token Token;
+		typedef Xml_node::Tag   Tag;
+
+		enum { INVALID = ~0U };
+
+		struct Entry
+		{
+			size_t   start;          /* start tag relative to '_base'  */
+			size_t   end;            /* end tag, equals 'start' for
+			                            empty-element nodes            */
+			unsigned name_len;       /* name follows the '<' directly  */
+			unsigned parent;
+			unsigned num_sub_nodes;
+			unsigned sub_nodes;      /* first slot in '_sub_nodes'     */
+			unsigned attributes;     /* first slot in '_attributes'    */
+			unsigned num_attributes;
+		};
+
+		struct Attribute_entry
+		{
+			size_t   name;           /* relative to '_base' */
+			unsigned name_len;
+		};
+
+		Allocator  &_alloc;
+		char const *_base;
+		size_t      _max_len;
+
+		Entry           *_nodes          = nullptr;
+		unsigned         _num_nodes      = 0;
+		unsigned         _nodes_capacity = 0;
+		unsigned        *_sub_nodes      = nullptr;
+		Attribute_entry *_attributes     = nullptr;
+		unsigned         _num_attributes = 0;
+		unsigned         _attributes_capacity = 0;
+
+		size_t _offset(char const *addr) const { return addr - _base; }
+
+		Token _token(size_t offset) const {
+			return Token(_base + offset, _max_len - offset); }
+
+		template <typename T>
+		void _grow(T *&array, unsigned &capacity, unsigned used)
+		{
+			unsigned const new_capacity = capacity ? 2*capacity : 64;
+
+			T *new_array = (T *)_alloc.alloc(new_capacity*sizeof(T));
+			if (array) {
+				memcpy(new_array, array, used*sizeof(T));
+				_alloc.free(array, capacity*sizeof(T));
+			}
+			array    = new_array;
+			capacity = new_capacity;
+		}
+
+		void _free()
+		{
+			if (_nodes)
+				_alloc.free(_nodes, _nodes_capacity*sizeof(Entry));
+			if (_sub_nodes)
+				_alloc.free(_sub_nodes, _num_nodes*sizeof(unsigned));
+			if (_attributes)
+				_alloc.free(_attributes, _attributes_capacity*sizeof(Attribute_entry));
+		}
+
+		static bool _equal(char const *s, size_t len, char const *str) {
+			return strlen(str) == len && !strcmp(str, s, len); }
+
+		bool _has_name(unsigned id, Token name) const
+		{
+			Entry const &e = _nodes[id];
+			return e.name_len == name.len()
+			    && !strcmp(_base + e.start + 1, name.start(), e.name_len);
+		}
+
+		unsigned _add_node(Tag const &tag, unsigned parent)
+		{
+			if (_num_nodes == _nodes_capacity)
+				_grow(_nodes, _nodes_capacity, _num_nodes);
+
+			unsigned const id = _num_nodes++;
+
+			if (parent != INVALID)
+				_nodes[parent].num_sub_nodes++;
+
+			unsigned const first_attribute = _num_attributes;
+
+			/* record the attributes of the start tag */
+			for (Token t = tag.name().next(); ; ) {
+
+				t = t.eat_whitespace();
+				if (t.type() != Token::IDENT)
+					break;
+
+				Xml_attribute const attribute(t);
+
+				if (_num_attributes == _attributes_capacity)
+					_grow(_attributes, _attributes_capacity, _num_attributes);
+
+				_attributes[_num_attributes++] = {
+					_offset(attribute._name.start()),
+					(unsigned)attribute._name.len() };
+
+				t = attribute._next();
+			}
+
+			size_t const start = _offset(tag.token().start());
+
+			_nodes[id] = { start, start, (unsigned)tag.name().len(), parent,
+			               0, 0, first_attribute,
+			               _num_attributes - first_attribute };
+			return id;
+		}
+
+		/**
+		 * Scan XML data of the node
+		 *
+		 * \throw Xml_node::Invalid_syntax
+		 */
+		void _build(Xml_node const &node)
+		{
+			unsigned curr     = INVALID; /* innermost open node */
+			bool     complete = false;
+
+			Token t = node._start_tag.token();
+			while (!complete && t.type() != Token::END) {
+
+				/* eat XML comment */
+				Xml_node::Comment comment(t);
+				if (comment.valid()) {
+					t = comment.next_token();
+					continue;
+				}
+
+				/* skip all tokens that are no tags */
+				Tag tag(t);
+				if (tag.type() == Tag::INVALID) {
+					t = t.next();
+					continue;
+				}
+
+				if (tag.is_node()) {
+					unsigned const id = _add_node(tag, curr);
+
+					if (tag.type() == Tag::START)
+						curr = id;
+					else
+						complete = (curr == INVALID);
+
+				} else {
+
+					if (curr == INVALID || !_has_name(curr, tag.name()))
+						throw Xml_node::Invalid_syntax();
+
+					_nodes[curr].end = _offset(tag.token().start());
+
+					curr     = _nodes[curr].parent;
+					complete = (curr == INVALID);
+				}
+
+				t = tag.next_token();
+			}
+
+			if (!complete)
+				throw Xml_node::Invalid_syntax();
+
+			/*
+			 * Store the sub nodes of each node in consecutive slots. Because
+			 * the nodes are numbered in document order, each node is appended
+			 * to its parent after its preceding siblings.
+			 */
+			_sub_nodes = (unsigned *)_alloc.alloc(_num_nodes*sizeof(unsigned));
+
+			unsigned slot = 0;
+			for (unsigned i = 0; i < _num_nodes; i++) {
+				_nodes[i].sub_nodes = slot;
+				slot += _nodes[i].num_sub_nodes;
+			}
+
+			/* use 'sub_nodes' as fill pointer, rewind afterwards */
+			for (unsigned i = 1; i < _num_nodes; i++)
+				_sub_nodes[_nodes[_nodes[i].parent].sub_nodes++] = i;
+
+			for (unsigned i = 0; i < _num_nodes; i++)
+				_nodes[i].sub_nodes -= _nodes[i].num_sub_nodes;
+		}
+
+	public:
+
+		class Node;
+
+		/**
+		 * Constructor
+		 *
+		 * \throw Xml_node::Invalid_syntax
+		 * \throw Allocator::Out_of_memory
+		 */
+		Xml_index(Allocator &alloc, Xml_node const &node)
+		:
+			_alloc(alloc), _base(node.addr()), _max_len(node._max_len)
+		{
+			try { _build(node); }
+			catch (...) { _free(); throw; }
+		}
+
+		~Xml_index() { _free(); }
+
+		/**
+		 * Return number of indexed nodes
+		 */
+		size_t num_nodes() const { return _num_nodes; }
+
+		/**
+		 * Return indexed node that was passed to the constructor
+		 */
+		inline Node node() const;
+};
+
+
+/**
+ * Node of an 'Xml_index'
+ *
+ * The interface resembles the one of 'Xml_node' but operates on the
+ * index instead of scanning the XML data.
+ */
+class Genode::Xml_index::Node
+{
+	private:
+
+		friend class Xml_index;
+
+		Xml_index const *_index;
+		unsigned         _id;
+
+		Node(Xml_index const &index, unsigned id) : _index(&index), _id(id) { }
+
+		Entry const &_entry() const { return _index->_nodes[_id]; }
+
+		Node _sub_node_at(unsigned idx) const {
+			return Node(*_index, _index->_sub_nodes[_entry().sub_nodes + idx]); }
+
+		char const *_name() const { return _index->_base + _entry().start + 1; }
+
+		Attribute_entry const *_attribute(char const *type) const
+		{
+			Entry const &e = _entry();
+			for (unsigned i = 0; i < e.num_attributes; i++) {
+				Attribute_entry const &a = _index->_attributes[e.attributes + i];
+				if (_equal(_index->_base + a.name, a.name_len, type))
+					return &a;
+			}
+			return nullptr;
+		}
+
+	public:
+
+		/**
+		 * Return XML node
+		 *
+		 * The node is created without scanning its content.
+		 */
+		Xml_node xml_node() const
+		{
+			Entry const &e = _entry();
+
+			Tag const start_tag(_index->_token(e.start));
+			Tag const end_tag = (e.end == e.start) ? start_tag
+			                                       : Tag(_index->_token(e.end));
+
+			/* the indexed node may start with whitespace or comments */
+			size_t const addr = _id ? e.start : 0;
+
+			return Xml_node(_index->_base + addr, _index->_max_len - addr,
+			                start_tag, end_tag, e.num_sub_nodes);
+		}
+
+		Xml_node::Type type() const {
+			return Xml_node::Type(_name(), _entry().name_len); }
+
+		/**
+		 * Return true if node is of specified type
+		 */
+		bool has_type(char const *type) const {
+			return _equal(_name(), _entry().name_len, type); }
+
+		size_t num_sub_nodes() const { return _entry().num_sub_nodes; }
+
+		/**
+		 * Return sub node with specified index
+		 *
+		 * \throw Xml_node::Nonexistent_sub_node
+		 */
+		Node sub_node(unsigned idx = 0U) const
+		{
+			if (idx >= _entry().num_sub_nodes)
+				throw Xml_node::Nonexistent_sub_node();
+
+			return _sub_node_at(idx);
+		}
+
+		/**
+		 * Return first sub node that matches the specified type
+		 *
+		 * \throw Xml_node::Nonexistent_sub_node
+		 */
+		Node sub_node(char const *type) const
+		{
+			for (unsigned i = 0; i < _entry().num_sub_nodes; i++)
+				if (_sub_node_at(i).has_type(type))
+					return _sub_node_at(i);
+
+			throw Xml_node::Nonexistent_sub_node();
+		}
+
+		/**
+		 * Return true if sub node of specified type exists
+		 */
+		bool has_sub_node(char const *type) const
+		{
+			for (unsigned i = 0; i < _entry().num_sub_nodes; i++)
+				if (_sub_node_at(i).has_type(type))
+					return true;
+			return false;
+		}
+
+		/**
+		 * Execute functor 'fn' for each sub node of specified type
+		 */
+		template <typename FN>
+		void for_each_sub_node(char const *type, FN const &fn) const
+		{
+			for (unsigned i = 0; i < _entry().num_sub_nodes; i++) {
+				Node const node = _sub_node_at(i);
+				if (!type || node.has_type(type))
+					fn(node);
+			}
+		}
+
+		/**
+		 * Execute functor 'fn' for each sub node
+		 */
+		template <typename FN>
+		void for_each_sub_node(FN const &fn) const
+		{
+			for_each_sub_node(nullptr, fn);
+		}
+
+		size_t num_attributes() const { return _entry().num_attributes; }
+
+		/**
+		 * Return Nth attribute of node
+		 *
+		 * \throw Xml_node::Nonexistent_attribute
+		 */
+		Xml_attribute attribute(unsigned idx) const
+		{
+			if (idx >= _entry().num_attributes)
+				throw Xml_node::Nonexistent_attribute();
+
+			Attribute_entry const &a = _index->_attributes[_entry().attributes + idx];
+			return Xml_attribute(_index->_token(a.name));
+		}
+
+		/**
+		 * Return attribute of specified type
+		 *
+		 * \throw Xml_node::Nonexistent_attribute
+		 */
+		Xml_attribute attribute(char const *type) const
+		{
+			Attribute_entry const *a = _attribute(type);
+			if (!a)
+				throw Xml_node::Nonexistent_attribute();
+
+			return Xml_attribute(_index->_token(a->name));
+		}
+
+		/**
+		 * Read attribute value, see 'Xml_node::attribute_value'
+		 */
+		template <typename T>
+		T attribute_value(char const *type, T default_value) const
+		{
+			T result = default_value;
+			if (Attribute_entry const *a = _attribute(type))
+				Xml_attribute(_index->_token(a->name)).value(&result);
+			return result;
+		}
+
+		/**
+		 * Return true if attribute of specified type exists
+		 */
+		bool has_attribute(char const *type) const {
+			return _attribute(type) != nullptr; }
+};
+
+
+Genode::Xml_index::Node Genode::Xml_index::node() const { return Node(*this, 0); }
+
+#endif /* _INCLUDE__UTIL__XML_INDEX_H_ */
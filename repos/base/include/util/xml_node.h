@@ -20,6 +20,7 @@
 namespace Genode {
 	class Xml_attribute;
 	class Xml_node;
+	class Xml_index;
 }
 
 
@@ -49,6 +50,7 @@ class Genode::Xml_attribute
 		Token _value;
 
 		friend class Xml_node;
+		friend class Xml_index;
 
 		/*
 		 * Even though 'Tag' is part of 'Xml_node', the friendship
@@ -581,6 +583,21 @@ class Genode::Xml_node
 			return Xml_node(at, _max_len - (at - addr()));
 		}
 
+		friend class Xml_index;
+
+		/**
+		 * Constructor used by 'Xml_index' for nodes with known structure
+		 *
+		 * In contrast to the public constructor, the node content is not
+		 * scanned for the end tag.
+		 */
+		Xml_node(const char *addr, size_t max_len, Tag start_tag, Tag end_tag,
+		         int num_sub_nodes)
+		:
+			_addr(addr), _max_len(max_len), _num_sub_nodes(num_sub_nodes),
+			_start_tag(start_tag), _end_tag(end_tag)
+		{ }
+
 	public:
 
 		/**
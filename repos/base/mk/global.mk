@@ -142,12 +142,16 @@ CC_CXX_OPT     += $(CC_CXX_OPT_STD)
 # code when '-gc-sections' is enabled. Also, set max-page-size to 4KiB to
 # prevent the linker from aligning the text segment to any built-in default
 # (e.g., 4MiB on x86_64 or 64KiB on ARM). Otherwise, the padding bytes are
-# wasted at the beginning of the final binary.
+# wasted at the beginning of the final binary. Dynamic objects carry both the
+# SysV and the GNU hash table. The dynamic linker prefers the latter, which
+# has a Bloom filter to reject lookups of symbols not defined by the object.
 #
 LD_OPT_GC_SECTIONS ?= -gc-sections
 LD_OPT_ALIGN_SANE   = -z max-page-size=0x1000
+LD_OPT_HASH_STYLE  ?= --hash-style=both
 LD_OPT_PREFIX      := -Wl,
-LD_OPT             += $(LD_MARCH) $(LD_OPT_GC_SECTIONS) $(LD_OPT_ALIGN_SANE)
+LD_OPT             += $(LD_MARCH) $(LD_OPT_GC_SECTIONS) $(LD_OPT_ALIGN_SANE) \
+                      $(LD_OPT_HASH_STYLE)
 CXX_LINK_OPT       += $(addprefix $(LD_OPT_PREFIX),$(LD_OPT))
 CXX_LINK_OPT       += $(LD_OPT_NOSTDLIB)
 
@@ -287,9 +287,11 @@ struct Linker::Elf_file : File
 
 		memcpy((void*)dst, src, p.p_filesz);
 
-		/* clear if file size < memory size */
-		if (p.p_filesz < p.p_memsz)
-			memset((void *)(dst + p.p_filesz), 0, p.p_memsz - p.p_filesz);
+		/*
+		 * The remainder up to the memory size (BSS) needs no clearing
+		 * because RAM dataspaces are zero-initialized, which spares us from
+		 * touching all BSS pages at load time.
+		 */
 
 		env()->rm_session()->detach(src);
 	}
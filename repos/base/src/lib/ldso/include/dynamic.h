@@ -18,6 +18,8 @@
 
 namespace Linker {
 	struct Hash_table;
+	struct Gnu_hash_table;
+	struct Symbol_hash;
 	struct Dynamic;
 }
 
@@ -51,6 +53,99 @@ struct Linker::Hash_table
 };
 
 
+/**
+ * GNU hash table and hash function
+ *
+ * The table starts with a Bloom filter that rejects most lookups of symbols
+ * not defined by the object without touching the buckets. The chains are
+ * sorted by bucket and contain the hash values of the symbols. Bit 0 of
+ * a chain value marks the end of the chain.
+ */
+struct Linker::Gnu_hash_table
+{
+	Elf::Hashelt const *_header() const { return (Elf::Hashelt const *)this; }
+
+	unsigned long nbuckets()    const { return _header()[0]; }
+	unsigned long symoffset()   const { return _header()[1]; }
+	unsigned long bloom_size()  const { return _header()[2]; }
+	unsigned long bloom_shift() const { return _header()[3]; }
+
+	Elf::Addr const *bloom() const {
+		return (Elf::Addr const *)(_header() + 4); }
+
+	Elf::Hashelt const *buckets() const {
+		return (Elf::Hashelt const *)(bloom() + bloom_size()); }
+
+	/**
+	 * Return hash value of symbol with index 'sym_index'
+	 */
+	Elf::Hashelt chain(unsigned long sym_index) const {
+		return (buckets() + nbuckets())[sym_index - symoffset()]; }
+
+	/**
+	 * Return true if the Bloom filter admits that the symbol is defined
+	 */
+	bool may_contain(Genode::uint32_t hash) const
+	{
+		enum { BITS = sizeof(Elf::Addr)*8 };
+
+		Elf::Addr const word = bloom()[(hash / BITS) % bloom_size()];
+		Elf::Addr const mask = ((Elf::Addr)1 << (hash % BITS))
+		                     | ((Elf::Addr)1 << ((hash >> bloom_shift()) % BITS));
+
+		return (word & mask) == mask;
+	}
+
+	/**
+	 * Return number of symbols of the symbol table
+	 *
+	 * The GNU hash table does not state the number of symbols. Symbols
+	 * below 'symoffset' are not hashed. The last hashed symbol terminates
+	 * the chain of the last non-empty bucket.
+	 */
+	unsigned long num_symbols() const
+	{
+		unsigned long last = 0;
+		for (unsigned long i = 0; i < nbuckets(); i++)
+			last = Genode::max(last, (unsigned long)buckets()[i]);
+
+		if (last < symoffset())
+			return symoffset();
+
+		while (!(chain(last) & 1))
+			last++;
+
+		return last + 1;
+	}
+
+	/**
+	 * Hash function of the GNU tool chain (Bernstein hash)
+	 */
+	static Genode::uint32_t hash(char const *name)
+	{
+		Genode::uint32_t h = 5381;
+
+		for (unsigned char const *p = (unsigned char const *)name; *p; p++)
+			h = h*33 + *p;
+
+		return h;
+	}
+};
+
+
+/**
+ * Hash values of a symbol name for both kinds of hash tables
+ */
+struct Linker::Symbol_hash
+{
+	unsigned long    const elf;
+	Genode::uint32_t const gnu;
+
+	Symbol_hash(char const *name)
+	: elf(Hash_table::hash(name)), gnu(Gnu_hash_table::hash(name)) { }
+};
+
+
 /**
  * .dynamic section entries
  */
@@ -78,6 +173,8 @@ struct Linker::Dynamic
 	Elf::Dyn   const     *dynamic;
 
 	Hash_table          *hash_table    = nullptr;
+	Gnu_hash_table      *gnu_hash      = nullptr;
+	unsigned long        num_symbols   = 0;
 
 	Elf::Rela           *reloca        = nullptr;
 	unsigned long        reloca_size   = 0;
@@ -156,6 +253,7 @@ struct Linker::Dynamic
 				case DT_PLTRELSZ: pltrel_size = d->un.val;                           break;
 				case DT_PLTGOT  : section<typeof(pltgot)>(&pltgot, d);               break;
 				case DT_HASH    : section<typeof(hash_table)>(&hash_table, d);       break;
+				case DT_GNU_HASH: section<typeof(gnu_hash)>(&gnu_hash, d);           break;
 				case DT_RELA    : section<typeof(reloca)>(&reloca, d);               break;
 				case DT_RELASZ  : reloca_size = d->un.val;                           break;
 				case DT_SYMTAB  : section<typeof(symtab)>(&symtab, d);               break;
@@ -171,6 +269,19 @@ struct Linker::Dynamic
 					break;
 			}
 		}
+
+		if (hash_table)
+			num_symbols = hash_table->nchains();
+		else if (gnu_hash)
+			num_symbols = gnu_hash->num_symbols();
+	}
+
+	/**
+	 * Return start of the hash tables, which precede the other sections
+	 */
+	Elf::Addr hash_tables() const
+	{
+		return hash_table ? (Elf::Addr)hash_table : (Elf::Addr)gnu_hash;
 	}
 
 	void relocate()
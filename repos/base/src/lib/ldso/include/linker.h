@@ -53,6 +53,17 @@ namespace Linker {
 	 */
 	extern bool bind_now;
 
+	/**
+	 * Cache results of symbol lookups by name
+	 */
+	extern bool lookup_cache;
+
+	/**
+	 * Invalidate cached symbol lookups, called when loading or unloading
+	 * an object
+	 */
+	void flush_lookup_cache();
+
 	/**
 	 * Find symbol via index
 	 *
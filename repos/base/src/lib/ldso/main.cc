@@ -32,11 +32,13 @@ namespace Linker {
 	struct Binary;
 	struct Link_map;
 	struct Debug;
+	class  Symbol_cache;
 
 };
 
 static    Binary *binary = 0;
 bool      Linker::bind_now = false;
+bool      Linker::lookup_cache = true;
 Link_map *Link_map::first;
 
 /**
@@ -72,6 +74,7 @@ struct Linker::Elf_object : Object, Genode::Fifo<Elf_object>::Element
 		/* register for static construction and relocation */
 		Init::list()->insert(this);
 		obj_list()->enqueue(this);
+		flush_lookup_cache();
 
 		/* add to link map */
 		Debug::state_change(Debug::ADD, nullptr);
@@ -94,6 +97,7 @@ struct Linker::Elf_object : Object, Genode::Fifo<Elf_object>::Element
 
 		/* remove from loaded objects list */
 		obj_list()->remove(this);
+		flush_lookup_cache();
 	}
 
 	/**
@@ -101,7 +105,7 @@ struct Linker::Elf_object : Object, Genode::Fifo<Elf_object>::Element
 	 */
 	Elf::Sym const *symbol(unsigned sym_index) const
 	{
-		if (sym_index > dyn.hash_table->nchains())
+		if (sym_index >= dyn.num_symbols)
 			return 0;
 
 		return dyn.symtab + sym_index;
@@ -114,40 +118,79 @@ struct Linker::Elf_object : Object, Genode::Fifo<Elf_object>::Element
 		return dyn.strtab + sym->st_name;
 	}
 
+	/**
+	 * Return true if symbol is a definition of the given name
+	 */
+	bool matches(Elf::Sym const *sym, char const *name) const
+	{
+		/* this omitts everything but 'NOTYPE', 'OBJECT', and 'FUNC' */
+		if (sym->type() > STT_FUNC)
+			return false;
+
+		if (sym->st_value == 0)
+			return false;
+
+		char const *sym_name = symbol_name(sym);
+
+		return name[0] == sym_name[0] && !Genode::strcmp(name, sym_name);
+	}
+
+	/**
+	 * Lookup symbol name via the GNU hash table
+	 */
+	Elf::Sym const *lookup_gnu_symbol(char const *name, Genode::uint32_t hash) const
+	{
+		Gnu_hash_table const *h = dyn.gnu_hash;
+
+		if (!h->nbuckets() || !h->bloom_size() || !h->may_contain(hash))
+			return nullptr;
+
+		unsigned long sym_index = h->buckets()[hash % h->nbuckets()];
+
+		if (sym_index < h->symoffset())
+			return nullptr;
+
+		/* traverse hash chain, compare hash values before names */
+		for (; sym_index < dyn.num_symbols; sym_index++) {
+
+			Elf::Hashelt const chain = h->chain(sym_index);
+
+			if (((chain ^ hash) >> 1) == 0 && matches(symbol(sym_index), name))
+				return symbol(sym_index);
+
+			if (chain & 1)
+				break;
+		}
+
+		return nullptr;
+	}
+
 	/**
 	 * Lookup symbol name in this ELF
 	 */
-	Elf::Sym const *lookup_symbol(char const *name, unsigned long hash) const
+	Elf::Sym const *lookup_symbol(char const *name, Symbol_hash const &hash) const
 	{
+		if (dyn.gnu_hash)
+			return lookup_gnu_symbol(name, hash.gnu);
+
 		Hash_table *h = dyn.hash_table;
 
-		if (!h->buckets())
+		if (!h || !h->buckets())
 			return nullptr;
 
-		unsigned long sym_index = h->buckets()[hash % h->nbuckets()];
+		unsigned long sym_index = h->buckets()[hash.elf % h->nbuckets()];
 
 		/* traverse hash chain */
 		for (; sym_index != STN_UNDEF; sym_index = h->chains()[sym_index])
 		{
 			/* bad object */
-			if (sym_index > h->nchains())
+			if (sym_index >= h->nchains())
 				return nullptr;
 
-			Elf::Sym const *sym      = symbol(sym_index);
-			char const     *sym_name = symbol_name(sym);
-
-			/* this omitts everything but 'NOTYPE', 'OBJECT', and 'FUNC' */
-			if (sym->type() > STT_FUNC)
-				continue;
-
-			if (sym->st_value == 0)
-				continue;
-
-			/* check for symbol name */
-			if (name[0] != sym_name[0] || Genode::strcmp(name, sym_name))
-				continue;
+			Elf::Sym const *sym = symbol(sym_index);
 
-			return sym;
+			if (matches(sym, name))
+				return sym;
 		}
 
 		return nullptr;
@@ -183,9 +226,7 @@ struct Linker::Elf_object : Object, Genode::Fifo<Elf_object>::Element
 		info.base = map.addr;
 		info.addr = 0;
 
-		Hash_table *h = dyn.hash_table;
-
-		for (unsigned long sym_index = 0; sym_index < h->nchains(); sym_index++)
+		for (unsigned long sym_index = 0; sym_index < dyn.num_symbols; sym_index++)
 		{
 			Elf::Sym const *sym = symbol(sym_index);
 
@@ -256,10 +297,10 @@ struct Linker::Ld : Dependency, Elf_object
 		Elf_object::setup_link_map();
 
 		/**
-		 * Use DT_HASH table address for linker, assuming that it will always be at
+		 * Use hash table address for linker, assuming that it will always be at
 		 * the beginning of the file
 		 */
-		map.addr = trunc_page((Elf::Addr)dynamic()->hash_table);
+		map.addr = trunc_page(dynamic()->hash_tables());
 	}
 
 	void load_phdr()
@@ -351,7 +392,7 @@ struct Linker::Binary : Root_object, Elf_object
 	{
 		Elf::Sym const *symbol = 0;
 
-		if ((symbol = Elf_object::lookup_symbol(name, Hash_table::hash(name))))
+		if ((symbol = Elf_object::lookup_symbol(name, Symbol_hash(name))))
 			return reloc_base() + symbol->st_value;
 
 		return 0;
@@ -444,13 +485,93 @@ Elf::Sym const *Linker::lookup_symbol(unsigned sym_index, Dependency const *dep,
 }
 
 
-Elf::Sym const *Linker::lookup_symbol(char const *name, Dependency const *dep,
-                                      Elf::Addr *base, bool undef, bool other)
+/**
+ * Cache of symbol lookups by name
+ *
+ * The relocations of different objects refer to the same symbols over and
+ * over, e.g., to the functions of the C runtime. The cache maps a symbol
+ * name looked up within the dependencies of a root object to the resulting
+ * symbol. Because loading or unloading an object may change the result of
+ * lookups, the cache is flushed whenever the set of objects changes.
+ */
+class Linker::Symbol_cache
+{
+	private:
+
+		enum { SIZE = 1024 };
+
+		struct Entry
+		{
+			char        const *name;
+			Genode::uint32_t   hash;
+			Root_object const *root;
+			bool               undef;
+			Elf::Sym    const *symbol;
+			Elf::Addr          base;
+		};
+
+		Genode::Lock _lock;
+		Entry        _entries[SIZE];
+
+		Entry &_entry(Genode::uint32_t hash) { return _entries[hash % SIZE]; }
+
+	public:
+
+		Symbol_cache() { flush(); }
+
+		static Symbol_cache &cache()
+		{
+			static Symbol_cache _cache;
+			return _cache;
+		}
+
+		bool lookup(char const *name, Genode::uint32_t hash, Root_object const *root,
+		            bool undef, Elf::Sym const **symbol, Elf::Addr *base)
+		{
+			Genode::Lock::Guard guard(_lock);
+
+			Entry const &e = _entry(hash);
+			if (!e.symbol || e.hash != hash || e.root != root || e.undef != undef
+			 || Genode::strcmp(e.name, name))
+				return false;
+
+			*symbol = e.symbol;
+			*base   = e.base;
+			return true;
+		}
+
+		void insert(char const *name, Genode::uint32_t hash, Root_object const *root,
+		            bool undef, Elf::Sym const *symbol, Elf::Addr base)
+		{
+			Genode::Lock::Guard guard(_lock);
+
+			_entry(hash) = { name, hash, root, undef, symbol, base };
+		}
+
+		void flush()
+		{
+			Genode::Lock::Guard guard(_lock);
+
+			for (unsigned i = 0; i < SIZE; i++)
+				_entries[i].symbol = nullptr;
+		}
+};
+
+
+/**
+ * Lookup symbol by name
+ *
+ * \param owner  returned object defining the symbol
+ */
+static Elf::Sym const *lookup_symbol_uncached(char const *name, Symbol_hash const &hash,
+                                              Dependency const *dep, Elf::Addr *base,
+                                              bool undef, bool other,
+                                              Elf_object const **owner)
 {
 	Dependency const *curr        = dep->root ? dep->root->dep.head() : dep;
-	unsigned long     hash        = Hash_table::hash(name);
 	Elf::Sym   const *weak_symbol = 0;
 	Elf::Addr        weak_base    = 0;
+	Elf_object const *weak_owner  = 0;
 	Elf::Sym   const *symbol      = 0;
 
 	//TODO: handle vertab and search in object list
@@ -470,13 +591,15 @@ Elf::Sym const *Linker::lookup_symbol(char const *name, Dependency const *dep,
 				continue;
 
 			if (!symbol->weak() && symbol->st_shndx != SHN_UNDEF) {
-				*base = elf->reloc_base();
+				*base  = elf->reloc_base();
+				*owner = elf;
 				return symbol;
 			}
 
 			if (!weak_symbol) {
 				weak_symbol = symbol;
 				weak_base   = elf->reloc_base();
+				weak_owner  = elf;
 			}
 		}
 	}
@@ -484,7 +607,8 @@ Elf::Sym const *Linker::lookup_symbol(char const *name, Dependency const *dep,
 	/* try searching binary's dependencies */
 	if (!weak_symbol && dep->root) {
 		if (binary && dep != binary->dep.head()) {
-			return lookup_symbol(name, binary->dep.head(), base, undef, other);
+			return lookup_symbol_uncached(name, hash, binary->dep.head(), base,
+			                              undef, other, owner);
 		} else {
 			PERR("Could not lookup symbol \"%s\"", name);
 			throw Not_found();
@@ -497,11 +621,48 @@ Elf::Sym const *Linker::lookup_symbol(char const *name, Dependency const *dep,
 	if (!weak_symbol)
 		throw Not_found();
 
-	*base = weak_base;
+	*base  = weak_base;
+	*owner = weak_owner;
 	return weak_symbol;
 }
 
 
+Elf::Sym const *Linker::lookup_symbol(char const *name, Dependency const *dep,
+                                      Elf::Addr *base, bool undef, bool other)
+{
+	Symbol_hash const hash(name);
+
+	/*
+	 * Lookups that exclude the requesting object depend on the requesting
+	 * object and are not cached. Lookups without root object happen during
+	 * the relocation of the linker itself.
+	 */
+	bool const cached = lookup_cache && dep->root && !other;
+
+	Elf::Sym const *symbol = nullptr;
+	if (cached && Symbol_cache::cache().lookup(name, hash.gnu, dep->root, undef,
+	                                          &symbol, base))
+		return symbol;
+
+	Elf_object const *owner = nullptr;
+	symbol = lookup_symbol_uncached(name, hash, dep, base, undef, other, &owner);
+
+	/* refer to the name stored in the defining object, which outlives 'name' */
+	if (cached)
+		Symbol_cache::cache().insert(owner->symbol_name(symbol), hash.gnu,
+		                             dep->root, undef, symbol, *base);
+
+	return symbol;
+}
+
+
+void Linker::flush_lookup_cache()
+{
+	if (lookup_cache)
+		Symbol_cache::cache().flush();
+}
+
+
 void Linker::load_linker_phdr()
 {
 	if (!Ld::linker()->file())
@@ -555,6 +716,11 @@ void Component::construct(Genode::Env &env)
 		bind_now = Genode::config()->xml_node().attribute("ld_bind_now").has_value("yes");
 	} catch (...) { }
 
+	try {
+		/* cache symbol lookups */
+		lookup_cache = !Genode::config()->xml_node().attribute("ld_lookup_cache").has_value("no");
+	} catch (...) { }
+
 	/* load binary and all dependencies */
 	try {
 		binary = new(Genode::env()->heap()) Binary();
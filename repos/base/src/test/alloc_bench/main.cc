@@ -0,0 +1,114 @@
+/*
+ * \brief  Benchmark of concurrent heap allocations
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-14
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+/* Genode includes */
+#include <base/env.h>
+#include <base/heap.h>
+#include <base/magazine_allocator.h>
+#include <base/printf.h>
+#include <base/thread.h>
+#include <timer_session/connection.h>
+
+using namespace Genode;
+
+
+enum {
+	MAX_THREADS = 4,
+	ROUNDS      = 4096,
+	WINDOW      = 64,   /* blocks allocated at once by each thread */
+};
+
+
+/**
+ * Thread allocating and freeing blocks of varying size
+ */
+struct Worker : Thread<0x4000>
+{
+	Allocator &alloc;
+	bool       release;
+	void      *blocks[WINDOW];
+	size_t     sizes[WINDOW];
+	bool       failed = false;
+
+	Worker(Allocator &alloc, bool release)
+	: Thread<0x4000>("worker"), alloc(alloc), release(release) { }
+
+	void entry()
+	{
+		/* sizes between 16 and 512 bytes as typical for packet buffers */
+		unsigned seed = (unsigned)(addr_t)this;
+		for (unsigned i = 0; i < WINDOW; i++) {
+			seed = seed * 1103515245 + 12345;
+			sizes[i] = 16 + (seed >> 16) % 497;
+		}
+
+		for (unsigned r = 0; r < ROUNDS; r++) {
+			for (unsigned i = 0; i < WINDOW; i++)
+				if (!alloc.alloc(sizes[i], &blocks[i]))
+					failed = true;
+
+			for (unsigned i = 0; i < WINDOW; i++)
+				alloc.free(blocks[i], sizes[i]);
+		}
+
+		if (release)
+			static_cast<Magazine_allocator &>(alloc).release_thread_cache();
+	}
+};
+
+
+static void bench(char const *name, Allocator &alloc, bool release,
+                  Timer::Connection &timer)
+{
+	for (unsigned n = 1; n <= MAX_THREADS; n++) {
+
+		Worker *workers[MAX_THREADS];
+
+		unsigned long const start = timer.elapsed_ms();
+
+		for (unsigned i = 0; i < n; i++) {
+			workers[i] = new (env()->heap()) Worker(alloc, release);
+			workers[i]->start();
+		}
+
+		bool failed = false;
+		for (unsigned i = 0; i < n; i++) {
+			workers[i]->join();
+			failed |= workers[i]->failed;
+			destroy(env()->heap(), workers[i]);
+		}
+
+		unsigned long const ms = max(timer.elapsed_ms() - start, 1UL);
+		unsigned long long const allocs = (unsigned long long)n*ROUNDS*WINDOW;
+
+		printf("%s: %u thread(s): %llu allocations/s%s\n", name, n,
+		       allocs*1000/ms, failed ? " (allocation failed)" : "");
+	}
+}
+
+
+int main(int argc, char **argv)
+{
+	printf("--- allocation benchmark ---\n");
+
+	static Timer::Connection timer;
+
+	static Heap heap(env()->ram_session(), env()->rm_session());
+	bench("heap", heap, false, timer);
+
+	static Magazine_allocator magazine(heap);
+	bench("magazine", magazine, true, timer);
+
+	printf("--- finished allocation benchmark ---\n");
+	return 0;
+}
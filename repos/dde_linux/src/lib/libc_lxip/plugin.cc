@@ -6,7 +6,7 @@
  */
 
 /*
- * Copyright (C) 2010-2013 Genode Labs GmbH
+ * Copyright (C) 2010-2016 Genode Labs GmbH
  *
  * This file is part of the Genode OS framework, which is distributed
  * under the terms of the GNU General Public License version 2.
@@ -90,6 +90,8 @@ struct Plugin : Libc::Plugin
 	                     struct timeval *timeout);
 	bool supports_socket(int domain, int type, int protocol);
 
+	unsigned ready(Libc::File_descriptor *sockfdo, unsigned events);
+
 	Libc::File_descriptor *accept(Libc::File_descriptor *sockfdo,
 	                              struct sockaddr *addr,
 	                              socklen_t *addrlen);
@@ -179,6 +181,20 @@ bool Plugin::supports_socket(int domain, int type, int)
 }
 
 
+/*
+ * In contrast to 'select', which blocks regardless of the timeout, the
+ * socket is polled without blocking.
+ */
+unsigned Plugin::ready(Libc::File_descriptor *sockfdo, unsigned events)
+{
+	int const mask = socketcall.poll(context(sockfdo)->handle(), false);
+
+	return ((mask & Lxip::POLLIN)  ? READY_READ   : 0)
+	     | ((mask & Lxip::POLLOUT) ? READY_WRITE  : 0)
+	     | ((mask & Lxip::POLLEX)  ? READY_EXCEPT : 0);
+}
+
+
 Libc::File_descriptor *Plugin::accept(Libc::File_descriptor *sockfdo,
                                       struct sockaddr *addr, socklen_t *addrlen)
 {
@@ -26,7 +26,11 @@
 
 #include <libc-plugin/plugin.h>
 
-enum { MAX_NUM_FDS = 1024 };
+/*
+ * Descriptors above 'FD_SETSIZE' cannot be used with 'select' but with
+ * 'poll' and 'kevent', given that their plugin implements 'Plugin::ready'.
+ */
+enum { MAX_NUM_FDS = 16384 };
 
 namespace Libc {
 
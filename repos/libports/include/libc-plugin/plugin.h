@@ -68,6 +68,25 @@ namespace Libc {
 			virtual bool supports_unlink(const char *path);
 			virtual bool supports_mmap();
 
+			/**
+			 * Readiness of a file descriptor as returned by 'ready'
+			 *
+			 * 'READY_UNKNOWN' denotes that the plugin cannot report the
+			 * readiness of the file descriptor.
+			 */
+			enum { READY_READ = 1, READY_WRITE = 2, READY_EXCEPT = 4,
+			       READY_UNKNOWN = 8 };
+
+			/**
+			 * Return readiness of file descriptor for the given events
+			 *
+			 * The default implementation asks 'select' about the single
+			 * file descriptor and, hence, covers file descriptors below
+			 * 'FD_SETSIZE' only. Plugins able to answer directly should
+			 * override it. The implementation must not block.
+			 */
+			virtual unsigned ready(File_descriptor *, unsigned events);
+
 			virtual File_descriptor *accept(File_descriptor *,
 			                                struct ::sockaddr *addr,
 			                                socklen_t *addrlen);
@@ -137,6 +156,15 @@ namespace Libc {
 			virtual int unlink(const char *path);
 			virtual ssize_t write(File_descriptor *, const void *buf, ::size_t count);
 	};
+
+	/**
+	 * Notify threads blocking in 'select', 'poll', or 'kevent' about a
+	 * readiness change of the file descriptor
+	 *
+	 * Plugins unable to name the file descriptor call 'libc_select_notify'
+	 * instead, which makes the waiters check all of their descriptors.
+	 */
+	void notify_ready(File_descriptor *);
 }
 
 #endif /* _LIBC_PLUGIN__PLUGIN_H_ */
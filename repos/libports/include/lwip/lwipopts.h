@@ -65,6 +65,7 @@
 
 #define MEM_LIBC_MALLOC             1
 #define MEMP_MEM_MALLOC             1
+#define LWIP_SUPPORT_CUSTOM_PBUF    1  /* pbufs referencing packet-stream buffers */
 /* MEM_ALIGNMENT > 4 e.g. for x86_64 are not supported, see Genode issue #817 */
 #define MEM_ALIGNMENT               4
 
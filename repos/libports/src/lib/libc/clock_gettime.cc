@@ -1,18 +1,20 @@
 /*
  * \brief  C-library back end
  * \author Christian Prochaska
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
  * \date   2010-05-19
  */
 
 /*
- * Copyright (C) 2010-2013 Genode Labs GmbH
+ * Copyright (C) 2010-2016 Genode Labs GmbH
  *
  * This file is part of the Genode OS framework, which is distributed
  * under the terms of the GNU General Public License version 2.
  */
 
 #include <base/printf.h>
-#include <os/timed_semaphore.h>
+#include <timer_session/connection.h>
+#include <timer_session/time_page.h>
 
 #include <sys/time.h>
 
@@ -20,6 +22,22 @@ namespace Libc {
 extern time_t read_rtc();
 }
 
+
+/**
+ * Return microseconds since the first call
+ *
+ * The time is read from the time page of a timer session, which does not
+ * involve an RPC once the timer driver calibrated the time counter.
+ */
+static Genode::uint64_t elapsed_us()
+{
+	static Timer::Connection  timer;
+	static Timer::Time_source time_source(timer);
+
+	return time_source.elapsed_us();
+}
+
+
 extern "C" __attribute__((weak))
 int clock_gettime(clockid_t clk_id, struct timespec *tp)
 {
@@ -31,11 +49,11 @@ int clock_gettime(clockid_t clk_id, struct timespec *tp)
 		read_rtc = true;
 	}
 
-	Genode::Alarm::Time time = Genode::Timeout_thread::alarm_timer()->time();
+	Genode::uint64_t const us = elapsed_us();
 
 	if (tp) {
-		tp->tv_sec = rtc + time / 1000;
-		tp->tv_nsec = (time % 1000) * (1000 * 1000);
+		tp->tv_sec  = rtc + us / (1000*1000);
+		tp->tv_nsec = (us % (1000*1000)) * 1000;
 	}
 
 	return 0;
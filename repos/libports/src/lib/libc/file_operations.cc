@@ -27,6 +27,7 @@
 #include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -34,6 +35,7 @@
 #include "libc_file.h"
 #include "libc_mem_alloc.h"
 #include "libc_mmap_registry.h"
+#include "libc_ready.h"
 
 using namespace Libc;
 
@@ -241,8 +243,13 @@ extern "C" int chdir(const char *path)
 }
 
 
-extern "C" int _close(int libc_fd) {
-	FD_FUNC_WRAPPER(close, libc_fd); }
+extern "C" int _close(int libc_fd)
+{
+	/* drop kqueue registrations before the descriptor can be reused */
+	ready_core()->forget(libc_fd);
+
+	FD_FUNC_WRAPPER(close, libc_fd);
+}
 
 
 extern "C" int close(int libc_fd) { return _close(libc_fd); }
@@ -455,7 +462,8 @@ extern "C" void *mmap(void *addr, ::size_t length, int prot, int flags,
 	}
 
 	void *start = fd->plugin->mmap(addr, length, prot, flags, fd, offset);
-	mmap_registry()->insert(start, length, fd->plugin);
+	if (start != MAP_FAILED)
+		mmap_registry()->insert(start, length, fd->plugin);
 	return start;
 }
 
@@ -11,30 +11,19 @@
  * under the terms of the GNU General Public License version 2.
  */
 
-#include <os/timed_semaphore.h>
-
 #include <sys/time.h>
+#include <time.h>
 
-namespace Libc {
-extern time_t read_rtc();
-}
 
 extern "C" __attribute__((weak))
 int gettimeofday(struct timeval *tv, struct timezone *tz)
 {
-	static bool read_rtc = false;
-	static time_t rtc = 0;
-
-	if (!read_rtc) {
-		rtc = Libc::read_rtc();
-		read_rtc = true;
-	}
-
-	Genode::Alarm::Time time = Genode::Timeout_thread::alarm_timer()->time();
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
 
 	if (tv) {
-		tv->tv_sec = rtc + time / 1000;
-		tv->tv_usec = (time % 1000) * 1000;
+		tv->tv_sec  = ts.tv_sec;
+		tv->tv_usec = ts.tv_nsec / 1000;
 	}
 
 	return 0;
@@ -0,0 +1,517 @@
+/*
+ * \brief  kqueue() and kevent() implementation
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-19
+ *
+ * Only the EVFILT_READ and EVFILT_WRITE filters are supported. In contrast
+ * to 'select' and 'poll', registrations persist across calls, and only
+ * file descriptors notified by their plugin since the last call are
+ * checked. Plugins that cannot name the notified file descriptor make
+ * the kqueue check all of its descriptors.
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+/* Genode includes */
+#include <base/env.h>
+#include <base/printf.h>
+
+/* libc plugin interface */
+#include <libc-plugin/fd_alloc.h>
+#include <libc-plugin/plugin.h>
+
+/* libc includes */
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/time.h>
+
+/* libc-internal includes */
+#include <libc_ready.h>
+
+using namespace Libc;
+
+
+/**
+ * Registration of one filter of a file descriptor at a kqueue
+ */
+struct Knote : Ready_watch
+{
+	short          const filter;
+	unsigned short       flags;
+	void                *udata;
+
+	bool   enabled   = true;
+	bool   queued    = false; /* member of the candidate list */
+	Knote *next_hash = nullptr;
+	Knote *next_cand = nullptr;
+
+	/*
+	 * State of a knote whose readiness is checked by '_scan' without
+	 * the lock of the kqueue held. A knote removed meanwhile is marked
+	 * as dead and destroyed by the scanning thread.
+	 */
+	bool     scanning  = false;
+	bool     checked   = false;
+	bool     dead      = false;
+	unsigned ready     = 0;
+	Knote   *next_scan = nullptr;
+
+	Knote(Ready_listener &kq, struct kevent const &kev)
+	:
+		Ready_watch(kq, kev.ident), filter(kev.filter),
+		flags(kev.flags), udata(kev.udata)
+	{ }
+
+	unsigned events() const {
+		return filter == EVFILT_READ ? Plugin::READY_READ : Plugin::READY_WRITE; }
+};
+
+
+class Kqueue : public Ready_waiter, public Plugin_context
+{
+	private:
+
+		enum { BUCKETS = 256 };
+
+		/*
+		 * The knotes and the candidate list are protected by '_lock'. It
+		 * is taken by the notification hooks with the core lock held, so
+		 * neither the core nor a plugin, which may notify the core, must
+		 * be called with '_lock' held.
+		 */
+		Genode::Lock _lock;
+		Knote       *_knotes[BUCKETS];
+		Knote       *_candidates = nullptr;
+		bool         _scan_all   = false;
+
+		static unsigned _hash(int libc_fd) { return (unsigned)libc_fd % BUCKETS; }
+
+		Knote *_lookup(int libc_fd, short filter)
+		{
+			for (Knote *k = _knotes[_hash(libc_fd)]; k; k = k->next_hash)
+				if (k->libc_fd == libc_fd && k->filter == filter)
+					return k;
+			return nullptr;
+		}
+
+		void _unlink(Knote &knote)
+		{
+			for (Knote **k = &_knotes[_hash(knote.libc_fd)]; *k; k = &(*k)->next_hash)
+				if (*k == &knote) {
+					*k = knote.next_hash;
+					return;
+				}
+		}
+
+		void _unqueue(Knote &knote)
+		{
+			if (!knote.queued)
+				return;
+
+			for (Knote **k = &_candidates; *k; k = &(*k)->next_cand)
+				if (*k == &knote) {
+					*k = knote.next_cand;
+					break;
+				}
+			knote.queued = false;
+		}
+
+		void _enqueue(Knote &knote)
+		{
+			if (knote.queued)
+				return;
+
+			knote.queued    = true;
+			knote.next_cand = _candidates;
+			_candidates     = &knote;
+		}
+
+		/**
+		 * Apply one entry of the change list
+		 *
+		 * \return errno value
+		 */
+		int _change(struct kevent const &kev)
+		{
+			if (kev.filter != EVFILT_READ && kev.filter != EVFILT_WRITE)
+				return EINVAL;
+
+			int const libc_fd = kev.ident;
+
+			if (kev.flags & EV_DELETE) {
+				Knote *knote = nullptr;
+				{
+					Genode::Lock::Guard guard(_lock);
+					knote = _lookup(libc_fd, kev.filter);
+				}
+				if (!knote)
+					return ENOENT;
+
+				_destroy(*knote);
+				return 0;
+			}
+
+			if (kev.flags & EV_ADD) {
+				if (!file_descriptor_allocator()->find_by_libc_fd(libc_fd))
+					return EBADF;
+
+				{
+					Genode::Lock::Guard guard(_lock);
+					if (Knote *knote = _lookup(libc_fd, kev.filter)) {
+						knote->flags   = kev.flags;
+						knote->udata   = kev.udata;
+						knote->enabled = !(kev.flags & EV_DISABLE);
+						if (knote->enabled)
+							_enqueue(*knote);
+						return 0;
+					}
+				}
+
+				Knote *knote = new (Genode::env()->heap()) Knote(*this, kev);
+				knote->enabled = !(kev.flags & EV_DISABLE);
+				{
+					Genode::Lock::Guard guard(_lock);
+					knote->next_hash = _knotes[_hash(libc_fd)];
+					_knotes[_hash(libc_fd)] = knote;
+
+					/* check the initial state with the next scan */
+					if (knote->enabled)
+						_enqueue(*knote);
+				}
+				ready_core()->insert(*knote);
+				return 0;
+			}
+
+			Genode::Lock::Guard guard(_lock);
+
+			Knote *knote = _lookup(libc_fd, kev.filter);
+			if (!knote)
+				return ENOENT;
+
+			if (kev.flags & EV_ENABLE) {
+				knote->enabled = true;
+				_enqueue(*knote);
+			}
+			if (kev.flags & EV_DISABLE) {
+				knote->enabled = false;
+				_unqueue(*knote);
+			}
+			return 0;
+		}
+
+		/**
+		 * Remove knote from the kqueue
+		 *
+		 * Must be called with '_lock' held.
+		 *
+		 * \return true if the knote can be destroyed by the caller, false
+		 *         if it is destroyed by the thread scanning it
+		 */
+		bool _remove(Knote &knote)
+		{
+			_unlink(knote);
+			_unqueue(knote);
+
+			if (!knote.scanning)
+				return true;
+
+			knote.dead = true;
+			return false;
+		}
+
+		void _destroy(Knote &knote)
+		{
+			ready_core()->remove(knote);
+
+			bool destroy = false;
+			{
+				Genode::Lock::Guard guard(_lock);
+				destroy = _remove(knote);
+			}
+			if (destroy)
+				Genode::destroy(Genode::env()->heap(), &knote);
+		}
+
+		/**
+		 * Fill in event of ready knote
+		 *
+		 * Must be called with '_lock' held.
+		 *
+		 * \param oneshot  list of reported one-shot knotes
+		 */
+		void _report(Knote &k, struct kevent &ev, Knote *&oneshot)
+		{
+			EV_SET(&ev, k.libc_fd, k.filter, k.flags & (EV_ONESHOT | EV_CLEAR),
+			       0, 0, k.udata);
+
+			if (k.flags & EV_ONESHOT) {
+				_unqueue(k);
+				k.enabled   = false;
+				k.next_cand = oneshot;
+				oneshot     = &k;
+				return;
+			}
+
+			/* level-triggered knotes are checked again next time */
+			if (!(k.flags & EV_CLEAR))
+				_enqueue(k);
+		}
+
+		/**
+		 * Check candidates and report ready ones
+		 *
+		 * \param oneshot  list of reported one-shot knotes to be destroyed
+		 *                 by the caller
+		 */
+		int _scan(struct kevent *eventlist, int nevents, Knote *&oneshot)
+		{
+			Knote *list = nullptr;
+
+			/* take the candidates that are not scanned by another thread */
+			{
+				Genode::Lock::Guard guard(_lock);
+
+				if (_scan_all) {
+					_scan_all = false;
+					for (unsigned i = 0; i < BUCKETS; i++)
+						for (Knote *k = _knotes[i]; k; k = k->next_hash)
+							if (k->enabled)
+								_enqueue(*k);
+				}
+
+				Knote *candidates = _candidates, *busy = nullptr;
+				_candidates = nullptr;
+
+				while (Knote *k = candidates) {
+					candidates = k->next_cand;
+
+					if (k->scanning) {
+						k->next_cand = busy, busy = k;
+						continue;
+					}
+
+					k->queued    = false;
+					k->scanning  = true;
+					k->checked   = false;
+					k->next_scan = list, list = k;
+				}
+
+				_candidates = busy;
+			}
+
+			/* ask the plugins without holding the lock */
+			int num_ready = 0;
+			for (Knote *k = list; k && num_ready < nevents; k = k->next_scan) {
+				k->checked = true;
+				k->ready   = Libc::ready(k->libc_fd, k->events()) & k->events();
+				if (k->ready)
+					num_ready++;
+			}
+
+			Knote *dead = nullptr;
+			int n = 0;
+			{
+				Genode::Lock::Guard guard(_lock);
+
+				while (Knote *k = list) {
+					list = k->next_scan;
+					k->scanning = false;
+
+					if (k->dead) {
+						k->next_scan = dead, dead = k;
+						continue;
+					}
+
+					if (!k->checked || n == nevents) {
+						if (k->enabled)
+							_enqueue(*k);
+						continue;
+					}
+
+					if (!k->ready || !k->enabled)
+						continue;
+
+					_report(*k, eventlist[n++], oneshot);
+				}
+			}
+
+			while (Knote *k = dead) {
+				dead = k->next_scan;
+				Genode::destroy(Genode::env()->heap(), k);
+			}
+
+			return n;
+		}
+
+	public:
+
+		Kqueue() : Ready_waiter(false)
+		{
+			for (unsigned i = 0; i < BUCKETS; i++)
+				_knotes[i] = nullptr;
+		}
+
+		~Kqueue()
+		{
+			for (unsigned i = 0; i < BUCKETS; i++)
+				while (Knote *k = _knotes[i])
+					_destroy(*k);
+		}
+
+		bool pending()
+		{
+			Genode::Lock::Guard guard(_lock);
+			return _candidates || _scan_all;
+		}
+
+		int kevent(struct kevent const *changelist, int nchanges,
+		           struct kevent *eventlist, int nevents,
+		           struct timespec const *timeout)
+		{
+			int n = 0;
+			for (int i = 0; i < nchanges; i++) {
+				int const err = _change(changelist[i]);
+				if (!err && !(changelist[i].flags & EV_RECEIPT))
+					continue;
+
+				if (n == nevents) {
+					errno = err;
+					return -1;
+				}
+
+				eventlist[n] = changelist[i];
+				eventlist[n].flags |= EV_ERROR;
+				eventlist[n].data   = err;
+				n++;
+			}
+
+			if (n || nevents == 0)
+				return n;
+
+			Genode::Alarm::Time msectimeout = 0;
+			if (timeout)
+				msectimeout = timeout->tv_sec*1000
+				            + (timeout->tv_nsec + 999999)/1000000;
+
+			for (;;) {
+				rearm();
+
+				Knote *oneshot = nullptr;
+				n = _scan(eventlist, nevents, oneshot);
+
+				while (Knote *k = oneshot) {
+					oneshot = k->next_cand;
+					_destroy(*k);
+				}
+
+				if (n || (timeout && msectimeout == 0))
+					return n;
+
+				if (!block(timeout ? &msectimeout : 0))
+					return 0;
+			}
+		}
+
+
+		/**************************
+		 ** Ready_listener hooks **
+		 **************************/
+
+		void notified(Ready_watch *watch) override
+		{
+			{
+				Genode::Lock::Guard guard(_lock);
+
+				if (!watch)
+					_scan_all = true;
+				else if (static_cast<Knote *>(watch)->enabled)
+					_enqueue(*static_cast<Knote *>(watch));
+			}
+			_wake();
+		}
+
+		void closed(Ready_watch &watch) override
+		{
+			Knote &knote = static_cast<Knote &>(watch);
+
+			bool destroy = false;
+			{
+				Genode::Lock::Guard guard(_lock);
+				destroy = _remove(knote);
+			}
+			if (destroy)
+				Genode::destroy(Genode::env()->heap(), &knote);
+		}
+};
+
+
+/**
+ * Plugin providing the file descriptors of kqueues
+ */
+class Kqueue_plugin : public Plugin
+{
+	public:
+
+		File_descriptor *kqueue()
+		{
+			Kqueue *kq = new (Genode::env()->heap()) Kqueue;
+			return file_descriptor_allocator()->alloc(this, kq);
+		}
+
+		int close(File_descriptor *fd) override
+		{
+			Genode::destroy(Genode::env()->heap(),
+			                static_cast<Kqueue *>(fd->context));
+			file_descriptor_allocator()->free(fd);
+			return 0;
+		}
+
+		unsigned ready(File_descriptor *fd, unsigned events) override
+		{
+			return static_cast<Kqueue *>(fd->context)->pending()
+			       ? events & READY_READ : 0;
+		}
+};
+
+
+static Kqueue_plugin *kqueue_plugin()
+{
+	static Kqueue_plugin plugin;
+	return &plugin;
+}
+
+
+extern "C" int
+__attribute__((weak))
+kqueue(void)
+{
+	File_descriptor *fd = kqueue_plugin()->kqueue();
+	if (!fd) {
+		errno = EMFILE;
+		return -1;
+	}
+	return fd->libc_fd;
+}
+
+
+extern "C" int
+__attribute__((weak))
+kevent(int kq, struct kevent const *changelist, int nchanges,
+       struct kevent *eventlist, int nevents, struct timespec const *timeout)
+{
+	File_descriptor *fd = file_descriptor_allocator()->find_by_libc_fd(kq);
+	if (!fd || fd->plugin != kqueue_plugin()) {
+		errno = EBADF;
+		return -1;
+	}
+
+	return static_cast<Kqueue *>(fd->context)->kevent(changelist, nchanges,
+	                                                  eventlist, nevents,
+	                                                  timeout);
+}
@@ -29,6 +29,13 @@ namespace Libc {
 	 */
 	Mem_alloc *mem_alloc();
 
+	/**
+	 * Hand the objects cached by malloc for the calling thread back
+	 *
+	 * Called by libpthread when a thread exits.
+	 */
+	void release_thread_cache();
+
 	class Mem_alloc_impl : public Mem_alloc
 	{
 		private:
@@ -0,0 +1,248 @@
+/*
+ * \brief  Readiness notification of file descriptors
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-19
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+#ifndef _LIBC_READY_H_
+#define _LIBC_READY_H_
+
+/* Genode includes */
+#include <base/lock.h>
+#include <os/timed_semaphore.h>
+#include <util/list.h>
+
+/* libc includes */
+#include <sys/select.h>
+
+namespace Libc {
+
+	class Ready_listener;
+	class Ready_watch;
+	class Ready_waiter;
+	class Ready_core;
+
+	/**
+	 * Return singleton instance of the readiness core
+	 */
+	Ready_core *ready_core();
+
+	/**
+	 * Return readiness of file descriptor for the given 'Plugin::READY_*'
+	 * events, or 0 if the descriptor is not open
+	 */
+	unsigned ready(int libc_fd, unsigned events);
+
+	/**
+	 * Poll the 'select' functions of all plugins
+	 *
+	 * The input sets must not be 0. The output sets are cleared first and
+	 * may be 0.
+	 *
+	 * \return number of ready file descriptors
+	 */
+	int select_scan(int nfds, fd_set *in_readfds, fd_set *in_writefds,
+	                fd_set *in_exceptfds, fd_set *out_readfds,
+	                fd_set *out_writefds, fd_set *out_exceptfds);
+}
+
+
+/**
+ * Receiver of readiness notifications
+ *
+ * The hooks are called with the lock of the readiness core held and must
+ * not call back into the core.
+ */
+class Libc::Ready_listener : public Genode::List<Ready_listener>::Element
+{
+	private:
+
+		bool const _any_fd;
+
+	public:
+
+		/**
+		 * Constructor
+		 *
+		 * \param any_fd  receive notifications about all file descriptors,
+		 *                not only the watched ones
+		 */
+		Ready_listener(bool any_fd) : _any_fd(any_fd) { }
+
+		virtual ~Ready_listener() { }
+
+		bool any_fd() const { return _any_fd; }
+
+		/**
+		 * Readiness of a file descriptor may have changed
+		 *
+		 * \param watch  watch of the notified file descriptor, or 0 if
+		 *               the notification did not name a descriptor
+		 */
+		virtual void notified(Ready_watch *watch) = 0;
+
+		/**
+		 * Watched file descriptor got closed
+		 *
+		 * The watch is already removed from the core.
+		 */
+		virtual void closed(Ready_watch &) { }
+};
+
+
+/**
+ * Interest of a listener in one file descriptor
+ */
+class Libc::Ready_watch : public Genode::List<Ready_watch>::Element
+{
+	public:
+
+		Ready_listener &listener;
+		int const       libc_fd;
+
+		Ready_watch(Ready_listener &listener, int libc_fd)
+		: listener(listener), libc_fd(libc_fd) { }
+};
+
+
+class Libc::Ready_core
+{
+	private:
+
+		enum { BUCKETS = 256 };
+
+		Genode::Lock                 _lock;
+		Genode::List<Ready_listener> _listeners;
+		Genode::List<Ready_watch>    _watches[BUCKETS];
+
+		Genode::List<Ready_watch> &_bucket(int libc_fd) {
+			return _watches[(unsigned)libc_fd % BUCKETS]; }
+
+	public:
+
+		Genode::Lock &lock() { return _lock; }
+
+		void insert(Ready_listener &listener)
+		{
+			Genode::Lock::Guard guard(_lock);
+			_listeners.insert(&listener);
+		}
+
+		void remove(Ready_listener &listener)
+		{
+			Genode::Lock::Guard guard(_lock);
+			_listeners.remove(&listener);
+		}
+
+		void insert(Ready_watch &watch)
+		{
+			Genode::Lock::Guard guard(_lock);
+			_bucket(watch.libc_fd).insert(&watch);
+		}
+
+		void remove(Ready_watch &watch)
+		{
+			Genode::Lock::Guard guard(_lock);
+			_bucket(watch.libc_fd).remove(&watch);
+		}
+
+		/**
+		 * Notify listeners of the file descriptor
+		 */
+		void notify(int libc_fd);
+
+		/**
+		 * Notify all listeners
+		 */
+		void notify_all();
+
+		/**
+		 * Drop all watches of a file descriptor that is about to be closed
+		 */
+		void forget(int libc_fd);
+};
+
+
+/**
+ * Thread blocking in 'select', 'poll', or 'kevent'
+ *
+ * A notification between two scans of the descriptors is not lost because
+ * it leaves the semaphore counted up.
+ */
+class Libc::Ready_waiter : public Ready_listener
+{
+	private:
+
+		Genode::Timed_semaphore _sem { 0 };
+		bool                    _woken = false;
+
+	protected:
+
+		/**
+		 * Wake up blocking thread, called with the core lock held
+		 */
+		void _wake()
+		{
+			if (_woken)
+				return;
+
+			_woken = true;
+			_sem.up();
+		}
+
+	public:
+
+		/**
+		 * Constructor
+		 *
+		 * \param any_fd  wake up on notifications of all file descriptors
+		 */
+		Ready_waiter(bool any_fd = true) : Ready_listener(any_fd) {
+			ready_core()->insert(*this); }
+
+		~Ready_waiter() { ready_core()->remove(*this); }
+
+		/**
+		 * Must be called before each scan of the descriptors
+		 */
+		void rearm()
+		{
+			Genode::Lock::Guard guard(ready_core()->lock());
+			_woken = false;
+		}
+
+		/**
+		 * Block until notified
+		 *
+		 * \param timeout_ms  remaining timeout in milliseconds, updated
+		 *                    by the time spent blocking, or 0 to block
+		 *                    without timeout
+		 * \return false if the timeout triggered
+		 */
+		bool block(Genode::Alarm::Time *timeout_ms)
+		{
+			if (!timeout_ms) {
+				_sem.down();
+				return true;
+			}
+
+			try {
+				Genode::Alarm::Time const spent = _sem.down(*timeout_ms);
+				*timeout_ms = spent < *timeout_ms ? *timeout_ms - spent : 1;
+				return true;
+			} catch (Genode::Timeout_exception) {
+				return false;
+			}
+		}
+
+		void notified(Ready_watch *) override { _wake(); }
+};
+
+#endif /* _LIBC_READY_H_ */
@@ -1,12 +1,13 @@
 /*
- * \brief  Simplistic malloc and free implementation
+ * \brief  Size-class malloc and free implementation with per-thread caches
  * \author Norman Feske
  * \author Sebastian Sumpf
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
  * \date   2006-07-21
  */
 
 /*
- * Copyright (C) 2006-2013 Genode Labs GmbH
+ * Copyright (C) 2006-2016 Genode Labs GmbH
  *
  * This file is part of the Genode OS framework, which is distributed
  * under the terms of the GNU General Public License version 2.
@@ -14,167 +15,611 @@
 
 /* Genode includes */
 #include <base/env.h>
+#include <base/lock.h>
 #include <base/printf.h>
-#include <base/slab.h>
+#include <base/thread.h>
+#include <cpu/memory_barrier.h>
 #include <util/construct_at.h>
 #include <util/string.h>
 #include <util/misc_math.h>
 
 /* libc includes */
 extern "C" {
+#include <errno.h>
 #include <string.h>
 #include <stdlib.h>
 }
 
-typedef unsigned long Block_header;
+/* libc-internal includes */
+#include "libc_mem_alloc.h"
 
-namespace Genode {
+using Genode::addr_t;
+using Genode::size_t;
 
-	class Slab_alloc : public Slab
-	{
-		private:
 
-			size_t const _object_size;
+/**
+ * Registry of the spans holding small objects
+ *
+ * The registry is a radix tree over the span numbers of the address space
+ * with a bitmap at the leaves. Nodes are never freed, which allows for
+ * looking up spans without taking a lock. A span is removed before its
+ * memory is released, which happens only once all of its objects are
+ * free. Hence, no lookup of an object of the span can race with the
+ * removal.
+ */
+class Span_map
+{
+	public:
 
-			size_t _calculate_block_size(size_t object_size)
-			{
-				size_t block_size = 16*object_size;
-				return align_addr(block_size, 12);
-			}
+		enum {
+			SPAN_SHIFT = 16, /* 64 KiB */
+			SPAN_SIZE  = 1UL << SPAN_SHIFT,
+		};
+
+	private:
+
+		enum {
+			ADDR_BITS   = sizeof(addr_t) == 8 ? 48 : 32,
+			NUMBER_BITS = ADDR_BITS - SPAN_SHIFT,
+			LEAF_BITS   = 12,
+			MID_BITS    = 10,
+			TOP_BITS    = NUMBER_BITS - LEAF_BITS - MID_BITS > 0
+			            ? NUMBER_BITS - LEAF_BITS - MID_BITS : 0,
+			WORD_BITS   = sizeof(addr_t)*8,
+		};
+
+		struct Leaf { addr_t bits[(1UL << LEAF_BITS) / WORD_BITS]; };
+		struct Mid  { Leaf * volatile leaves[1UL << MID_BITS]; };
+
+		Mid * volatile _top[1UL << TOP_BITS];
+		Genode::Lock   _lock;
+
+		static addr_t _top_index(addr_t n) { return n >> (LEAF_BITS + MID_BITS); }
+		static addr_t _mid_index(addr_t n) { return (n >> LEAF_BITS) & ((1UL << MID_BITS) - 1); }
+		static addr_t _leaf_bit (addr_t n) { return n & ((1UL << LEAF_BITS) - 1); }
+
+		template <typename T>
+		static T *_alloc_node()
+		{
+			void *node = Libc::mem_alloc()->alloc(sizeof(T), 4);
+			if (node)
+				Genode::memset(node, 0, sizeof(T));
+			return (T *)node;
+		}
+
+	public:
+
+		Span_map() { Genode::memset((void *)_top, 0, sizeof(_top)); }
+
+		bool contains(addr_t span) const
+		{
+			addr_t const n = span >> SPAN_SHIFT;
+			if (_top_index(n) >= (1UL << TOP_BITS))
+				return false;
 
-		public:
+			Mid const *mid = _top[_top_index(n)];
+			if (!mid)
+				return false;
 
-			Slab_alloc(size_t object_size, Allocator *backing_store)
-			:
-				Slab(object_size, _calculate_block_size(object_size), 0, backing_store),
-				_object_size(object_size)
-			{ }
+			Leaf const *leaf = mid->leaves[_mid_index(n)];
+			if (!leaf)
+				return false;
 
-			void *alloc()
-			{
-				void *result;
-				return (Slab::alloc(_object_size, &result) ? result : 0);
+			addr_t const bit = _leaf_bit(n);
+			return leaf->bits[bit / WORD_BITS] & (1UL << (bit % WORD_BITS));
+		}
+
+		/**
+		 * Register span
+		 *
+		 * \return false if meta data could not be allocated
+		 */
+		bool insert(addr_t span)
+		{
+			Genode::Lock::Guard guard(_lock);
+
+			addr_t const n = span >> SPAN_SHIFT;
+			if (_top_index(n) >= (1UL << TOP_BITS))
+				return false;
+
+			Mid *mid = _top[_top_index(n)];
+			if (!mid) {
+				if (!(mid = _alloc_node<Mid>()))
+					return false;
+
+				/* publish node not before it is initialized */
+				Genode::memory_barrier();
+				_top[_top_index(n)] = mid;
 			}
 
-			void free(void *ptr) { Slab::free(ptr, _object_size); }
-	};
-}
+			Leaf *leaf = mid->leaves[_mid_index(n)];
+			if (!leaf) {
+				if (!(leaf = _alloc_node<Leaf>()))
+					return false;
+
+				Genode::memory_barrier();
+				mid->leaves[_mid_index(n)] = leaf;
+			}
+
+			addr_t const bit = _leaf_bit(n);
+			leaf->bits[bit / WORD_BITS] |= 1UL << (bit % WORD_BITS);
+			return true;
+		}
+
+		/**
+		 * Unregister span
+		 */
+		void remove(addr_t span)
+		{
+			Genode::Lock::Guard guard(_lock);
+
+			addr_t const n = span >> SPAN_SHIFT;
+			Leaf *leaf = _top[_top_index(n)]->leaves[_mid_index(n)];
+
+			addr_t const bit = _leaf_bit(n);
+			leaf->bits[bit / WORD_BITS] &= ~(1UL << (bit % WORD_BITS));
+		}
+};
 
 
 /**
- * Allocator that uses slabs for small objects sizes
+ * Allocator that uses size classes for small objects
+ *
+ * Small objects are carved from 64-KiB spans that serve a single size
+ * class each. The size class is stored once in the span header, which is
+ * found by aligning the object address. Hence, small objects have no
+ * header of their own. Each thread caches free objects per size class and
+ * exchanges them in batches with the spans of the class, which is the only
+ * place that needs a lock. Objects return to the free list of their span.
+ * Once all objects of a span are free, the span is handed back to the libc
+ * memory allocator. Large objects are allocated with a header at the libc
+ * memory allocator directly.
  */
 class Malloc : public Genode::Allocator
 {
 	private:
 
 		enum {
-			SLAB_START = 2,  /* 4 Byte (log2) */
-			SLAB_STOP  = 11, /* 2048 Byte (log2) */
-			NUM_SLABS = (SLAB_STOP - SLAB_START) + 1
+			NUM_CLASSES = 28,     /* 16 ... 4096 bytes */
+			MAX_SMALL   = 4096,
+			CACHE_BYTES = 16*1024, /* upper bound of cache per thread and class */
+			MAX_THREADS = 64,
+			ALIGN_LOG2  = 4,
+			SPAN_HEADER = (1 << ALIGN_LOG2)*4,
+		};
+
+		struct Free_object { Free_object *next; };
+
+		/**
+		 * Header at the start of each span
+		 *
+		 * All members but 'cls' are protected by the lock of the size
+		 * class.
+		 */
+		struct Span
+		{
+			unsigned     cls;
+			unsigned     used;  /* objects not in the free list of the span */
+			Free_object *free;
+			Span        *prev;  /* list of spans with free objects */
+			Span        *next;
 		};
 
-		Genode::Allocator  *_backing_store;        /* back-end allocator */
-		Genode::Slab_alloc *_allocator[NUM_SLABS]; /* slab allocators */
-		Genode::Lock        _lock;
+		static_assert(sizeof(Span) <= SPAN_HEADER, "span header too large");
+
+		/**
+		 * Header in front of each large object
+		 */
+		struct Large_header
+		{
+			size_t size;
+			char   pad[(1 << ALIGN_LOG2) - sizeof(size_t)];
+		};
+
+		struct Size_class
+		{
+			Genode::Lock lock;
+			Span        *partial   = nullptr; /* spans with free objects */
+			Span        *bump_span = nullptr; /* span carved on demand */
+			char        *bump      = nullptr; /* unused part of 'bump_span' */
+			char        *bump_end  = nullptr;
+		};
+
+		struct Thread_cache
+		{
+			Free_object *free[NUM_CLASSES];
+			unsigned     count[NUM_CLASSES];
+		};
+
+		enum Slot_state { UNUSED, USED, RELEASED };
+
+		Span_map     _spans;
+		Size_class   _classes[NUM_CLASSES];
+
+		/*
+		 * The main thread has no 'Thread_base' object and uses a cache of
+		 * its own. Other threads get a slot found via open addressing by
+		 * their 'Thread_base' pointer. Slots are assigned with '_slot_lock'
+		 * held and looked up without lock. An exiting thread releases its
+		 * slot via 'release_thread_cache'. The memory of a released cache
+		 * is reused for the next thread that gets the slot.
+		 */
+		Thread_cache                *_main_cache = nullptr;
+		Genode::Lock                 _slot_lock;
+		Genode::Thread_base *        _owners[MAX_THREADS];
+		Thread_cache *               _caches[MAX_THREADS];
+		Slot_state volatile          _states[MAX_THREADS];
+
+		static size_t _class_size(unsigned c)
+		{
+			/* steps of 16 bytes up to 128, four classes per power of two above */
+			if (c < 8)
+				return (c + 1)*16;
+
+			unsigned const msb = 7 + (c - 8)/4;
+			return (size_t)(5 + (c - 8) % 4) << (msb - 2);
+		}
+
+		static unsigned _class(size_t size)
+		{
+			if (size <= 128)
+				return size ? (size - 1)/16 : 0;
+
+			unsigned const msb = Genode::log2(size - 1);
+			return 8 + (msb - 7)*4 + ((size - 1) >> (msb - 2)) - 4;
+		}
+
+		static unsigned _cache_limit(unsigned c)
+		{
+			return Genode::max(CACHE_BYTES / _class_size(c), (size_t)4);
+		}
+
+		static Span *_span(void const *ptr)
+		{
+			return (Span *)((addr_t)ptr & ~(Span_map::SPAN_SIZE - 1));
+		}
+
+		Thread_cache *_alloc_cache()
+		{
+			void *cache = Libc::mem_alloc()->alloc(sizeof(Thread_cache), ALIGN_LOG2);
+			if (!cache)
+				return nullptr;
+
+			Genode::memset(cache, 0, sizeof(Thread_cache));
+			return (Thread_cache *)cache;
+		}
+
+		static unsigned _hash(Genode::Thread_base const *t) {
+			return ((addr_t)t / sizeof(addr_t)) % MAX_THREADS; }
+
+		/**
+		 * Return cache of calling thread, or nullptr if none is available
+		 */
+		Thread_cache *_thread_cache()
+		{
+			Genode::Thread_base * const myself = Genode::Thread_base::myself();
+			if (!myself) {
+				if (!_main_cache)
+					_main_cache = _alloc_cache();
+				return _main_cache;
+			}
+
+			unsigned const start = _hash(myself);
+			for (unsigned i = start, n = 0; n < MAX_THREADS;
+			     i = (i + 1) % MAX_THREADS, n++) {
+
+				if (_states[i] == UNUSED)
+					break;
+
+				if (_states[i] == USED) {
+					Genode::memory_barrier();
+					if (_owners[i] == myself)
+						return _caches[i];
+				}
+			}
+
+			return _assign_thread_cache(myself);
+		}
+
+		Thread_cache *_assign_thread_cache(Genode::Thread_base *myself)
+		{
+			Genode::Lock::Guard guard(_slot_lock);
+
+			unsigned const start = _hash(myself);
+			for (unsigned i = start, n = 0; n < MAX_THREADS;
+			     i = (i + 1) % MAX_THREADS, n++) {
+
+				if (_states[i] == USED)
+					continue;
+
+				/* reuse memory of released cache, which is empty */
+				if (!_caches[i] && !(_caches[i] = _alloc_cache()))
+					return nullptr;
 
-		unsigned long _slab_log2(unsigned long size) const
+				_owners[i] = myself;
+				Genode::memory_barrier();
+				_states[i] = USED;
+				return _caches[i];
+			}
+			return nullptr;
+		}
+
+		static void _link(Size_class &sc, Span *span)
+		{
+			span->prev = nullptr;
+			span->next = sc.partial;
+			if (sc.partial)
+				sc.partial->prev = span;
+			sc.partial = span;
+		}
+
+		static void _unlink(Size_class &sc, Span *span)
 		{
-			unsigned msb = Genode::log2(size);
-			/* size is greater than msb */
-			if (size > (1U << msb))
-				msb++;
+			if (span->prev) span->prev->next = span->next;
+			else            sc.partial       = span->next;
 
-			/* use smallest slab */
-			if (size < (1U << SLAB_START))
-				msb = SLAB_START;
+			if (span->next) span->next->prev = span->prev;
+		}
+
+		/**
+		 * Hand span without used objects back to the memory allocator
+		 *
+		 * Must be called with the lock of the size class held.
+		 */
+		void _release(Size_class &sc, Span *span)
+		{
+			if (span->free)
+				_unlink(sc, span);
 
-			return msb;
+			_spans.remove((addr_t)span);
+			Libc::mem_alloc()->free(span);
+		}
+
+		/**
+		 * Allocate new span for size class
+		 *
+		 * Must be called with the lock of the size class held.
+		 */
+		bool _grow(unsigned c)
+		{
+			void *mem = Libc::mem_alloc()->alloc(Span_map::SPAN_SIZE,
+			                                     Span_map::SPAN_SHIFT);
+			if (!mem)
+				return false;
+
+			if (!_spans.insert((addr_t)mem)) {
+				Libc::mem_alloc()->free(mem);
+				return false;
+			}
+
+			Span *span = (Span *)mem;
+			span->cls  = c;
+			span->used = 0;
+			span->free = nullptr;
+
+			Size_class &sc = _classes[c];
+
+			/* the former span was kept only for the rest of its memory */
+			if (sc.bump_span && !sc.bump_span->used)
+				_release(sc, sc.bump_span);
+
+			sc.bump_span = span;
+			sc.bump      = (char *)mem + SPAN_HEADER;
+			sc.bump_end  = (char *)mem + Span_map::SPAN_SIZE;
+			return true;
+		}
+
+		/**
+		 * Take up to 'count' objects of size class 'c' from the spans
+		 *
+		 * \return number of objects prepended to the list 'out'
+		 */
+		unsigned _refill(unsigned c, Free_object *&out, unsigned count)
+		{
+			Size_class &sc   = _classes[c];
+			size_t const size = _class_size(c);
+			unsigned n = 0;
+
+			Genode::Lock::Guard guard(sc.lock);
+
+			while (n < count && sc.partial) {
+				Span *span = sc.partial;
+
+				for (; n < count && span->free; n++, span->used++) {
+					Free_object *o = span->free;
+					span->free = o->next;
+					o->next = out, out = o;
+				}
+
+				if (!span->free)
+					_unlink(sc, span);
+			}
+
+			for (; n < count; n++) {
+				if (sc.bump + size > sc.bump_end && !_grow(c))
+					break;
+
+				Free_object *o = (Free_object *)sc.bump;
+				sc.bump += size;
+				sc.bump_span->used++;
+				o->next = out, out = o;
+			}
+			return n;
+		}
+
+		/**
+		 * Hand 'count' objects of the list 'list' back to their spans
+		 */
+		void _flush(unsigned c, Free_object *&list, unsigned count)
+		{
+			Size_class &sc = _classes[c];
+			Genode::Lock::Guard guard(sc.lock);
+
+			for (; count; count--) {
+				Free_object *o = list;
+				list = o->next;
+
+				Span *span = _span(o);
+				if (!span->free)
+					_link(sc, span);
+
+				o->next    = span->free;
+				span->free = o;
+
+				/* keep the span that is still carved */
+				if (!--span->used && span != sc.bump_span)
+					_release(sc, span);
+			}
+		}
+
+		void *_alloc_large(size_t size)
+		{
+			void *mem = Libc::mem_alloc()->alloc(size + sizeof(Large_header),
+			                                     ALIGN_LOG2);
+			if (!mem || mem == (void *)-1)
+				return nullptr;
+
+			Large_header *h = (Large_header *)mem;
+			h->size = size;
+			return h + 1;
 		}
 
 	public:
 
-		Malloc(Genode::Allocator *backing_store) : _backing_store(backing_store)
+		Malloc()
 		{
-			for (unsigned i = SLAB_START; i <= SLAB_STOP; i++) {
-				_allocator[i - SLAB_START] = new (backing_store)
-				                                 Genode::Slab_alloc(1U << i, backing_store);
+			for (unsigned i = 0; i < MAX_THREADS; i++) {
+				_owners[i] = nullptr;
+				_caches[i] = nullptr;
+				_states[i] = UNUSED;
 			}
 		}
 
 		~Malloc() { PDBG("CALLED"); }
 
 		/**
-		 * Allocator interface
+		 * Hand the objects cached by the calling thread back to the spans
+		 *
+		 * Called by a thread that is about to exit.
 		 */
+		void release_thread_cache()
+		{
+			Genode::Thread_base * const myself = Genode::Thread_base::myself();
+			if (!myself)
+				return;
 
-		bool alloc(size_t size, void **out_addr) override
+			Genode::Lock::Guard guard(_slot_lock);
+
+			for (unsigned i = 0; i < MAX_THREADS; i++) {
+				if (_states[i] != USED || _owners[i] != myself)
+					continue;
+
+				Thread_cache &cache = *_caches[i];
+				for (unsigned c = 0; c < NUM_CLASSES; c++) {
+					_flush(c, cache.free[c], cache.count[c]);
+					cache.count[c] = 0;
+				}
+
+				_states[i] = RELEASED;
+				return;
+			}
+		}
+
+		/**
+		 * Return usable size of the allocated block at 'ptr'
+		 */
+		size_t size_at(void const *ptr) const
 		{
-			Genode::Lock::Guard lock_guard(_lock);
+			if (_spans.contains((addr_t)_span(ptr)))
+				return _class_size(_span(ptr)->cls);
+
+			return ((Large_header const *)ptr - 1)->size;
+		}
 
-			/* enforce size to be a multiple of 4 bytes */
-			size = (size + 3) & ~3;
+		/**
+		 * Allocator interface
+		 */
 
-			/*
-			 * We store the size of the allocation at the very
-			 * beginning of the allocated block and return
-			 * the subsequent address. This way, we can retrieve
-			 * the size information when freeing the block.
-			 */
-			unsigned long real_size = size + sizeof(Block_header);
-			unsigned long msb = _slab_log2(real_size);
-			void *addr = 0;
+		bool alloc(size_t size, void **out_addr) override
+		{
+			if (size > MAX_SMALL) {
+				void *addr = _alloc_large(size);
+				*out_addr = addr;
+				return addr != nullptr;
+			}
 
-			/* use backing store if requested memory is larger than largest slab */
-			if (msb > SLAB_STOP) {
+			unsigned const c = _class(size);
 
-				if (!(_backing_store->alloc(real_size, &addr)))
+			Thread_cache *cache = _thread_cache();
+			if (!cache) {
+				Free_object *o = nullptr;
+				if (!_refill(c, o, 1))
 					return false;
+				*out_addr = o;
+				return true;
 			}
-			else
-				if (!(addr = _allocator[msb - SLAB_START]->alloc()))
-					return false;
 
-			*(Block_header *)addr = real_size;
-			*out_addr = (Block_header *)addr + 1;
+			if (!cache->free[c])
+				cache->count[c] += _refill(c, cache->free[c],
+				                           _cache_limit(c)/2);
+
+			Free_object *o = cache->free[c];
+			if (!o)
+				return false;
+
+			cache->free[c] = o->next;
+			cache->count[c]--;
+			*out_addr = o;
 			return true;
 		}
 
 		void free(void *ptr, size_t /* size */) override
 		{
-			Genode::Lock::Guard lock_guard(_lock);
+			Span * const span = _span(ptr);
 
-			unsigned long *addr = ((unsigned long *)ptr) - 1;
-			unsigned long  real_size = *addr;
+			if (!_spans.contains((addr_t)span)) {
+				Libc::mem_alloc()->free((Large_header *)ptr - 1);
+				return;
+			}
+
+			unsigned const c = span->cls;
+			Free_object *o = (Free_object *)ptr;
+
+			Thread_cache *cache = _thread_cache();
+			if (!cache) {
+				o->next = nullptr;
+				_flush(c, o, 1);
+				return;
+			}
+
+			o->next = cache->free[c];
+			cache->free[c] = o;
 
-			if (real_size > (1U << SLAB_STOP))
-				_backing_store->free(addr, real_size);
-			else {
-				unsigned long msb = _slab_log2(real_size);
-				_allocator[msb - SLAB_START]->free(addr);
+			if (++cache->count[c] > _cache_limit(c)) {
+				unsigned const n = cache->count[c]/2;
+				_flush(c, cache->free[c], n);
+				cache->count[c] -= n;
 			}
 		}
 
 		size_t overhead(size_t size) const override
 		{
-			size += sizeof(Block_header);
-
-			if (size > (1U << SLAB_STOP))
-				return _backing_store->overhead(size);
+			if (size > MAX_SMALL)
+				return sizeof(Large_header);
 
-			return _allocator[_slab_log2(size) - SLAB_START]->overhead(size);
+			return _class_size(_class(size)) - size;
 		}
 
 		bool need_size_for_free() const override { return false; }
 };
 
 
-static Genode::Allocator *allocator()
+static Malloc *allocator()
 {
 	static bool constructed = 0;
-	static char placeholder[sizeof(Malloc)];
+	static char placeholder[sizeof(Malloc)] __attribute__((aligned(sizeof(addr_t))));
 	if (!constructed) {
-		Genode::construct_at<Malloc>(placeholder, Genode::env()->heap());
+		Genode::construct_at<Malloc>(placeholder);
 		constructed = 1;
 	}
 
@@ -182,6 +627,9 @@ static Genode::Allocator *allocator()
 }
 
 
+void Libc::release_thread_cache() { allocator()->release_thread_cache(); }
+
+
 extern "C" void *malloc(size_t size)
 {
 	void *addr;
@@ -191,8 +639,14 @@ extern "C" void *malloc(size_t size)
 
 extern "C" void *calloc(size_t nmemb, size_t size)
 {
+	if (size && nmemb > (size_t)~0UL / size) {
+		errno = ENOMEM;
+		return 0;
+	}
+
 	void *addr = malloc(nmemb*size);
-	Genode::memset(addr, 0, nmemb*size);
+	if (addr)
+		Genode::memset(addr, 0, nmemb*size);
 	return addr;
 }
 
@@ -215,9 +669,8 @@ extern "C" void *realloc(void *ptr, size_t size)
 		return 0;
 	}
 
-	/* determine size of old block content (without header) */
-	unsigned long old_size = *((Block_header *)ptr - 1)
-	                         - sizeof(Block_header);
+	/* determine usable size of old block */
+	size_t const old_size = allocator()->size_at(ptr);
 
 	/* do not reallocate if new size is less than the current size */
 	if (size <= old_size)
@@ -228,7 +681,7 @@ extern "C" void *realloc(void *ptr, size_t size)
 
 	/* copy content from old block into new block */
 	if (new_addr)
-		memcpy(new_addr, ptr, Genode::min(old_size, (unsigned long)size));
+		memcpy(new_addr, ptr, Genode::min(old_size, size));
 
 	/* free old block */
 	free(ptr);
@@ -112,6 +112,32 @@ bool Plugin::supports_select(int, fd_set *, fd_set *,
 }
 
 
+unsigned Plugin::ready(File_descriptor *fd, unsigned events)
+{
+	int const libc_fd = fd->libc_fd;
+	if (libc_fd < 0 || libc_fd >= (int)FD_SETSIZE)
+		return READY_UNKNOWN;
+
+	fd_set readfds, writefds, exceptfds;
+	FD_ZERO(&readfds);
+	FD_ZERO(&writefds);
+	FD_ZERO(&exceptfds);
+
+	if (events & READY_READ)   FD_SET(libc_fd, &readfds);
+	if (events & READY_WRITE)  FD_SET(libc_fd, &writefds);
+	if (events & READY_EXCEPT) FD_SET(libc_fd, &exceptfds);
+
+	struct timeval tv_0 = { 0, 0 };
+	if (!supports_select(libc_fd + 1, &readfds, &writefds, &exceptfds, &tv_0)
+	 || select(libc_fd + 1, &readfds, &writefds, &exceptfds, &tv_0) <= 0)
+		return 0;
+
+	return (FD_ISSET(libc_fd, &readfds)   ? READY_READ   : 0)
+	     | (FD_ISSET(libc_fd, &writefds)  ? READY_WRITE  : 0)
+	     | (FD_ISSET(libc_fd, &exceptfds) ? READY_EXCEPT : 0);
+}
+
+
 bool Plugin::supports_socket(int, int, int)
 {
 	return false;
@@ -1,111 +1,135 @@
 /*
  * \brief  poll() implementation
  * \author Josef Soentgen
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
  * \date   2012-07-12
  *
- * this 'poll()' implementation is based on OpenSSHp's and
- * uses our 'select()' function internally.
+ * File descriptors below 'FD_SETSIZE' are checked in one pass through the
+ * 'select' functions of the plugins, others are queried one by one.
  */
 
 /*
- * Copyright (C) 2010-2013 Genode Labs GmbH
+ * Copyright (C) 2010-2016 Genode Labs GmbH
  *
  * This file is part of the Genode OS framework, which is distributed
  * under the terms of the GNU General Public License version 2.
  */
 
 #include <base/printf.h>
-#include <os/timed_semaphore.h>
 
-#include <libc-plugin/plugin_registry.h>
+#include <libc-plugin/fd_alloc.h>
 #include <libc-plugin/plugin.h>
 
+#include <libc_ready.h>
+
 #include <sys/select.h>
 #include <sys/poll.h>
-#include <stdlib.h>
 
 using namespace Libc;
 
 
 /**
- * The poll function was taken from OpenSSH portable (bsd-poll.c) and adepted
- * to better fit within Genode's libc.
- *
- * Copyright (c) 2004, 2005, 2007 Darren Tucker (dtucker at zip com au).
- *
- * Permission to use, copy, modify, and distribute this software for any
- * purpose with or without fee is hereby granted, provided that the above
- * copyright notice and this permission notice appear in all copies.
+ * Fill in 'revents' of all entries
  *
- * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
- * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
- * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
- * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
- * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
- * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
- * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * \return number of entries with events
  */
-extern "C" int
-__attribute__((weak))
-poll(struct pollfd fds[], nfds_t nfds, int timeout)
+static int poll_scan(struct pollfd fds[], nfds_t nfds)
 {
-	nfds_t i;
-	int ret, fd, maxfd = 0;
+	fd_set in_readfds, in_writefds, in_exceptfds;
 	fd_set readfds, writefds, exceptfds;
-	struct timeval tv, *tvp = NULL;
 
-	for (i = 0; i < nfds; i++) {
-		fd = fds[i].fd;
-		if (fd >= (int)FD_SETSIZE) {
-			/*errno = EINVAL;*/
-			return -1;
-		}
-		maxfd = MAX(maxfd, fd);
-	}
+	FD_ZERO(&in_readfds);
+	FD_ZERO(&in_writefds);
+	FD_ZERO(&in_exceptfds);
 
-	/* populate event bit vectors for the events we're interested in */
-	for (i = 0; i < nfds; i++) {
-		fd = fds[i].fd;
-		if (fd == -1)
+	int maxfd = -1;
+	for (nfds_t i = 0; i < nfds; i++) {
+		int const fd = fds[i].fd;
+		if (fd < 0 || fd >= (int)FD_SETSIZE)
 			continue;
-		if (fds[i].events & POLLIN) {
-			FD_SET(fd, &readfds);
-			FD_SET(fd, &exceptfds);
-		}
-		if (fds[i].events & POLLOUT) {
-			FD_SET(fd, &writefds);
-			FD_SET(fd, &exceptfds);
-		}
-	}
 
-	/* poll timeout is msec, select is timeval (sec + usec) */
-	if (timeout >= 0) {
-		tv.tv_sec = timeout / 1000;
-		tv.tv_usec = (timeout % 1000) * 1000;
-		tvp = &tv;
+		if (fds[i].events & (POLLIN | POLLRDNORM))
+			FD_SET(fd, &in_readfds);
+		if (fds[i].events & (POLLOUT | POLLWRNORM))
+			FD_SET(fd, &in_writefds);
+		FD_SET(fd, &in_exceptfds);
+
+		maxfd = Genode::max(maxfd, fd);
 	}
-	ret = select(maxfd + 1, &readfds, &writefds, &exceptfds, tvp);
-	/*saved_errno = errno;*/
-	/* scan through select results and set poll() flags */
-	for (i = 0; i < nfds; i++) {
-		fd = fds[i].fd;
+
+	if (maxfd >= 0)
+		select_scan(maxfd + 1, &in_readfds, &in_writefds, &in_exceptfds,
+		            &readfds, &writefds, &exceptfds);
+
+	int nready = 0;
+	for (nfds_t i = 0; i < nfds; i++) {
+		int const fd = fds[i].fd;
+
 		fds[i].revents = 0;
-		if (fd == -1)
+		if (fd < 0)
+			continue;
+
+		if (!file_descriptor_allocator()->find_by_libc_fd(fd)) {
+			fds[i].revents = POLLNVAL;
+			nready++;
 			continue;
-		if (FD_ISSET(fd, &readfds)) {
-			fds[i].revents |= POLLIN;
 		}
-		if (FD_ISSET(fd, &writefds)) {
-			fds[i].revents |= POLLOUT;
+
+		unsigned ready = 0;
+		if (fd < (int)FD_SETSIZE) {
+			ready = (FD_ISSET(fd, &readfds)   ? Plugin::READY_READ   : 0)
+			      | (FD_ISSET(fd, &writefds)  ? Plugin::READY_WRITE  : 0)
+			      | (FD_ISSET(fd, &exceptfds) ? Plugin::READY_EXCEPT : 0);
+		} else {
+			unsigned events = Plugin::READY_EXCEPT;
+			if (fds[i].events & (POLLIN | POLLRDNORM))
+				events |= Plugin::READY_READ;
+			if (fds[i].events & (POLLOUT | POLLWRNORM))
+				events |= Plugin::READY_WRITE;
+
+			ready = Libc::ready(fd, events);
 		}
-		if (FD_ISSET(fd, &exceptfds)) {
-			fds[i].revents |= POLLERR;
+
+		if (ready & Plugin::READY_UNKNOWN) {
+			fds[i].revents = POLLNVAL;
+			nready++;
+			continue;
 		}
+
+		if (ready & Plugin::READY_READ)
+			fds[i].revents |= fds[i].events & (POLLIN | POLLRDNORM);
+		if (ready & Plugin::READY_WRITE)
+			fds[i].revents |= fds[i].events & (POLLOUT | POLLWRNORM);
+		if (ready & Plugin::READY_EXCEPT)
+			fds[i].revents |= POLLERR;
+
+		if (fds[i].revents)
+			nready++;
 	}
 
-	/*
-	if (ret == -1)
-		errno = saved_errno;
-	*/
-	return ret;
+	return nready;
+}
+
+
+extern "C" int
+__attribute__((weak))
+poll(struct pollfd fds[], nfds_t nfds, int timeout)
+{
+	int nready = poll_scan(fds, nfds);
+	if (nready || timeout == 0)
+		return nready;
+
+	Genode::Alarm::Time msectimeout = timeout;
+
+	Ready_waiter waiter;
+	for (;;) {
+		waiter.rearm();
+
+		nready = poll_scan(fds, nfds);
+		if (nready)
+			return nready;
+
+		if (!waiter.block(timeout > 0 ? &msectimeout : 0))
+			return 0;
+	}
 }
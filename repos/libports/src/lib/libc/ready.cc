@@ -0,0 +1,150 @@
+/*
+ * \brief  Readiness notification of file descriptors
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-19
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+/* Genode includes */
+#include <base/printf.h>
+
+/* libc plugin interface */
+#include <libc-plugin/fd_alloc.h>
+#include <libc-plugin/plugin_registry.h>
+#include <libc-plugin/plugin.h>
+
+/* libc-internal includes */
+#include <libc_ready.h>
+
+
+static void select_notify() { Libc::ready_core()->notify_all(); }
+
+
+/*
+ * Function called by plugins that cannot name the file descriptor that
+ * became ready, e.g., lwIP
+ */
+void (*libc_select_notify)() __attribute__((weak)) = select_notify;
+
+
+Libc::Ready_core *Libc::ready_core()
+{
+	static Ready_core core;
+	return &core;
+}
+
+
+void Libc::Ready_core::notify(int libc_fd)
+{
+	Genode::Lock::Guard guard(_lock);
+
+	for (Ready_watch *w = _bucket(libc_fd).first(); w; w = w->next())
+		if (w->libc_fd == libc_fd && !w->listener.any_fd())
+			w->listener.notified(w);
+
+	for (Ready_listener *l = _listeners.first(); l; l = l->next())
+		if (l->any_fd())
+			l->notified(nullptr);
+}
+
+
+void Libc::Ready_core::notify_all()
+{
+	Genode::Lock::Guard guard(_lock);
+
+	for (Ready_listener *l = _listeners.first(); l; l = l->next())
+		l->notified(nullptr);
+}
+
+
+void Libc::Ready_core::forget(int libc_fd)
+{
+	Genode::Lock::Guard guard(_lock);
+
+	Genode::List<Ready_watch> &bucket = _bucket(libc_fd);
+	for (Ready_watch *w = bucket.first(), *next; w; w = next) {
+		next = w->next();
+		if (w->libc_fd != libc_fd)
+			continue;
+
+		bucket.remove(w);
+		w->listener.closed(*w);
+	}
+}
+
+
+int Libc::select_scan(int nfds, fd_set *in_readfds, fd_set *in_writefds,
+                      fd_set *in_exceptfds, fd_set *out_readfds,
+                      fd_set *out_writefds, fd_set *out_exceptfds)
+{
+	int nready = 0;
+
+	 /* zero timeout for polling of the plugins' select() functions */
+	struct timeval tv_0 = {0, 0};
+
+	/* temporary fd sets that are passed to the plugins */
+	fd_set plugin_readfds;
+	fd_set plugin_writefds;
+	fd_set plugin_exceptfds;
+	int plugin_nready;
+
+	if (out_readfds)
+		FD_ZERO(out_readfds);
+	if (out_writefds)
+		FD_ZERO(out_writefds);
+	if (out_exceptfds)
+		FD_ZERO(out_exceptfds);
+
+	for (Plugin *plugin = plugin_registry()->first(); plugin; plugin = plugin->next()) {
+		if (plugin->supports_select(nfds, in_readfds, in_writefds, in_exceptfds, &tv_0)) {
+
+			plugin_readfds = *in_readfds;
+			plugin_writefds = *in_writefds;
+			plugin_exceptfds = *in_exceptfds;
+
+			plugin_nready = plugin->select(nfds, &plugin_readfds, &plugin_writefds, &plugin_exceptfds, &tv_0);
+
+			if (plugin_nready > 0) {
+				for (int libc_fd = 0; libc_fd < nfds; libc_fd++) {
+					if (out_readfds && FD_ISSET(libc_fd, &plugin_readfds)) {
+						FD_SET(libc_fd, out_readfds);
+					}
+					if (out_writefds && FD_ISSET(libc_fd, &plugin_writefds)) {
+						FD_SET(libc_fd, out_writefds);
+					}
+					if (out_exceptfds && FD_ISSET(libc_fd, &plugin_exceptfds)) {
+						FD_SET(libc_fd, out_exceptfds);
+					}
+				}
+				nready += plugin_nready;
+			} else if (plugin_nready < 0) {
+				PERR("plugin->select() returned error value %d", plugin_nready);
+			}
+		}
+	}
+
+	return nready;
+}
+
+
+unsigned Libc::ready(int libc_fd, unsigned events)
+{
+	File_descriptor *fd = file_descriptor_allocator()->find_by_libc_fd(libc_fd);
+	if (!fd || !fd->plugin)
+		return 0;
+
+	return fd->plugin->ready(fd, events);
+}
+
+
+void Libc::notify_ready(File_descriptor *fd)
+{
+	if (fd)
+		ready_core()->notify(fd->libc_fd);
+}
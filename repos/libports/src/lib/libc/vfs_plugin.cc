@@ -14,7 +14,9 @@
 /* Genode includes */
 #include <base/env.h>
 #include <base/printf.h>
+#include <dataspace/client.h>
 #include <vfs/dir_file_system.h>
+#include <vfs/rom_file_system.h>
 #include <os/config.h>
 
 /* libc includes */
@@ -159,6 +161,36 @@ class Libc::Vfs_plugin : public Libc::Plugin
 
 		Vfs::Dir_file_system _root_dir;
 
+		/**
+		 * Memory-mapped file region
+		 */
+		struct Mapping : Genode::List<Mapping>::Element
+		{
+			void * const         addr;
+			Vfs::Absolute_path   path;
+
+			/* dataspace obtained from the VFS, invalid for a copy */
+			Genode::Dataspace_capability ds;
+
+			/* handle used to write back a shared writeable mapping */
+			Vfs::Vfs_handle     *handle = nullptr;
+			::off_t              offset = 0;
+			::size_t             count  = 0; /* bytes backed by the file */
+
+			Mapping(void *addr, char const *path,
+			        Genode::Dataspace_capability ds)
+			: addr(addr), path(path), ds(ds) { }
+		};
+
+		Genode::List<Mapping> _mappings;
+		Genode::Lock          _mappings_lock;
+
+		void *_attach_vfs_dataspace(char const *path, ::size_t length,
+		                            bool writeable, ::off_t offset,
+		                            Genode::Dataspace_capability &ds);
+
+		void _write_back(Mapping &mapping);
+
 		Genode::Xml_node _vfs_config()
 		{
 			try {
@@ -807,10 +839,68 @@ int Libc::Vfs_plugin::rename(char const *from_path, char const *to_path)
 }
 
 
+/**
+ * Attach the dataspace the VFS provides for the file at 'path'
+ *
+ * Returns the local address or 0 if the file system cannot provide a
+ * dataspace suitable for the mapping, in particular if the dataspace does
+ * not cover the whole mapping.
+ */
+void *Libc::Vfs_plugin::_attach_vfs_dataspace(char const *path,
+                                              ::size_t length, bool writeable,
+                                              ::off_t offset,
+                                              Genode::Dataspace_capability &ds)
+{
+	ds = _root_dir.dataspace(path);
+	if (!ds.valid())
+		return 0;
+
+	Genode::Dataspace_client ds_client(ds);
+	::size_t const ds_size = ds_client.size();
+
+	::size_t const map_size = Genode::align_addr(length, PAGE_SHIFT);
+
+	/* ROM modules cannot be mapped writeable */
+	if ((writeable && !ds_client.writable())
+	 || (::size_t)offset >= ds_size || map_size > ds_size - offset) {
+		_root_dir.release(path, ds);
+		return 0;
+	}
+
+	try {
+		return Genode::env()->rm_session()->attach(ds, map_size, offset);
+	} catch (...) {
+		_root_dir.release(path, ds);
+		return 0;
+	}
+}
+
+
+void Libc::Vfs_plugin::_write_back(Mapping &mapping)
+{
+	Vfs::Vfs_handle *handle = mapping.handle;
+	char const      *src    = (char const *)mapping.addr;
+
+	handle->seek(mapping.offset);
+	for (::size_t done = 0; done < mapping.count; ) {
+
+		Vfs::file_size out_count = 0;
+		if (handle->fs().write(handle, src + done, mapping.count - done,
+		                       out_count) != Vfs::File_io_service::WRITE_OK
+		 || out_count == 0) {
+			PERR("could not write back mapping of %s", mapping.path.base());
+			return;
+		}
+		handle->advance_seek(out_count);
+		done += out_count;
+	}
+}
+
+
 void *Libc::Vfs_plugin::mmap(void *addr_in, ::size_t length, int prot, int flags,
                              Libc::File_descriptor *fd, ::off_t offset)
 {
-	if (prot != PROT_READ) {
+	if (!(prot & PROT_READ) || (prot & ~(PROT_READ | PROT_WRITE | PROT_EXEC))) {
 		PERR("mmap for prot=%x not supported", prot);
 		errno = EACCES;
 		return (void *)-1;
@@ -822,31 +912,112 @@ void *Libc::Vfs_plugin::mmap(void *addr_in, ::size_t length, int prot, int flags
 		return (void *)-1;
 	}
 
+	if (offset < 0 || (offset & ((1 << PAGE_SHIFT) - 1)) || !length) {
+		errno = EINVAL;
+		return (void *)-1;
+	}
+
+	bool const writeable = prot & PROT_WRITE;
+	bool const shared    = flags & MAP_SHARED;
+	char const *path     = fd->fd_path;
+
 	/*
-	 * XXX attempt to obtain memory mapping via
-	 *     'Vfs::Directory_service::dataspace'.
+	 * A shared writeable mapping is written back via a handle of its own
+	 * because the file descriptor may be closed before 'munmap'.
 	 */
+	Vfs::Vfs_handle *handle = nullptr;
+	if (writeable && shared) {
+		if (_root_dir.open(path, O_RDWR, &handle)
+		    != Vfs::Directory_service::OPEN_OK) {
+			errno = EACCES;
+			return (void *)-1;
+		}
+	}
 
-	void *addr = Libc::mem_alloc()->alloc(length, PAGE_SHIFT);
-	if (addr == (void *)-1) {
-		errno = ENOMEM;
-		return (void *)-1;
+	struct stat st;
+	::off_t const size = fstat(fd, &st) == 0 ? st.st_size : 0;
+
+	/*
+	 * The dataspace of a ROM module is attached directly. Other file
+	 * systems copy the whole file into a dataspace, which is worthwhile
+	 * only if the mapping covers the whole file. Otherwise, only the
+	 * mapped part is copied via 'pread'. Dataspaces filled by the file
+	 * system are freshly allocated and thereby zeroed beyond the end of
+	 * the file.
+	 */
+	bool const rom        = dynamic_cast<Vfs::Rom_file_system *>(&vfs_handle(fd)->ds());
+	bool const whole_file = offset == 0 && (::off_t)length >= size;
+
+	Genode::Dataspace_capability ds;
+	void *addr = path && (rom || whole_file)
+	           ? _attach_vfs_dataspace(path, length, writeable, offset, ds) : 0;
+	if (!addr) {
+		ds   = Genode::Dataspace_capability();
+		addr = Libc::mem_alloc()->alloc(length, PAGE_SHIFT);
+		if (addr == (void *)-1 || !addr) {
+			if (handle) handle->ds().close(handle);
+			errno = ENOMEM;
+			return (void *)-1;
+		}
+
+		::ssize_t const n = ::pread(fd->libc_fd, addr, length, offset);
+		if (n < 0) {
+			PERR("mmap could not obtain file content");
+			Libc::mem_alloc()->free(addr);
+			if (handle) handle->ds().close(handle);
+			errno = EACCES;
+			return (void *)-1;
+		}
+
+		/* the part of the mapping beyond the end of the file reads as zero */
+		Genode::memset((char *)addr + n, 0, length - n);
 	}
 
-	if (::pread(fd->libc_fd, addr, length, offset) < 0) {
-		PERR("mmap could not obtain file content");
-		::munmap(addr, length);
-		errno = EACCES;
-		return (void *)-1;
+	Mapping *mapping = new (Genode::env()->heap())
+		Mapping(addr, path ? path : "", ds);
+
+	if (handle) {
+		mapping->handle = handle;
+		mapping->offset = offset;
+		mapping->count  = size > offset
+		                ? Genode::min(length, (::size_t)(size - offset)) : 0;
 	}
 
+	Genode::Lock::Guard guard(_mappings_lock);
+	_mappings.insert(mapping);
 	return addr;
 }
 
 
 int Libc::Vfs_plugin::munmap(void *addr, ::size_t)
 {
-	Libc::mem_alloc()->free(addr);
+	Mapping *mapping = nullptr;
+	{
+		Genode::Lock::Guard guard(_mappings_lock);
+		for (mapping = _mappings.first(); mapping; mapping = mapping->next())
+			if (mapping->addr == addr)
+				break;
+
+		if (!mapping) {
+			errno = EINVAL;
+			return -1;
+		}
+		_mappings.remove(mapping);
+	}
+
+	if (mapping->handle) {
+		_write_back(*mapping);
+		mapping->handle->ds().close(mapping->handle);
+	}
+
+	if (mapping->ds.valid()) {
+		Genode::env()->rm_session()->detach(addr);
+		_root_dir.release(mapping->path.base(), mapping->ds);
+	} else {
+		Libc::mem_alloc()->free(addr);
+	}
+
+	destroy(Genode::env()->heap(), mapping);
 	return 0;
 }
 
@@ -26,10 +26,6 @@
 #include <libc-plugin/plugin.h>
 
 
-/* function to notify libc about a socket event */
-extern void (*libc_select_notify)();
-
-
 namespace {
 
 
@@ -99,6 +95,7 @@ namespace {
 			int fcntl(Libc::File_descriptor *pipefdo, int cmd, long arg);
 			int pipe(Libc::File_descriptor *pipefdo[2]);
 			ssize_t read(Libc::File_descriptor *pipefdo, void *buf, ::size_t count);
+			unsigned ready(Libc::File_descriptor *pipefdo, unsigned events);
 			int select(int nfds, fd_set *readfds, fd_set *writefds,
 			           fd_set *exceptfds, struct timeval *timeout);
 			ssize_t write(Libc::File_descriptor *pipefdo, const void *buf, ::size_t count);
@@ -285,6 +282,22 @@ namespace {
 	}
 
 
+	unsigned Plugin::ready(Libc::File_descriptor *fdo, unsigned events)
+	{
+		unsigned result = 0;
+
+		if ((events & READY_READ) && is_read_end(fdo) &&
+		    (*context(fdo)->lock_state() == Genode::Lock::UNLOCKED))
+			result |= READY_READ;
+
+		/* currently the write end is always ready for writing */
+		if (events & READY_WRITE)
+			result |= READY_WRITE;
+
+		return result;
+	}
+
+
 	/* no support for execptfds right now */
 	int Plugin::select(int nfds,
 	                   fd_set *readfds,
@@ -345,8 +358,7 @@ namespace {
 		context(fdo)->set_lock_state(Genode::Lock::UNLOCKED);
 		context(fdo)->lock()->unlock();
 
-		if (libc_select_notify)
-			libc_select_notify();
+		Libc::notify_ready(context(fdo)->partner());
 
 		return 0;
 	}
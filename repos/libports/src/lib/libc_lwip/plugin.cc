@@ -6,7 +6,7 @@
  */
 
 /*
- * Copyright (C) 2010-2013 Genode Labs GmbH
+ * Copyright (C) 2010-2016 Genode Labs GmbH
  *
  * This file is part of the Genode OS framework, which is distributed
  * under the terms of the GNU General Public License version 2.
@@ -28,6 +28,9 @@
 /* the extern "C" declaration is missing in lwip/netdb.h */
 extern "C" {
 #include <lwip/netdb.h>
+
+/* function called by lwip on events of a specific socket */
+extern void (*libc_select_notify_socket)(int s);
 }
 #include <lwip/genode.h>
 #include <lwip/sockets.h>
@@ -155,6 +158,65 @@ static inline int get_lwip_fd(Libc::File_descriptor *sockfdo)
 }
 
 
+/**
+ * Libc file descriptors of the lwip sockets
+ *
+ * lwip reports socket events from its own thread by naming the lwip
+ * socket. The registry maps the socket to the libc file descriptor so that
+ * only the threads waiting for this descriptor are woken up.
+ */
+class Socket_registry
+{
+	private:
+
+		enum { MAX_SOCKETS = MEMP_NUM_NETCONN };
+
+		Genode::Lock           _lock;
+		Libc::File_descriptor *_fds[MAX_SOCKETS];
+
+		static bool _valid(int lwip_fd) {
+			return lwip_fd >= 0 && lwip_fd < MAX_SOCKETS; }
+
+	public:
+
+		Socket_registry() { Genode::memset(_fds, 0, sizeof(_fds)); }
+
+		void insert(int lwip_fd, Libc::File_descriptor *fd)
+		{
+			Genode::Lock::Guard guard(_lock);
+
+			if (_valid(lwip_fd))
+				_fds[lwip_fd] = fd;
+		}
+
+		void remove(int lwip_fd) { insert(lwip_fd, 0); }
+
+		/**
+		 * Notify the waiters for the descriptor of the lwip socket
+		 *
+		 * The lock is held during the notification so that the descriptor
+		 * cannot be freed meanwhile.
+		 */
+		void notify(int lwip_fd)
+		{
+			Genode::Lock::Guard guard(_lock);
+
+			if (_valid(lwip_fd))
+				Libc::notify_ready(_fds[lwip_fd]);
+		}
+};
+
+
+static Socket_registry *socket_registry()
+{
+	static Socket_registry inst;
+	return &inst;
+}
+
+
+static void notify_socket(int lwip_fd) { socket_registry()->notify(lwip_fd); }
+
+
 struct Plugin : Libc::Plugin
 {
 	/**
@@ -173,6 +235,8 @@ struct Plugin : Libc::Plugin
 	                     struct timeval *timeout);
 	bool supports_socket(int domain, int type, int protocol);
 
+	unsigned ready(Libc::File_descriptor *fdo, unsigned events);
+
 	Libc::File_descriptor *accept(Libc::File_descriptor *sockfdo,
 	                              struct sockaddr *addr,
 	                              socklen_t *addrlen);
@@ -272,6 +336,34 @@ bool Plugin::supports_socket(int domain, int, int)
 }
 
 
+unsigned Plugin::ready(Libc::File_descriptor *fdo, unsigned events)
+{
+	/* lwip socket numbers are small regardless of the libc fd */
+	int const lwip_fd = get_lwip_fd(fdo);
+
+	lwip_fd_set lwip_readfds;
+	lwip_fd_set lwip_writefds;
+	lwip_fd_set lwip_exceptfds;
+
+	lwip_FD_ZERO(&lwip_readfds);
+	lwip_FD_ZERO(&lwip_writefds);
+	lwip_FD_ZERO(&lwip_exceptfds);
+
+	if (events & READY_READ)   lwip_FD_SET(lwip_fd, &lwip_readfds);
+	if (events & READY_WRITE)  lwip_FD_SET(lwip_fd, &lwip_writefds);
+	if (events & READY_EXCEPT) lwip_FD_SET(lwip_fd, &lwip_exceptfds);
+
+	struct lwip_timeval tv_0 = { 0, 0 };
+	if (lwip_select(lwip_fd + 1, &lwip_readfds, &lwip_writefds,
+	                &lwip_exceptfds, &tv_0) <= 0)
+		return 0;
+
+	return (lwip_FD_ISSET(lwip_fd, &lwip_readfds)   ? READY_READ   : 0)
+	     | (lwip_FD_ISSET(lwip_fd, &lwip_writefds)  ? READY_WRITE  : 0)
+	     | (lwip_FD_ISSET(lwip_fd, &lwip_exceptfds) ? READY_EXCEPT : 0);
+}
+
+
 Libc::File_descriptor *Plugin::accept(Libc::File_descriptor *sockfdo,
                                            struct sockaddr *addr, socklen_t *addrlen)
 {
@@ -286,6 +378,8 @@ Libc::File_descriptor *Plugin::accept(Libc::File_descriptor *sockfdo,
 
 	if (!fd)
 		PERR("could not allocate file descriptor");
+	else
+		socket_registry()->insert(lwip_fd, fd);
 
 	return fd;
 }
@@ -300,6 +394,8 @@ int Plugin::bind(Libc::File_descriptor *sockfdo, const struct sockaddr *addr,
 
 int Plugin::close(Libc::File_descriptor *fdo)
 {
+	socket_registry()->remove(get_lwip_fd(fdo));
+
 	int result = lwip_close(get_lwip_fd(fdo));
 
 	if (context(fdo))
@@ -571,7 +667,12 @@ Libc::File_descriptor *Plugin::socket(int domain, int type, int protocol)
 	}
 
 	Plugin_context *context = new (Genode::env()->heap()) Plugin_context(lwip_fd);
-	return Libc::file_descriptor_allocator()->alloc(this, context);
+	Libc::File_descriptor *fd = Libc::file_descriptor_allocator()->alloc(this, context);
+
+	if (fd)
+		socket_registry()->insert(lwip_fd, fd);
+
+	return fd;
 }
 
 
@@ -587,4 +688,8 @@ ssize_t Plugin::write(Libc::File_descriptor *fdo, const void *buf, ::size_t coun
 void create_lwip_plugin()
 {
 	static Plugin lwip_plugin;
+
+	/* construct the registry before lwip calls into it */
+	socket_registry();
+	libc_select_notify_socket = notify_socket;
 }
@@ -5,7 +5,7 @@
  */
 
 /*
- * Copyright (C) 2011-2013 Genode Labs GmbH
+ * Copyright (C) 2011-2016 Genode Labs GmbH
  *
  * This file is part of the Genode OS framework, which is distributed
  * under the terms of the GNU General Public License version 2.
@@ -29,14 +29,20 @@
 #include <base/thread.h>
 
 
-extern void (*libc_select_notify)();
-
-
 namespace {
 
 	typedef Genode::Thread<4096> Read_sigh_thread;
 
 
+	/**
+	 * Signal context of a terminal connection
+	 */
+	struct Read_avail_context : Genode::Signal_context
+	{
+		Libc::File_descriptor *fd = nullptr;
+	};
+
+
 	/**
 	 * Thread for receiving notifications about data available for reading
 	 * from terminal session
@@ -45,50 +51,41 @@ namespace {
 	{
 		private:
 
-			Genode::Lock _startup_lock;
-
-			Genode::Signal_context            _sig_ctx;
-			Genode::Signal_receiver           _sig_rec;
-			Genode::Signal_context_capability _sig_cap;
+			Genode::Signal_receiver _sig_rec;
 
 			void entry()
 			{
-				_sig_cap = _sig_rec.manage(&_sig_ctx);
-
-				_startup_lock.unlock();
-
 				for (;;) {
-					_sig_rec.wait_for_signal();
-
-					if (libc_select_notify)
-						libc_select_notify();
+					Genode::Signal sig = _sig_rec.wait_for_signal();
+
+					/*
+					 * The context cannot be dissolved while 'sig' refers
+					 * to it.
+					 */
+					Read_avail_context *ctx =
+						static_cast<Read_avail_context *>(sig.context());
+					Libc::notify_ready(ctx->fd);
 				}
 			}
 
 		public:
 
-			Read_sigh()
-			:
-				Read_sigh_thread("read_sigh"),
-				_startup_lock(Genode::Lock::LOCKED)
-			{
-				start();
+			Read_sigh() : Read_sigh_thread("read_sigh") { start(); }
 
-				/* wait until '_sig_cap' is initialized */
-				_startup_lock.lock();
-			}
+			Genode::Signal_context_capability manage(Read_avail_context &ctx) {
+				return _sig_rec.manage(&ctx); }
 
-			Genode::Signal_context_capability cap() { return _sig_cap; }
+			void dissolve(Read_avail_context &ctx) { _sig_rec.dissolve(&ctx); }
 	};
 
 
 	/**
 	 * Return singleton instance of 'Read_sigh'
 	 */
-	static Genode::Signal_context_capability read_sigh()
+	static Read_sigh &read_sigh()
 	{
 		static Read_sigh inst;
-		return inst.cap();
+		return inst;
 	}
 
 
@@ -98,22 +95,31 @@ namespace {
 	 *
 	 * The terminal connection is created along with the context. The
 	 * notifications about data available for reading are delivered to
-	 * the 'Read_sigh' thread, which cares about unblocking 'select()'.
+	 * the 'Read_sigh' thread, which wakes up the threads waiting for the
+	 * file descriptor.
 	 */
 	class Plugin_context : public Libc::Plugin_context, public Terminal::Connection
 	{
 		private:
 
-			int _status_flags;
+			int                _status_flags;
+			Read_avail_context _read_avail;
 
 		public:
 
 			Plugin_context()
 			: _status_flags(0)
 			{
-				read_avail_sigh(read_sigh());
+				read_avail_sigh(read_sigh().manage(_read_avail));
 			}
 
+			~Plugin_context() { read_sigh().dissolve(_read_avail); }
+
+			/**
+			 * Set file descriptor to notify about available data
+			 */
+			void fd(Libc::File_descriptor *fd) { _read_avail.fd = fd; }
+
 			/**
 			 * Set/get file status status flags
 			 */
@@ -164,7 +170,11 @@ namespace {
 			{
 				Plugin_context *context = new (Genode::env()->heap()) Plugin_context;
 				context->status_flags(flags);
-				return Libc::file_descriptor_allocator()->alloc(this, context);
+
+				Libc::File_descriptor *fd =
+					Libc::file_descriptor_allocator()->alloc(this, context);
+				context->fd(fd);
+				return fd;
 			}
 
 			int close(Libc::File_descriptor *fd)
@@ -215,6 +225,15 @@ namespace {
 				return true;
 			}
 
+			/*
+			 * Unlike 'select', this covers descriptors beyond 'FD_SETSIZE'
+			 */
+			unsigned ready(Libc::File_descriptor *fd, unsigned events) override
+			{
+				return ((events & READY_READ) && context(fd)->avail() ? READY_READ : 0)
+				     | (events & READY_WRITE);
+			}
+
 			int select(int nfds,
 			           fd_set *readfds,
 			           fd_set *writefds,
@@ -2,10 +2,17 @@
  * \brief  LwIP ethernet interface
  * \author Stefan Kalkowski
  * \date   2009-11-05
+ *
+ * Received frames are handed to lwIP as custom pbufs that reference the
+ * packet-stream buffer directly. The packet is acknowledged to the NIC
+ * session not before lwIP frees the pbuf. To keep the NIC driver able to
+ * receive, at most half of the rx buffer is held this way. Beyond this
+ * limit, and for all frames other than unfragmented IPv4 TCP segments,
+ * frames are copied into pool pbufs.
  */
 
 /*
- * Copyright (C) 2009-2013 Genode Labs GmbH
+ * Copyright (C) 2009-2016 Genode Labs GmbH
  *
  * This file is part of the Genode OS framework, which is distributed
  * under the terms of the GNU General Public License version 2.
@@ -19,6 +26,7 @@ extern "C" {
 #include <lwip/pbuf.h>
 #include <lwip/sys.h>
 #include <lwip/stats.h>
+#include <lwip/ip.h>
 #include <lwip/snmp.h>
 #include <netif/etharp.h>
 #include <netif/ppp_oe.h>
@@ -49,25 +57,108 @@ class Nic_receiver_thread : public Genode::Thread<8192>
 
 		typedef Nic::Packet_descriptor Packet_descriptor;
 
+		/**
+		 * Custom pbuf referencing a packet of the rx packet stream
+		 */
+		struct Rx_pbuf
+		{
+			struct pbuf_custom   p; /* must be the first member */
+			Nic_receiver_thread *thread;
+			Packet_descriptor    packet;
+			Rx_pbuf             *next;
+		};
+
+		enum { RX_PBUFS = 128 };
+
 		Nic::Connection  *_nic;       /* nic-session */
 		Packet_descriptor _rx_packet; /* actual packet received */
+		bool              _rx_held;   /* actual packet is referenced by lwIP */
 		struct netif     *_netif;     /* LwIP network interface structure */
 
+		/*
+		 * The rx pbufs are freed by lwIP from arbitrary threads. The
+		 * packets of freed pbufs are acknowledged by this thread.
+		 */
+		Genode::Lock     _rx_lock;
+		Rx_pbuf          _rx_pbufs[RX_PBUFS];
+		Rx_pbuf         *_rx_free     = nullptr; /* unused pbufs */
+		Rx_pbuf         *_rx_released = nullptr; /* freed, not acknowledged */
+		Genode::size_t   _rx_held_bytes = 0;
+		Genode::size_t   _rx_held_max;
+
 		Genode::Signal_receiver  _sig_rec;
 
 		Genode::Signal_dispatcher<Nic_receiver_thread> _link_state_dispatcher;
 		Genode::Signal_dispatcher<Nic_receiver_thread> _rx_packet_avail_dispatcher;
 		Genode::Signal_dispatcher<Nic_receiver_thread> _rx_ready_to_ack_dispatcher;
+		Genode::Signal_dispatcher<Nic_receiver_thread> _rx_released_dispatcher;
+
+		static void _rx_pbuf_free(struct pbuf *p)
+		{
+			Rx_pbuf *rx_pbuf = reinterpret_cast<Rx_pbuf *>(p);
+			Nic_receiver_thread &th = *rx_pbuf->thread;
+
+			bool first = false;
+			{
+				Genode::Lock::Guard guard(th._rx_lock);
+				first           = !th._rx_released;
+				rx_pbuf->next   = th._rx_released;
+				th._rx_released = rx_pbuf;
+			}
+
+			/*
+			 * A non-empty list of released pbufs has been signalled
+			 * already. The rx thread takes all of them at once.
+			 */
+			if (first)
+				Genode::Signal_transmitter(th._rx_released_dispatcher).submit();
+		}
+
+		void _ack_released_rx_packets()
+		{
+			Rx_pbuf *released = nullptr;
+			{
+				Genode::Lock::Guard guard(_rx_lock);
+				released     = _rx_released;
+				_rx_released = nullptr;
+			}
+
+			while (released && _nic->rx()->ready_to_ack()) {
+				Rx_pbuf *rx_pbuf = released;
+				released = rx_pbuf->next;
+
+				_nic->rx()->acknowledge_packet(rx_pbuf->packet);
+
+				Genode::Lock::Guard guard(_rx_lock);
+				_rx_held_bytes -= rx_pbuf->packet.size();
+				rx_pbuf->next   = _rx_free;
+				_rx_free        = rx_pbuf;
+			}
+
+			/* keep the rest until the ack queue has room again */
+			Genode::Lock::Guard guard(_rx_lock);
+			while (Rx_pbuf *rx_pbuf = released) {
+				released      = rx_pbuf->next;
+				rx_pbuf->next = _rx_released;
+				_rx_released  = rx_pbuf;
+			}
+		}
 
 		void _handle_rx_packet_avail(unsigned)
 		{
+			_ack_released_rx_packets();
+
 			while (_nic->rx()->packet_avail() && _nic->rx()->ready_to_ack()) {
 				_rx_packet = _nic->rx()->get_packet();
+				_rx_held   = false;
 				genode_netif_input(_netif);
-				_nic->rx()->acknowledge_packet(_rx_packet);
+				if (!_rx_held)
+					_nic->rx()->acknowledge_packet(_rx_packet);
 			}
 		}
 
+		void _handle_rx_released(unsigned) { _handle_rx_packet_avail(0); }
+
 		void _handle_rx_read_to_ack(unsigned) { _handle_rx_packet_avail(0); }
 
 		void _handle_link_state(unsigned)
@@ -87,13 +178,22 @@ class Nic_receiver_thread : public Genode::Thread<8192>
 
 	public:
 
-		Nic_receiver_thread(Nic::Connection *nic, struct netif *netif)
+		Nic_receiver_thread(Nic::Connection *nic, struct netif *netif,
+		                    Genode::size_t rx_buf_size)
 		:
-			Genode::Thread<8192>("nic-recv"), _nic(nic), _netif(netif),
+			Genode::Thread<8192>("nic-recv"), _nic(nic), _rx_held(false),
+			_netif(netif), _rx_held_max(rx_buf_size / 2),
 			_link_state_dispatcher(_sig_rec, *this, &Nic_receiver_thread::_handle_link_state),
 			_rx_packet_avail_dispatcher(_sig_rec, *this, &Nic_receiver_thread::_handle_rx_packet_avail),
-			_rx_ready_to_ack_dispatcher(_sig_rec, *this, &Nic_receiver_thread::_handle_rx_read_to_ack)
+			_rx_ready_to_ack_dispatcher(_sig_rec, *this, &Nic_receiver_thread::_handle_rx_read_to_ack),
+			_rx_released_dispatcher(_sig_rec, *this, &Nic_receiver_thread::_handle_rx_released)
 		{
+			for (unsigned i = 0; i < RX_PBUFS; i++) {
+				_rx_pbufs[i].thread = this;
+				_rx_pbufs[i].next   = _rx_free;
+				_rx_free            = &_rx_pbufs[i];
+			}
+
 			_nic->link_state_sigh(_link_state_dispatcher);
 			_nic->rx_channel()->sigh_packet_avail(_rx_packet_avail_dispatcher);
 			_nic->rx_channel()->sigh_ready_to_ack(_rx_ready_to_ack_dispatcher);
@@ -103,6 +203,61 @@ class Nic_receiver_thread : public Genode::Thread<8192>
 		Nic::Connection  *nic() { return _nic; };
 		Packet_descriptor rx_packet() { return _rx_packet; };
 
+		/**
+		 * Return true if lwIP may process the frame as referenced pbuf
+		 *
+		 * lwIP 1.4 refuses to grow the header of a PBUF_REF pbuf. ICMP
+		 * echo and ICMP destination-unreachable replies restore the
+		 * hidden IP header and would fail on referenced frames. Only
+		 * unfragmented IPv4 TCP segments are known to pass the stack
+		 * with shrinking headers alone.
+		 */
+		static bool _rx_referenceable(char const *frame, Genode::size_t len)
+		{
+			if (len < SIZEOF_ETH_HDR + IP_HLEN)
+				return false;
+
+			struct eth_hdr const *eth = (struct eth_hdr const *)frame;
+			if (eth->type != PP_HTONS(ETHTYPE_IP))
+				return false;
+
+			struct ip_hdr const *ip = (struct ip_hdr const *)(frame + SIZEOF_ETH_HDR);
+			return IPH_PROTO(ip) == IP_PROTO_TCP
+			    && !(IPH_OFFSET(ip) & PP_HTONS(IP_MF | IP_OFFMASK));
+		}
+
+		/**
+		 * Return pbuf referencing the actual rx packet
+		 *
+		 * \return 0 if the frame must be copied or too much of the rx
+		 *         buffer is referenced already
+		 */
+		struct pbuf *rx_packet_pbuf()
+		{
+			char *content = _nic->rx()->packet_content(_rx_packet);
+			if (!_rx_referenceable(content, _rx_packet.size()))
+				return 0;
+
+			Rx_pbuf *rx_pbuf = nullptr;
+			{
+				Genode::Lock::Guard guard(_rx_lock);
+				if (!_rx_free || _rx_held_bytes + _rx_packet.size() > _rx_held_max)
+					return 0;
+
+				rx_pbuf         = _rx_free;
+				_rx_free        = rx_pbuf->next;
+				_rx_held_bytes += _rx_packet.size();
+			}
+
+			rx_pbuf->packet = _rx_packet;
+			rx_pbuf->p.custom_free_function = _rx_pbuf_free;
+			_rx_held = true;
+
+			u16_t const len = _rx_packet.size();
+			return pbuf_alloced_custom(PBUF_RAW, len, PBUF_REF, &rx_pbuf->p,
+			                           content, len);
+		}
+
 		Packet_descriptor alloc_tx_packet(Genode::size_t size)
 		{
 			while (true) {
@@ -197,6 +352,14 @@ extern "C" {
 		char                  *rx_content = nic->rx()->packet_content(rx_packet);
 		u16_t                  len        = rx_packet.size();
 
+#if !ETH_PAD_SIZE
+		/* hand packet-stream memory to lwIP without copying */
+		if (struct pbuf *p = th->rx_packet_pbuf()) {
+			LINK_STATS_INC(link.recv);
+			return p;
+		}
+#endif
+
 #if ETH_PAD_SIZE
 		len += ETH_PAD_SIZE; /* allow room for Ethernet padding */
 #endif
@@ -295,7 +458,7 @@ extern "C" {
 
 		/* Setup receiver thread */
 		Nic_receiver_thread *th = new (env()->heap())
-			Nic_receiver_thread(nic, netif);
+			Nic_receiver_thread(nic, netif, nbs->rx_buf_size);
 
 		/* Store receiver thread address in user-defined netif struct part */
 		netif->state      = (void*) th;
@@ -6,7 +6,7 @@
  */
 
 /*
- * Copyright (C) 2012-2013 Genode Labs GmbH
+ * Copyright (C) 2012-2016 Genode Labs GmbH
  *
  * This file is part of the Genode OS framework, which is distributed
  * under the terms of the GNU General Public License version 2.
@@ -44,6 +44,12 @@ static Lock pthread_cleanup_list_lock;
 static List<thread_cleanup> pthread_cleanup_list;
 
 
+/*
+ * Provided by the libc's malloc, which caches free objects per thread
+ */
+namespace Libc { void release_thread_cache(); }
+
+
 /*
  * We initialize the main-thread pointer in a constructor depending on the
  * assumption that libpthread is loaded on application startup by ldso. During
@@ -113,6 +119,8 @@ extern "C" {
 
 	void pthread_exit(void *value_ptr)
 	{
+		Libc::release_thread_cache();
+
 		pthread_cancel(pthread_self());
 		sleep_forever();
 	}
@@ -0,0 +1,80 @@
+/*
+ * \brief  Benchmark of loading shared objects and looking up symbols
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-22
+ *
+ * The benchmark repeatedly loads 'libm.lib.so' with immediate binding,
+ * which resolves all its symbol references against the C runtime, and
+ * looks up symbols of the C runtime by name via the program's shared-object
+ * handle. Comparing runs with 'ld_lookup_cache' set to "yes" and "no"
+ * shows the effect of the symbol-lookup cache.
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+/* Genode includes */
+#include <base/shared_object.h>
+#include <timer_session/connection.h>
+
+/* libc includes */
+#include <stdio.h>
+
+
+enum { LOAD_ROUNDS = 20, LOOKUP_ROUNDS = 1000 };
+
+static char const *symbols[] = {
+	"printf", "malloc", "free", "memcpy", "strlen", "open", "close",
+	"read", "write", "fopen", "fclose", "qsort", "strtol", "gettimeofday" };
+
+
+int main(int argc, char **argv)
+{
+	printf("--- ldso benchmark ---\n");
+
+	static Timer::Connection timer;
+
+	/* load and unload library */
+	unsigned long start = timer.elapsed_ms();
+
+	for (unsigned i = 0; i < LOAD_ROUNDS; i++) {
+		try {
+			Genode::Shared_object libm("libm.lib.so", Genode::Shared_object::NOW);
+			if (!libm.lookup("sqrt")) {
+				printf("sqrt not found in libm\n");
+				return -1;
+			}
+		} catch (...) {
+			printf("could not load libm\n");
+			return -1;
+		}
+	}
+
+	unsigned long const load_us = (timer.elapsed_ms() - start)*1000/LOAD_ROUNDS;
+
+	/* look up symbols of the C runtime */
+	Genode::Shared_object program;
+
+	unsigned const num_symbols = sizeof(symbols)/sizeof(symbols[0]);
+
+	start = timer.elapsed_ms();
+
+	for (unsigned r = 0; r < LOOKUP_ROUNDS; r++)
+		for (unsigned i = 0; i < num_symbols; i++)
+			if (!program.lookup(symbols[i])) {
+				printf("symbol %s not found\n", symbols[i]);
+				return -1;
+			}
+
+	unsigned long const lookup_ns =
+		(timer.elapsed_ms() - start)*1000*1000/(LOOKUP_ROUNDS*num_symbols);
+
+	printf("load libm.lib.so: %lu us, symbol lookup: %lu ns\n", load_us, lookup_ns);
+
+	printf("--- ldso benchmark finished ---\n");
+	return 0;
+}
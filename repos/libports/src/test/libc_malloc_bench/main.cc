@@ -0,0 +1,228 @@
+/*
+ * \brief  Benchmark of the libc malloc compared to a single-lock slab allocator
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-18
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+/* Genode includes */
+#include <base/env.h>
+#include <base/heap.h>
+#include <base/lock.h>
+#include <base/slab.h>
+#include <timer_session/connection.h>
+
+/* libc includes */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+enum {
+	MAX_THREADS = 4,
+	ROUNDS      = 256,
+	WINDOW      = 512,   /* objects allocated at once by each thread */
+	LIVE        = 65536, /* objects allocated for the memory measurement */
+};
+
+
+/**
+ * Interface of the compared allocators
+ */
+struct Bench_alloc
+{
+	virtual void *alloc(size_t) = 0;
+	virtual void  free(void *)  = 0;
+};
+
+
+struct Libc_malloc : Bench_alloc
+{
+	void *alloc(size_t size) override { return ::malloc(size); }
+	void  free(void *ptr)    override { ::free(ptr); }
+};
+
+
+/**
+ * Allocator as used by the libc before, with power-of-two slabs, a size
+ * header in front of each object, and one lock
+ */
+class Slab_malloc : public Bench_alloc
+{
+	private:
+
+		enum { SLAB_START = 2, SLAB_STOP = 11, NUM_SLABS = SLAB_STOP - SLAB_START + 1 };
+
+		typedef unsigned long Block_header;
+
+		Genode::Heap   _heap { Genode::env()->ram_session(), Genode::env()->rm_session() };
+		Genode::Slab  *_slabs[NUM_SLABS];
+		Genode::Lock   _lock;
+
+		static unsigned _slab_log2(unsigned long size)
+		{
+			unsigned msb = Genode::log2(size);
+			if (size > (1UL << msb))
+				msb++;
+			return Genode::max(msb, (unsigned)SLAB_START);
+		}
+
+	public:
+
+		Slab_malloc()
+		{
+			for (unsigned i = SLAB_START; i <= SLAB_STOP; i++)
+				_slabs[i - SLAB_START] = new (&_heap)
+					Genode::Slab(1U << i, Genode::align_addr(16U << i, 12),
+					             0, &_heap);
+		}
+
+		void *alloc(size_t size) override
+		{
+			Genode::Lock::Guard guard(_lock);
+
+			unsigned long const real_size = ((size + 3) & ~3) + sizeof(Block_header);
+			unsigned const msb = _slab_log2(real_size);
+
+			void *addr = 0;
+			if (msb > SLAB_STOP) {
+				if (!_heap.alloc(real_size, &addr))
+					return 0;
+			} else if (!_slabs[msb - SLAB_START]->alloc(1U << msb, &addr))
+				return 0;
+
+			*(Block_header *)addr = real_size;
+			return (Block_header *)addr + 1;
+		}
+
+		void free(void *ptr) override
+		{
+			Genode::Lock::Guard guard(_lock);
+
+			Block_header *addr = (Block_header *)ptr - 1;
+			unsigned long const real_size = *addr;
+			unsigned const msb = _slab_log2(real_size);
+
+			if (msb > SLAB_STOP)
+				_heap.free(addr, real_size);
+			else
+				_slabs[msb - SLAB_START]->free(addr, 1U << msb);
+		}
+};
+
+
+/**
+ * Object sizes between 8 and 1024 bytes, biased towards small objects
+ */
+static size_t random_size(unsigned &seed)
+{
+	seed = seed * 1103515245 + 12345;
+	unsigned const r = seed >> 16;
+	return 8 + (r % 1017) * (r % 1017) / 1016;
+}
+
+
+struct Worker
+{
+	Bench_alloc *alloc;
+	pthread_t    thread;
+	void        *objects[WINDOW];
+	bool         failed = false;
+};
+
+
+static void *worker_entry(void *arg)
+{
+	Worker &w = *(Worker *)arg;
+
+	unsigned seed = (unsigned)(unsigned long)arg;
+	for (unsigned r = 0; r < ROUNDS; r++) {
+		for (unsigned i = 0; i < WINDOW; i++)
+			if (!(w.objects[i] = w.alloc->alloc(random_size(seed))))
+				w.failed = true;
+
+		for (unsigned i = 0; i < WINDOW; i++)
+			w.alloc->free(w.objects[i]);
+	}
+	return 0;
+}
+
+
+static void bench_throughput(char const *name, Bench_alloc &alloc,
+                             Timer::Connection &timer)
+{
+	for (unsigned n = 1; n <= MAX_THREADS; n++) {
+
+		static Worker workers[MAX_THREADS];
+
+		unsigned long const start = timer.elapsed_ms();
+
+		for (unsigned i = 0; i < n; i++) {
+			workers[i].alloc  = &alloc;
+			workers[i].failed = false;
+			pthread_create(&workers[i].thread, 0, worker_entry, &workers[i]);
+		}
+
+		bool failed = false;
+		for (unsigned i = 0; i < n; i++) {
+			pthread_join(workers[i].thread, 0);
+			failed |= workers[i].failed;
+		}
+
+		unsigned long const ms = Genode::max(timer.elapsed_ms() - start, 1UL);
+		unsigned long long const ops = (unsigned long long)n*ROUNDS*WINDOW;
+
+		printf("%s: %u thread(s): %llu malloc/free pairs/s%s\n", name, n,
+		       ops*1000/ms, failed ? " (allocation failed)" : "");
+	}
+}
+
+
+static void bench_memory(char const *name, Bench_alloc &alloc)
+{
+	static void *objects[LIVE];
+
+	size_t const used_before = Genode::env()->ram_session()->used();
+
+	unsigned seed = 1;
+	size_t payload = 0;
+	for (unsigned i = 0; i < LIVE; i++) {
+		size_t const size = random_size(seed);
+		objects[i] = alloc.alloc(size);
+		payload += size;
+	}
+
+	size_t const used = Genode::env()->ram_session()->used() - used_before;
+
+	printf("%s: %u objects: %zu KiB payload, %zu KiB RAM\n", name, LIVE,
+	       payload / 1024, used / 1024);
+
+	for (unsigned i = 0; i < LIVE; i++)
+		alloc.free(objects[i]);
+}
+
+
+int main(int argc, char **argv)
+{
+	printf("--- libc malloc benchmark ---\n");
+
+	static Timer::Connection timer;
+
+	static Slab_malloc slab_malloc;
+	static Libc_malloc libc_malloc;
+
+	bench_memory("slab", slab_malloc);
+	bench_memory("libc", libc_malloc);
+
+	bench_throughput("slab", slab_malloc, timer);
+	bench_throughput("libc", libc_malloc, timer);
+
+	printf("--- returning from main ---\n");
+	return 0;
+}
@@ -0,0 +1,226 @@
+/*
+ * \brief  Wakeup latency of select, poll, and kevent with many idle descriptors
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-19
+ *
+ * The main thread waits for one active pipe among idle pipes and answers
+ * each message of a writer thread via a second pipe. The idle pipes have
+ * their write end closed, so only their read ends occupy descriptors.
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+/* Genode includes */
+#include <timer_session/connection.h>
+
+/* libc includes */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/poll.h>
+#include <sys/select.h>
+#include <sys/time.h>
+
+
+enum { ROUNDS = 1000, MAX_IDLE = 10000 };
+
+static int idle_fds[MAX_IDLE];
+static int request[2];  /* writer thread -> main thread */
+static int response[2]; /* main thread -> writer thread */
+
+
+static void *writer_entry(void *)
+{
+	char c = 0;
+	for (unsigned i = 0; i < ROUNDS; i++) {
+		write(request[1], &c, 1);
+		read(response[0], &c, 1);
+	}
+	return 0;
+}
+
+
+struct Waiter
+{
+	virtual char const *name() const = 0;
+
+	/**
+	 * Return false if the waiter cannot handle 'num_idle' descriptors
+	 */
+	virtual bool prepare(unsigned num_idle) = 0;
+
+	/**
+	 * Block until the request pipe is readable
+	 */
+	virtual bool wait() = 0;
+
+	virtual void cleanup() { }
+};
+
+
+struct Select_waiter : Waiter
+{
+	fd_set set;
+	int    nfds = 0;
+
+	char const *name() const override { return "select"; }
+
+	bool prepare(unsigned num_idle) override
+	{
+		FD_ZERO(&set);
+		nfds = request[0];
+		for (unsigned i = 0; i < num_idle; i++)
+			nfds = idle_fds[i] > nfds ? idle_fds[i] : nfds;
+
+		if (nfds >= (int)FD_SETSIZE)
+			return false;
+
+		for (unsigned i = 0; i < num_idle; i++)
+			FD_SET(idle_fds[i], &set);
+		FD_SET(request[0], &set);
+		nfds++;
+		return true;
+	}
+
+	bool wait() override
+	{
+		fd_set readfds = set;
+		return select(nfds, &readfds, 0, 0, 0) == 1
+		    && FD_ISSET(request[0], &readfds);
+	}
+};
+
+
+struct Poll_waiter : Waiter
+{
+	struct pollfd fds[MAX_IDLE + 1];
+	nfds_t        nfds = 0;
+
+	char const *name() const override { return "poll"; }
+
+	bool prepare(unsigned num_idle) override
+	{
+		for (unsigned i = 0; i < num_idle; i++) {
+			fds[i].fd     = idle_fds[i];
+			fds[i].events = POLLIN;
+		}
+		fds[num_idle].fd     = request[0];
+		fds[num_idle].events = POLLIN;
+		nfds = num_idle + 1;
+		return true;
+	}
+
+	bool wait() override
+	{
+		return poll(fds, nfds, -1) == 1 && (fds[nfds - 1].revents & POLLIN);
+	}
+};
+
+
+struct Kqueue_waiter : Waiter
+{
+	int kq = -1;
+
+	char const *name() const override { return "kevent"; }
+
+	bool prepare(unsigned num_idle) override
+	{
+		kq = kqueue();
+		if (kq < 0)
+			return false;
+
+		struct kevent change;
+		for (unsigned i = 0; i < num_idle; i++) {
+			EV_SET(&change, idle_fds[i], EVFILT_READ, EV_ADD, 0, 0, 0);
+			if (kevent(kq, &change, 1, 0, 0, 0) < 0)
+				return false;
+		}
+		EV_SET(&change, request[0], EVFILT_READ, EV_ADD, 0, 0, 0);
+		return kevent(kq, &change, 1, 0, 0, 0) == 0;
+	}
+
+	bool wait() override
+	{
+		struct kevent event;
+		return kevent(kq, 0, 0, &event, 1, 0) == 1
+		    && (int)event.ident == request[0];
+	}
+
+	void cleanup() override { close(kq); }
+};
+
+
+static void bench(Waiter &waiter, unsigned num_idle, Timer::Connection &timer)
+{
+	if (!waiter.prepare(num_idle)) {
+		printf("%s: %u idle descriptors: not supported\n", waiter.name(), num_idle);
+		waiter.cleanup();
+		return;
+	}
+
+	unsigned long const start = timer.elapsed_ms();
+
+	pthread_t writer;
+	pthread_create(&writer, 0, writer_entry, 0);
+
+	bool ok = true;
+	char c = 0;
+	for (unsigned i = 0; i < ROUNDS; i++) {
+		ok &= waiter.wait();
+		read(request[0], &c, 1);
+		write(response[1], &c, 1);
+	}
+
+	pthread_join(writer, 0);
+
+	unsigned long const ms = timer.elapsed_ms() - start;
+
+	printf("%s: %u idle descriptors: %lu us per wakeup%s\n", waiter.name(),
+	       num_idle, ms*1000/ROUNDS, ok ? "" : " (unexpected result)");
+
+	waiter.cleanup();
+}
+
+
+int main(int argc, char **argv)
+{
+	printf("--- libc select benchmark ---\n");
+
+	static Timer::Connection timer;
+
+	if (pipe(request) || pipe(response)) {
+		printf("could not create pipes\n");
+		return -1;
+	}
+
+	for (unsigned i = 0; i < MAX_IDLE; i++) {
+		int fds[2];
+		if (pipe(fds)) {
+			printf("could not create idle pipe %u\n", i);
+			return -1;
+		}
+		close(fds[1]);
+		idle_fds[i] = fds[0];
+	}
+
+	static Select_waiter select_waiter;
+	static Poll_waiter   poll_waiter;
+	static Kqueue_waiter kqueue_waiter;
+
+	Waiter *waiters[] = { &select_waiter, &poll_waiter, &kqueue_waiter };
+
+	for (unsigned num_idle = 10; num_idle <= MAX_IDLE; num_idle *= 10)
+		for (Waiter *waiter : waiters)
+			bench(*waiter, num_idle, timer);
+
+	printf("--- returning from main ---\n");
+	return 0;
+}
@@ -0,0 +1,3 @@
+TARGET   = test-libc_select_bench
+SRC_CC   = main.cc
+LIBS     = libc libc_lock_pipe pthread
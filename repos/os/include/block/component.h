@@ -6,7 +6,7 @@
  */
 
 /*
- * Copyright (C) 2011-2013 Genode Labs GmbH
+ * Copyright (C) 2011-2016 Genode Labs GmbH
  *
  * This file is part of the Genode OS framework, which is distributed
  * under the terms of the GNU General Public License version 2.
@@ -72,6 +72,7 @@ class Block::Session_component : public Block::Session_component_base,
 		Signal_rpc_member<Session_component> _sink_submit;
 		bool                                 _req_queue_full;
 		bool                                 _ack_queue_full;
+		bool                                 _drv_queue_full;
 		Packet_descriptor                    _p_to_handle;
 		unsigned                             _p_in_fly;
 
@@ -90,9 +91,15 @@ class Block::Session_component : public Block::Session_component_base,
 		/**
 		 * Range check packet request
 		 */
-		inline bool _range_check(Packet_descriptor &p) {
+		inline bool _range_check(Packet_descriptor &p)
+		{
+			/* the block range of a flush request is meaningless */
+			if (p.operation() == Packet_descriptor::FLUSH)
+				return true;
+
 			return p.block_number() + p.block_count() - 1
-			       < _driver.block_count(); }
+			       < _driver.block_count();
+		}
 
 		/**
 		 * Handle a single request
@@ -102,8 +109,13 @@ class Block::Session_component : public Block::Session_component_base,
 			_p_to_handle = packet;
 			_p_to_handle.succeeded(false);
 
+			/* requests without payload come without bulk-buffer space */
+			bool const payload =
+				packet.operation() == Packet_descriptor::READ ||
+				packet.operation() == Packet_descriptor::WRITE;
+
 			/* ignore invalid packets */
-			if (!packet.valid() || !_range_check(_p_to_handle)) {
+			if ((payload && !packet.valid()) || !_range_check(_p_to_handle)) {
 				_ack_packet(_p_to_handle);
 				return;
 			}
@@ -137,6 +149,16 @@ class Block::Session_component : public Block::Session_component_base,
 						              _p_to_handle);
 					break;
 
+				case Block::Packet_descriptor::TRIM:
+					_driver.trim(packet.block_number(),
+					             packet.block_count(),
+					             _p_to_handle);
+					break;
+
+				case Block::Packet_descriptor::FLUSH:
+					_driver.flush(_p_to_handle);
+					break;
+
 				default:
 					throw Driver::Io_error();
 				}
@@ -157,11 +179,16 @@ class Block::Session_component : public Block::Session_component_base,
 			 * them, and the driver's request queue isn't full,
 			 * direct the packet request to the driver backend
 			 */
-			for (_ack_queue_full = (_p_in_fly >= tx_sink()->ack_slots_free());
-			     !_req_queue_full && !_ack_queue_full
+			for (_ack_queue_full = (_p_in_fly >= tx_sink()->ack_slots_free()),
+			     _drv_queue_full = (_p_in_fly >= _driver.queue_depth());
+			     !_req_queue_full && !_ack_queue_full && !_drv_queue_full
 			     && tx_sink()->packet_avail();
-				 _ack_queue_full = (++_p_in_fly >= tx_sink()->ack_slots_free()))
+			     _ack_queue_full = (++_p_in_fly >= tx_sink()->ack_slots_free()),
+			     _drv_queue_full = (_p_in_fly >= _driver.queue_depth()))
 				_handle_packet(tx_sink()->get_packet());
+
+			/* let the driver start all requests handed over at once */
+			_driver.submit_batch();
 		}
 
 		/**
@@ -187,6 +214,8 @@ class Block::Session_component : public Block::Session_component_base,
 		  _sink_ack(ep, *this, &Session_component::_ready_to_ack),
 		  _sink_submit(ep, *this, &Session_component::_packet_avail),
 		  _req_queue_full(false),
+		  _ack_queue_full(false),
+		  _drv_queue_full(false),
 		  _p_in_fly(0)
 		{
 			_tx.sigh_ready_to_ack(_sink_ack);
@@ -210,7 +239,7 @@ class Block::Session_component : public Block::Session_component_base,
 			packet.succeeded(success);
 			_ack_packet(packet);
 
-			if (!_req_queue_full && !_ack_queue_full)
+			if (!_req_queue_full && !_ack_queue_full && !_drv_queue_full)
 				return;
 
 			/*
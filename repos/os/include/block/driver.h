@@ -167,6 +167,60 @@ class Block::Driver
 		                       Packet_descriptor &packet) {
 			throw Io_error(); }
 
+		/**
+		 * Discard blocks of medium
+		 *
+		 * \param block_number  number of first block to discard
+		 * \param block_count   number of blocks to discard
+		 * \param packet        packet descriptor from the client
+		 *
+		 * \throw Request_congestion
+		 *
+		 * Note: should be overridden by devices supporting the 'TRIM'
+		 *       operation
+		 */
+		virtual void trim(sector_t           block_number,
+		                  Genode::size_t     block_count,
+		                  Packet_descriptor &packet) {
+			throw Io_error(); }
+
+		/**
+		 * Write back all data written so far to the medium
+		 *
+		 * \param packet  packet descriptor from the client
+		 *
+		 * \throw Request_congestion
+		 *
+		 * In contrast to 'sync', the request is acknowledged asynchronously
+		 * via 'ack_packet'.
+		 *
+		 * Note: should be overridden by devices supporting the 'FLUSH'
+		 *       operation
+		 */
+		virtual void flush(Packet_descriptor &packet) {
+			throw Io_error(); }
+
+		/**
+		 * Request number of requests the device processes concurrently
+		 *
+		 * Requests are identified by their packet descriptor and may be
+		 * acknowledged in any order. The session component does not hand
+		 * over more requests than the queue depth at a time, which spares
+		 * drivers from signalling a full queue via 'Request_congestion'.
+		 * By default, the queue depth is not limited.
+		 */
+		virtual unsigned queue_depth() { return ~0U; }
+
+		/**
+		 * Start processing of the requests handed over so far
+		 *
+		 * The session component hands over all requests available at once
+		 * and calls this method at the end of such a batch. Drivers may
+		 * defer starting the device until then, so that the whole batch
+		 * gets issued with a single device access.
+		 */
+		virtual void submit_batch() { }
+
 		/**
 		 * Check if DMA is enabled for driver
 		 *
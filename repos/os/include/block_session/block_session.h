@@ -5,7 +5,7 @@
  */
 
 /*
- * Copyright (C) 2010-2013 Genode Labs GmbH
+ * Copyright (C) 2010-2016 Genode Labs GmbH
  *
  * This file is part of the Genode OS framework, which is distributed
  * under the terms of the GNU General Public License version 2.
@@ -36,12 +36,21 @@ namespace Block {
  * The data associated with the 'Packet_descriptor' is either
  * the data read from or written to the block indicated by
  * its number.
+ *
+ * A 'TRIM' request tells the device that the content of the specified
+ * blocks is no longer needed. A 'FLUSH' request completes not before all
+ * write requests acknowledged prior to its submission are stored
+ * persistently, which allows for ordering writes without a full 'sync'.
+ * Both requests carry no payload, i.e., they are submitted as packets of
+ * size 0 without allocating bulk-buffer space. The block range of a
+ * 'FLUSH' request is ignored. Whether a device supports these operations is indicated by the
+ * 'Operations' returned by 'Session::info'.
  */
 class Block::Packet_descriptor : public Genode::Packet_descriptor
 {
 	public:
 
-		enum Opcode    { READ, WRITE, END };
+		enum Opcode    { READ, WRITE, TRIM, FLUSH, END };
 		enum Alignment { PACKET_ALIGNMENT = 11 };
 
 	private:
@@ -5,7 +5,7 @@
  */
 
 /*
- * Copyright (C) 2005-2013 Genode Labs GmbH
+ * Copyright (C) 2005-2016 Genode Labs GmbH
  *
  * This file is part of the Genode OS framework, which is distributed
  * under the terms of the GNU General Public License version 2.
@@ -32,18 +32,24 @@ class Genode::Alarm
 
 		friend class Alarm_scheduler;
 
+		enum State { INACTIVE, QUEUED, PENDING };
+
 		Lock             _dispatch_lock;  /* taken during handle method   */
 		Time             _deadline;       /* next deadline                */
 		Time             _period;         /* duration between alarms      */
-		int              _active;         /* set to one when active       */
-		Alarm           *_next;           /* next alarm in alarm list     */
+		State            _state;          /* membership in the scheduler  */
+		Alarm           *_child;          /* first child in alarm heap    */
+		Alarm           *_sibling;        /* next sibling/pending alarm   */
+		Alarm           *_prev;           /* parent or previous sibling   */
 		Alarm_scheduler *_scheduler;      /* currently assigned scheduler */
 
 		void _assign(Time period, Time deadline, Alarm_scheduler *scheduler) {
 			_period = period, _deadline = deadline, _scheduler = scheduler; }
 
+		void _unlink() { _child = _sibling = _prev = 0; }
+
 		void _reset() {
-			_assign(0, 0, 0), _active = 0, _next = 0; }
+			_assign(0, 0, 0), _state = INACTIVE, _unlink(); }
 
 	protected:
 
@@ -68,24 +74,71 @@ class Genode::Alarm_scheduler
 {
 	private:
 
-		Lock         _lock;   /* protect alarm list                     */
-		Alarm       *_head;   /* head of alarm list                     */
-		Alarm::Time  _now;    /* recent time (updated by handle method) */
+		Lock         _lock;    /* protect alarm heap and pending list    */
+		Alarm       *_root;    /* alarm with the earliest deadline       */
+		Alarm       *_pending; /* due alarms not yet dispatched          */
+		Alarm       *_pending_tail;
+		Alarm::Time  _now;     /* recent time (updated by handle method) */
+
+		/*
+		 * Alarms are kept in a pairing heap that is linked through the
+		 * alarm objects. Inserting an alarm takes constant time, removing
+		 * any alarm takes logarithmic time in the amortized case, and the
+		 * earliest deadline is always found at the root. When handling
+		 * alarms, all due alarms are moved from the heap to the pending
+		 * list in one go and dispatched in the order of their deadlines.
+		 */
+
+		/**
+		 * Return true if the deadline of 'a' is before the one of 'b'
+		 */
+		bool _earlier(Alarm const *a, Alarm const *b) const {
+			return (int)a->_deadline - (int)_now < (int)b->_deadline - (int)_now; }
+
+		/**
+		 * Return true if the deadline of 'alarm' has passed
+		 */
+		bool _due(Alarm const *alarm) const {
+			return (int)alarm->_deadline - (int)_now < 0; }
+
+		/**
+		 * Meld two heaps
+		 *
+		 * \return  root of the resulting heap
+		 */
+		Alarm *_meld(Alarm *a, Alarm *b);
+
+		/**
+		 * Meld the list of sibling heaps starting at 'first' into one heap
+		 *
+		 * \return  root of the resulting heap
+		 */
+		Alarm *_merge_pairs(Alarm *first);
+
+		/**
+		 * Move all due alarms from the heap to the pending list
+		 */
+		void _collect_pending_alarms();
+
+		/**
+		 * Return alarm that triggers next
+		 */
+		Alarm *_next_alarm() const { return _pending ? _pending : _root; }
 
 		/**
-		 * Enqueue alarm into alarm queue
+		 * Enqueue alarm into alarm heap
 		 *
 		 * This is a helper for 'schedule' and 'handle'.
 		 */
 		void _unsynchronized_enqueue(Alarm *alarm);
 
 		/**
-		 * Dequeue alarm from alarm queue
+		 * Dequeue alarm from alarm heap or pending list
 		 */
 		void _unsynchronized_dequeue(Alarm *alarm);
 
 		/**
-		 * Dequeue next pending alarm from alarm list
+		 * Dequeue next pending alarm
 		 *
 		 * \return  dequeued pending alarm
 		 * \retval  0  no alarm pending
@@ -99,7 +152,7 @@ class Genode::Alarm_scheduler
 
 	public:
 
-		Alarm_scheduler() : _head(0), _now(0) { }
+		Alarm_scheduler() : _root(0), _pending(0), _pending_tail(0), _now(0) { }
 		~Alarm_scheduler();
 
 		/**
@@ -145,7 +198,7 @@ class Genode::Alarm_scheduler
 		 * \param alarm  alarm object
 		 * \return true if alarm is head element of timeout queue
 		 */
-		bool head_timeout(const Alarm * alarm) { return _head == alarm; }
+		bool head_timeout(const Alarm * alarm) { return _next_alarm() == alarm; }
 };
 
 #endif /* _INCLUDE__OS__ALARM_H_ */
@@ -16,7 +16,8 @@
 #define _INCLUDE__OS__PACKET_ALLOCATOR__
 
 #include <base/allocator.h>
-#include <util/bit_array.h>
+#include <util/misc_math.h>
+#include <util/string.h>
 
 namespace Genode { class Packet_allocator; }
 
@@ -25,29 +26,172 @@ namespace Genode { class Packet_allocator; }
  * This allocator is designed to be used as packet allocator for the
  * packet stream interface. It uses a minimal block size, which is the
  * granularity packets will be allocated with. As backend, it uses a
- * simple bit array to manage free, and allocated blocks.
+ * bitmap to manage free, and allocated blocks.
+ *
+ * The bitmap is scanned word-wise. Two summary bitmaps with one bit per
+ * bitmap word denote words that are completely allocated respectively
+ * partially used. The search for a free block skips full words and the
+ * search for the end of a free run skips empty words via the summaries,
+ * so that each step covers up to word-size squared blocks.
  */
 class Genode::Packet_allocator : public Genode::Range_allocator
 {
 	private:
 
-		Allocator      *_md_alloc;   /* meta-data allocator                 */
-		size_t          _block_size; /* granularity of packet allocations   */
-		void           *_bits;       /* memory chunk containing the bits    */
-		Bit_array_base *_array;      /* bit array managing available blocks */
-		addr_t          _base;       /* allocation base                     */
-		addr_t          _next;       /* next free bit index                 */
+		enum { BITS_PER_WORD = sizeof(addr_t)*8 };
+
+		Allocator *_md_alloc;   /* meta-data allocator                  */
+		size_t     _block_size; /* granularity of packet allocations    */
+		void      *_md;         /* memory chunk containing all bitmaps  */
+		addr_t    *_bits;       /* one bit per block, set if allocated  */
+		addr_t    *_full;       /* one bit per '_bits' word, set if full */
+		addr_t    *_used;       /* one bit per '_bits' word, set if used */
+		addr_t     _base;       /* allocation base                      */
+		addr_t     _next;       /* next free bit index                  */
+		size_t     _bit_cnt;    /* number of blocks                     */
+		size_t     _word_cnt;   /* number of '_bits' words              */
 
 		/*
 		 * Returns the count of blocks fitting the given size
 		 *
 		 * The block count returned is aligned to the bit count
-		 * of a machine word to fit the needs of the used bit array.
+		 * of a machine word to fit the needs of the bitmap.
 		 */
 		inline size_t _block_cnt(size_t bytes)
 		{
 			bytes /= _block_size;
-			return bytes - (bytes % (sizeof(addr_t)*8));
+			return bytes - (bytes % BITS_PER_WORD);
+		}
+
+		/*
+		 * Returns the count of summary words for the given block count
+		 */
+		static size_t _summary_cnt(size_t block_cnt)
+		{
+			size_t const words = block_cnt / BITS_PER_WORD;
+			return (words + BITS_PER_WORD - 1) / BITS_PER_WORD;
+		}
+
+		static size_t _md_size(size_t block_cnt)
+		{
+			return (block_cnt / BITS_PER_WORD + 2*_summary_cnt(block_cnt))
+			       * sizeof(addr_t);
+		}
+
+		inline size_t _blocks(size_t size) const
+		{
+			return (size % _block_size) ? size / _block_size + 1
+			                            : size / _block_size;
+		}
+
+		static addr_t _lsb(addr_t const v) { return __builtin_ctzl(v); }
+
+		/**
+		 * Returns the mask of all bits at or above 'bit'
+		 */
+		static addr_t _from(addr_t const bit) { return ~0UL << bit; }
+
+		/**
+		 * Returns index of first word at or behind 'w' whose summary bit
+		 * is set in 'summary', or '_word_cnt' if there is none
+		 *
+		 * \param inverse  search for cleared summary bits instead
+		 */
+		size_t _next_word(addr_t const *summary, bool inverse, size_t w) const
+		{
+			for (size_t s = w / BITS_PER_WORD; w < _word_cnt;
+			     s++, w = s * BITS_PER_WORD) {
+
+				addr_t const v = (inverse ? ~summary[s] : summary[s])
+				                 & _from(w % BITS_PER_WORD);
+				if (v) {
+					w = s * BITS_PER_WORD + _lsb(v);
+					return w < _word_cnt ? w : _word_cnt;
+				}
+			}
+			return _word_cnt;
+		}
+
+		/**
+		 * Returns index of first free block at or behind 'i', or '_bit_cnt'
+		 */
+		size_t _next_free(size_t i) const
+		{
+			size_t w = i / BITS_PER_WORD;
+			addr_t v = ~_bits[w] & _from(i % BITS_PER_WORD);
+			if (v)
+				return w * BITS_PER_WORD + _lsb(v);
+
+			w = _next_word(_full, true, w + 1);
+			if (w == _word_cnt)
+				return _bit_cnt;
+
+			return w * BITS_PER_WORD + _lsb(~_bits[w]);
+		}
+
+		/**
+		 * Returns index of first allocated block at or behind 'i', or
+		 * '_bit_cnt'
+		 */
+		size_t _next_used(size_t i) const
+		{
+			size_t w = i / BITS_PER_WORD;
+			addr_t v = _bits[w] & _from(i % BITS_PER_WORD);
+			if (v)
+				return w * BITS_PER_WORD + _lsb(v);
+
+			w = _next_word(_used, false, w + 1);
+			if (w == _word_cnt)
+				return _bit_cnt;
+
+			return w * BITS_PER_WORD + _lsb(_bits[w]);
+		}
+
+		/**
+		 * Returns first index at or behind 'i' of 'cnt' free blocks, or
+		 * '_bit_cnt' if there is none
+		 */
+		size_t _find(size_t i, size_t cnt) const
+		{
+			while (i < _bit_cnt && cnt <= _bit_cnt - i) {
+				i = _next_free(i);
+				if (i == _bit_cnt || cnt > _bit_cnt - i)
+					break;
+
+				size_t const end = _next_used(i);
+				if (end - i >= cnt)
+					return i;
+
+				i = end;
+			}
+			return _bit_cnt;
+		}
+
+		/**
+		 * Mark 'cnt' blocks starting at 'i' as allocated or free and
+		 * update the summaries of all affected words
+		 */
+		void _mark(size_t i, size_t cnt, bool alloc)
+		{
+			while (cnt) {
+				size_t const w     = i / BITS_PER_WORD;
+				size_t const bit   = i % BITS_PER_WORD;
+				size_t const width = min(cnt, BITS_PER_WORD - bit);
+				addr_t const mask  = (width == BITS_PER_WORD)
+				                   ? ~0UL : ((1UL << width) - 1) << bit;
+
+				if (alloc) _bits[w] |=  mask;
+				else       _bits[w] &= ~mask;
+
+				addr_t const s    = 1UL << (w % BITS_PER_WORD);
+				addr_t     &full = _full[w / BITS_PER_WORD];
+				addr_t     &used = _used[w / BITS_PER_WORD];
+
+				if (_bits[w] == ~0UL) full |= s; else full &= ~s;
+				if (_bits[w])         used |= s; else used &= ~s;
+
+				i += width, cnt -= width;
+			}
 		}
 
 	public:
@@ -59,8 +203,9 @@ class Genode::Packet_allocator : public Genode::Range_allocator
 		 * \param block_size     Granularity of packets in stream
 		 */
 		Packet_allocator(Allocator *md_alloc, size_t block_size)
-		: _md_alloc(md_alloc), _block_size(block_size), _bits(0),
-		  _array(nullptr), _base(0) {}
+		: _md_alloc(md_alloc), _block_size(block_size), _md(nullptr),
+		  _bits(nullptr), _full(nullptr), _used(nullptr), _base(0),
+		  _next(0), _bit_cnt(0), _word_cnt(0) {}
 
 
 		/*******************************
@@ -69,13 +214,21 @@ class Genode::Packet_allocator : public Genode::Range_allocator
 
 		int add_range(addr_t base, size_t size) override
 		{
-			if (_base || _array) return -1;
+			if (_base || _md) return -1;
 
-			_base  = base;
-			_bits  = _md_alloc->alloc(_block_cnt(size)/8);
-			_array = new (_md_alloc) Bit_array_base(_block_cnt(size),
-			                                        (addr_t*)_bits,
-			                                        true);
+			size_t const cnt = _block_cnt(size);
+			size_t const md  = _md_size(cnt);
+
+			_base     = base;
+			_md       = _md_alloc->alloc(md);
+			_bit_cnt  = cnt;
+			_word_cnt = cnt / BITS_PER_WORD;
+			_bits     = (addr_t *)_md;
+			_full     = _bits + _word_cnt;
+			_used     = _full + _summary_cnt(cnt);
+			_next     = 0;
+
+			memset(_md, 0, md);
 			return 0;
 		}
 
@@ -83,8 +236,10 @@ class Genode::Packet_allocator : public Genode::Range_allocator
 		{
 			if (_base != base) return -1;
 
-			if (_array) destroy(_md_alloc, _array);
-			if (_bits)  _md_alloc->free(_bits, _block_cnt(size)/8);
+			if (_md) _md_alloc->free(_md, _md_size(_block_cnt(size)));
+			_md = nullptr;
+			_bits = _full = _used = nullptr;
+			_bit_cnt = _word_cnt = 0;
 			return 0;
 		}
 
@@ -97,39 +252,33 @@ class Genode::Packet_allocator : public Genode::Range_allocator
 
 		bool alloc(size_t size, void **out_addr) override
 		{
-			addr_t const cnt = (size % _block_size) ? size / _block_size + 1
-			                                        : size / _block_size;
-			addr_t max = ~0UL;
-
-			do {
-				try {
-					/* throws exception if array is accessed outside bounds */
-					for (addr_t i = _next & ~(cnt - 1); i < max; i += cnt) {
-						if (_array->get(i, cnt))
-							continue;
-
-						_array->set(i, cnt);
-						_next = i + cnt;
-						*out_addr = reinterpret_cast<void *>(i * _block_size
-						                                     + _base);
-						return true;
-					}
-				} catch (typename Bit_array_base::Invalid_index_access) { }
-
-				max = _next;
-				_next = 0;
-
-			} while (max != 0);
-
-			return false;
+			size_t const cnt = max(_blocks(size), (size_t)1);
+
+			if (!_bit_cnt || cnt > _bit_cnt)
+				return false;
+
+			/* search behind the last allocation first, then wrap around */
+			size_t i = _next < _bit_cnt ? _find(_next, cnt) : _bit_cnt;
+			if (i == _bit_cnt && _next)
+				i = _find(0, cnt);
+			if (i == _bit_cnt)
+				return false;
+
+			_mark(i, cnt, true);
+			_next = i + cnt;
+			*out_addr = reinterpret_cast<void *>(i * _block_size + _base);
+			return true;
 		}
 
 		void free(void *addr, size_t size) override
 		{
-			addr_t i   = (((addr_t)addr) - _base) / _block_size;
-			size_t cnt = (size % _block_size) ? size / _block_size + 1
-			                                  : size / _block_size;
-			try { _array->clear(i, cnt); } catch(...) { }
+			addr_t const i   = (((addr_t)addr) - _base) / _block_size;
+			size_t const cnt = _blocks(size);
+
+			if (i >= _bit_cnt || cnt > _bit_cnt - i)
+				return;
+
+			_mark(i, cnt, false);
 			_next = i;
 		}
 
@@ -61,6 +61,11 @@
  * acknowledge buffers using the methods 'packet_avail',
  * 'ready_to_submit', 'ready_to_ack', and 'ack_avail'.
  *
+ * To reduce the signalling overhead, packets can be transferred in batches
+ * using 'submit_packets', 'get_packets', 'acknowledge_packets', and
+ * 'get_acked_packets'. For each batch, the respective other side receives at
+ * most one signal.
+ *
  * If bidirectional data exchange between two processes is desired, two pairs
  * of 'Packet_stream_source' and 'Packet_stream_sink' should be instantiated.
  */
@@ -81,6 +86,7 @@
 #include <dataspace/client.h>
 #include <util/string.h>
 #include <util/construct_at.h>
+#include <cpu/memory_barrier.h>
 
 namespace Genode {
 
@@ -152,15 +158,28 @@ class Genode::Packet_descriptor
  * Ring buffer shared between source and sink, containing packet descriptors
  *
  * This class is private to the packet-stream interface.
+ *
+ * The head index is written by the producer only whereas the tail index is
+ * written by the consumer only. Both indices are placed on distinct cache
+ * lines to prevent the producer and consumer from contending for the same
+ * cache line. Queue elements are published by updating the head index after
+ * the element was written (release) and read only after the head index was
+ * observed (acquire). Vice versa, the consumer releases a slot by updating
+ * the tail index after the element was read.
  */
 template <typename PACKET_DESCRIPTOR, int QUEUE_SIZE>
 class Genode::Packet_descriptor_queue
 {
 	private:
 
-		unsigned          _head;
-		unsigned          _tail;
-		PACKET_DESCRIPTOR _queue[QUEUE_SIZE];
+		enum { CACHE_LINE_SIZE = 64 };
+
+		unsigned          _head __attribute__((aligned(CACHE_LINE_SIZE)));
+		unsigned          _tail __attribute__((aligned(CACHE_LINE_SIZE)));
+		PACKET_DESCRIPTOR _queue[QUEUE_SIZE] __attribute__((aligned(CACHE_LINE_SIZE)));
+
+		static unsigned _next(unsigned index, unsigned n = 1) {
+			return (index + n)%QUEUE_SIZE; }
 
 	public:
 
@@ -195,11 +214,33 @@ class Genode::Packet_descriptor_queue
 		{
 			if (full()) return false;
 
-			_queue[_head%QUEUE_SIZE] = packet;
-			_head = (_head + 1)%QUEUE_SIZE;
+			_queue[_head] = packet;
+
+			memory_barrier();
+			_head = _next(_head);
 			return true;
 		}
 
+		/**
+		 * Place as many packet descriptors into queue as there are free slots
+		 *
+		 * \return number of added packet descriptors
+		 *
+		 * In contrast to calling 'add' for each packet, the head index is
+		 * published only once for the whole batch.
+		 */
+		unsigned add(PACKET_DESCRIPTOR const *packets, unsigned count)
+		{
+			unsigned const n = min(count, slots_free());
+
+			for (unsigned i = 0; i < n; i++)
+				_queue[_next(_head, i)] = packets[i];
+
+			memory_barrier();
+			_head = _next(_head, n);
+			return n;
+		}
+
 		/**
 		 * Take packet descriptor from queue
 		 *
@@ -207,17 +248,39 @@ class Genode::Packet_descriptor_queue
 		 */
 		PACKET_DESCRIPTOR get()
 		{
-			PACKET_DESCRIPTOR packet = _queue[_tail%QUEUE_SIZE];
-			_tail = (_tail + 1)%QUEUE_SIZE;
+			memory_barrier();
+			PACKET_DESCRIPTOR packet = _queue[_tail];
+
+			memory_barrier();
+			_tail = _next(_tail);
 			return packet;
 		}
 
+		/**
+		 * Take up to 'max' packet descriptors from queue
+		 *
+		 * \return number of packet descriptors stored at 'packets'
+		 */
+		unsigned get(PACKET_DESCRIPTOR *packets, unsigned max)
+		{
+			unsigned const n = min(max, used());
+
+			memory_barrier();
+			for (unsigned i = 0; i < n; i++)
+				packets[i] = _queue[_next(_tail, i)];
+
+			memory_barrier();
+			_tail = _next(_tail, n);
+			return n;
+		}
+
 		/**
 		 * Return current packet descriptor
 		 */
 		PACKET_DESCRIPTOR peek() const
 		{
-			return _queue[_tail%QUEUE_SIZE];
+			memory_barrier();
+			return _queue[_tail];
 		}
 
 		/**
@@ -228,25 +291,32 @@ class Genode::Packet_descriptor_queue
 		/**
 		 * Return true if packet-descriptor queue is full
 		 */
-		bool full() { return (_head + 1)%QUEUE_SIZE == _tail; }
+		bool full() { return _next(_head) == _tail; }
 
 		/**
 		 * Return true if a single element is stored in the queue
 		 */
-		bool single_element() { return (_tail + 1)%QUEUE_SIZE == _head; }
+		bool single_element() { return _next(_tail) == _head; }
 
 
 		/**
 		 * Return true if a single slot is left to be put into the queue
 		 */
-		bool single_slot_free() { return (_head + 2)%QUEUE_SIZE == _tail; }
+		bool single_slot_free() { return _next(_head, 2) == _tail; }
 
 		/**
 		 * Return number of slots left to be put into the queue
 		 */
-		unsigned slots_free() {
-			return ((_tail > _head) ? _tail - _head
-			                        : QUEUE_SIZE - _head + _tail) - 1; }
+		unsigned slots_free() { return QUEUE_SIZE - 1 - used(); }
+
+		/**
+		 * Return number of elements stored in the queue
+		 */
+		unsigned used()
+		{
+			unsigned const head = _head, tail = _tail;
+			return (head >= tail) ? head - tail : QUEUE_SIZE - tail + head;
+		}
 };
 
 
@@ -332,6 +402,39 @@ class Genode::Packet_descriptor_transmitter
 				_rx_ready.submit();
 		}
 
+		/**
+		 * Transmit batch of packet descriptors
+		 *
+		 * The receiver is signalled at most once per batch. Only if the
+		 * queue runs full, the packets added so far are signalled before
+		 * blocking for free slots.
+		 */
+		void tx(typename TX_QUEUE::Packet_descriptor const *packets,
+		        unsigned count)
+		{
+			Genode::Lock::Guard lock_guard(_tx_queue_lock);
+
+			while (count) {
+
+				unsigned const added = _tx_queue->add(packets, count);
+
+				packets += added;
+				count   -= added;
+
+				/*
+				 * If the queue holds no more elements than we just added,
+				 * the receiver may have observed an empty queue in the
+				 * meanwhile and waits for a signal.
+				 */
+				if (added && _tx_queue->used() <= added)
+					_rx_ready.submit();
+
+				/* block for signal if tx queue is full */
+				if (count && _tx_queue->full())
+					_tx_ready.wait_for_signal();
+			}
+		}
+
 		/**
 		 * Return number of slots left to be put into the tx queue
 		 */
@@ -413,6 +516,58 @@ class Genode::Packet_descriptor_receiver
 				_tx_ready.submit();
 		}
 
+		/**
+		 * Receive up to 'max' packet descriptors
+		 *
+		 * \param fn  functor called with each received packet descriptor
+		 * \return    number of received packet descriptors
+		 *
+		 * The method blocks until at least one packet descriptor is
+		 * available. The descriptors are taken from the queue in chunks.
+		 * The queue slots of each chunk are released before 'fn' is called
+		 * so that 'fn' may block, e.g., for acknowledging a packet. The
+		 * transmitter is signalled at most once per chunk.
+		 */
+		template <typename FN>
+		unsigned rx(unsigned max, FN const &fn)
+		{
+			enum { CHUNK_SIZE = 16 };
+
+			typename RX_QUEUE::Packet_descriptor chunk[CHUNK_SIZE];
+
+			unsigned total = 0;
+			while (total < max) {
+
+				unsigned n = 0;
+				{
+					Genode::Lock::Guard lock_guard(_rx_queue_lock);
+
+					if (total == 0)
+						while (_rx_queue->empty())
+							_rx_ready.wait_for_signal();
+
+					n = _rx_queue->get(chunk, min(max - total, (unsigned)CHUNK_SIZE));
+
+					/*
+					 * If the queue has no more free slots than we just
+					 * removed, the transmitter may have observed a full
+					 * queue and waits for a signal.
+					 */
+					if (n && _rx_queue->slots_free() <= n)
+						_tx_ready.submit();
+				}
+
+				if (n == 0)
+					break;
+
+				for (unsigned i = 0; i < n; i++)
+					fn(chunk[i]);
+
+				total += n;
+			}
+			return total;
+		}
+
 		typename RX_QUEUE::Packet_descriptor rx_peek() const
 		{
 			Genode::Lock::Guard lock_guard(_rx_queue_lock);
@@ -672,6 +827,12 @@ class Genode::Packet_stream_source : private Packet_stream_base
 			return _submit_transmitter.ready_for_tx();
 		}
 
+		/**
+		 * Returns number of slots left in the submit queue
+		 */
+		unsigned submit_slots_free() {
+			return _submit_transmitter.tx_slots_free(); }
+
 		/**
 		 * Tell sink about a packet to process
 		 */
@@ -680,6 +841,17 @@ class Genode::Packet_stream_source : private Packet_stream_base
 			_submit_transmitter.tx(packet);
 		}
 
+		/**
+		 * Tell sink about a batch of packets to process
+		 *
+		 * The sink gets signalled only once for the whole batch. This method
+		 * blocks while the submit queue is full.
+		 */
+		void submit_packets(Packet_descriptor const *packets, unsigned count)
+		{
+			_submit_transmitter.tx(packets, count);
+		}
+
 		/**
 		 * Returns true if one or more packet acknowledgements are available
 		 */
@@ -695,12 +867,30 @@ class Genode::Packet_stream_source : private Packet_stream_base
 			return packet;
 		}
 
+		/**
+		 * Get up to 'max' acknowledged packets
+		 *
+		 * \param fn  functor called with each acknowledged packet
+		 * \return    number of acknowledged packets
+		 *
+		 * This method blocks until at least one acknowledgement is available.
+		 */
+		template <typename FN>
+		unsigned get_acked_packets(unsigned max, FN const &fn)
+		{
+			return _ack_receiver.rx(max, fn);
+		}
+
 		/**
 		 * Release bulk-buffer space consumed by the packet
+		 *
+		 * Packets without payload occupy no bulk-buffer space and are
+		 * ignored.
 		 */
 		void release_packet(Packet_descriptor packet)
 		{
-			_packet_alloc->free((void *)packet.offset(), packet.size());
+			if (packet.valid())
+				_packet_alloc->free((void *)packet.offset(), packet.size());
 		}
 
 		void debug_print_buffers() {
@@ -812,6 +1002,24 @@ class Genode::Packet_stream_sink : private Packet_stream_base
 			return packet;
 		}
 
+		/**
+		 * Get up to 'max' packets from source
+		 *
+		 * \param fn  functor called with each valid packet
+		 * \return    number of packets taken from the submit queue
+		 *
+		 * This method blocks until at least one packet is available.
+		 * Packets referring to ranges outside the bulk buffer are dropped
+		 * without calling 'fn'.
+		 */
+		template <typename FN>
+		unsigned get_packets(unsigned max, FN const &fn)
+		{
+			return _submit_receiver.rx(max, [&] (Packet_descriptor packet) {
+				if (packet_valid(packet))
+					fn(packet); });
+		}
+
 		/**
 		 * Return but do not dequeue next packet
 		 *
@@ -856,6 +1064,17 @@ class Genode::Packet_stream_sink : private Packet_stream_base
 			_ack_transmitter.tx(packet);
 		}
 
+		/**
+		 * Acknowledge a batch of processed packets
+		 *
+		 * The source gets signalled only once for the whole batch. This
+		 * method blocks while the acknowledgement queue is full.
+		 */
+		void acknowledge_packets(Packet_descriptor const *packets, unsigned count)
+		{
+			_ack_transmitter.tx(packets, count);
+		}
+
 		void debug_print_buffers() {
 			Packet_stream_base::_debug_print_buffers(); }
 
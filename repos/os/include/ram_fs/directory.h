@@ -5,7 +5,7 @@
  */
 
 /*
- * Copyright (C) 2011-2015 Genode Labs GmbH
+ * Copyright (C) 2011-2016 Genode Labs GmbH
  *
  * This file is part of the Genode OS framework, which is distributed
  * under the terms of the GNU General Public License version 2.
@@ -29,37 +29,35 @@ class File_system::Directory : public Node
 {
 	private:
 
-		List<Node> _entries;
-		size_t     _num_entries;
+		Directory_index<Node> _entries;
 
 	public:
 
-		Directory(char const *name) : _num_entries(0) { Node::name(name); }
+		Directory(Allocator &alloc, char const *name) : _entries(alloc) {
+			Node::name(name); }
 
 		Node *entry_unsynchronized(size_t index)
 		{
-			Node *node = _entries.first();
-			for (unsigned i = 0; i < index && node; node = node->next(), i++);
-			return node;
+			return _entries.at(index);
 		}
 
 		bool has_sub_node_unsynchronized(char const *name) const
 		{
-			Node const *sub_node = _entries.first();
-			for (; sub_node; sub_node = sub_node->next())
-				if (strcmp(sub_node->name(), name) == 0)
-					return true;
-
-			return false;
+			return _entries.lookup(name) != 0;
 		}
 
+		/**
+		 * Add node to directory
+		 *
+		 * The name of the node must not change while the node is part of
+		 * the directory.
+		 */
 		void adopt_unsynchronized(Node *node)
 		{
 			/*
 			 * XXX inc ref counter
 			 */
 			_entries.insert(node);
-			_num_entries++;
 
 			mark_as_updated();
 		}
@@ -67,7 +65,6 @@ class File_system::Directory : public Node
 		void discard_unsynchronized(Node *node)
 		{
 			_entries.remove(node);
-			_num_entries--;
 
 			mark_as_updated();
 		}
@@ -102,11 +99,7 @@ class File_system::Directory : public Node
 			 */
 
 			/* try to find entry that matches the first path element */
-			Node *sub_node = _entries.first();
-			for (; sub_node; sub_node = sub_node->next())
-				if ((strlen(sub_node->name()) == i) &&
-					(strcmp(sub_node->name(), path, i) == 0))
-					break;
+			Node *sub_node = _entries.lookup(path, i);
 
 			if (!sub_node)
 				throw Lookup_failed();
@@ -224,7 +217,7 @@ class File_system::Directory : public Node
 			return 0;
 		}
 
-		size_t num_entries() const { return _num_entries; }
+		size_t num_entries() const { return _entries.count(); }
 };
 
 #endif /* _INCLUDE__RAM_FS__DIRECTORY_H_ */
@@ -0,0 +1,216 @@
+/*
+ * \brief  Index of directory entries by name and by position
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-27
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+#ifndef _INCLUDE__RAM_FS__DIRECTORY_INDEX_H_
+#define _INCLUDE__RAM_FS__DIRECTORY_INDEX_H_
+
+/* Genode includes */
+#include <base/allocator.h>
+#include <util/string.h>
+
+namespace File_system { template <typename> class Directory_index; }
+
+
+/**
+ * Index of the entries of a directory
+ *
+ * Entries are found by name via a hash table and by position via an array,
+ * both in constant time, so that enumerating a directory by index is
+ * linear in the number of entries. Removing an entry moves the last entry
+ * to the position of the removed one.
+ *
+ * The 'NODE' type must inherit 'Directory_index<NODE>::Element' and
+ * provide a 'name' method. The name of a node must not change while the
+ * node is part of an index.
+ */
+template <typename NODE>
+class File_system::Directory_index
+{
+	public:
+
+		class Element
+		{
+			private:
+
+				friend class Directory_index;
+
+				NODE          *_hash_next = nullptr;
+				unsigned long  _hash      = 0;
+				Genode::size_t _position  = 0;
+		};
+
+	private:
+
+		typedef Genode::size_t size_t;
+
+		enum { MIN_CAPACITY = 16 };
+
+		Genode::Allocator &_alloc;
+
+		/*
+		 * The hash table has as many buckets as the position array has
+		 * slots, which is a power of two.
+		 */
+		NODE  **_buckets  = nullptr;
+		NODE  **_entries  = nullptr;
+		size_t  _capacity = 0;
+		size_t  _count    = 0;
+
+		static unsigned long _hash(char const *name, size_t len)
+		{
+			unsigned long h = 5381;
+			for (size_t i = 0; i < len && name[i]; i++)
+				h = (h << 5) + h + (unsigned char)name[i];
+			return h;
+		}
+
+		static Element &_element(NODE *node) { return *node; }
+
+		NODE *&_bucket(unsigned long hash) {
+			return _buckets[hash & (_capacity - 1)]; }
+
+		NODE **_alloc_array(size_t num)
+		{
+			NODE **array = (NODE **)_alloc.alloc(num*sizeof(NODE *));
+			Genode::memset(array, 0, num*sizeof(NODE *));
+			return array;
+		}
+
+		void _free_array(NODE **array)
+		{
+			if (array)
+				_alloc.free(array, _capacity*sizeof(NODE *));
+		}
+
+		/**
+		 * Move index into arrays of 'capacity' slots
+		 *
+		 * \throw Allocator::Out_of_memory
+		 */
+		void _resize(size_t capacity)
+		{
+			NODE **entries = _alloc_array(capacity);
+			NODE **buckets = nullptr;
+			try { buckets = _alloc_array(capacity); }
+			catch (...) {
+				_alloc.free(entries, capacity*sizeof(NODE *));
+				throw;
+			}
+
+			for (size_t i = 0; i < _count; i++) {
+				NODE    *node = _entries[i];
+				Element &e    = _element(node);
+				NODE   *&head = buckets[e._hash & (capacity - 1)];
+
+				entries[i]   = node;
+				e._hash_next = head;
+				head         = node;
+			}
+
+			_free_array(_entries);
+			_free_array(_buckets);
+
+			_entries  = entries;
+			_buckets  = buckets;
+			_capacity = capacity;
+		}
+
+	public:
+
+		Directory_index(Genode::Allocator &alloc) : _alloc(alloc) { }
+
+		~Directory_index()
+		{
+			_free_array(_entries);
+			_free_array(_buckets);
+		}
+
+		size_t count() const { return _count; }
+
+		/**
+		 * Return entry at 'position' or 0 if out of range
+		 */
+		NODE *at(size_t position) const
+		{
+			return position < _count ? _entries[position] : nullptr;
+		}
+
+		/**
+		 * Return entry named by the first 'len' characters of 'name'
+		 */
+		NODE *lookup(char const *name, size_t len) const
+		{
+			if (!_count)
+				return nullptr;
+
+			unsigned long const hash = _hash(name, len);
+
+			NODE *node = _buckets[hash & (_capacity - 1)];
+			for (; node; node = _element(node)._hash_next)
+				if (_element(node)._hash == hash
+				 && Genode::strlen(node->name()) == len
+				 && Genode::strcmp(node->name(), name, len) == 0)
+					return node;
+
+			return nullptr;
+		}
+
+		NODE *lookup(char const *name) const {
+			return lookup(name, Genode::strlen(name)); }
+
+		/**
+		 * Add node to index
+		 *
+		 * \throw Allocator::Out_of_memory  the index is left unchanged
+		 */
+		void insert(NODE *node)
+		{
+			if (_count == _capacity)
+				_resize(_capacity ? 2*_capacity : (size_t)MIN_CAPACITY);
+
+			Element &e = _element(node);
+			e._hash     = _hash(node->name(), Genode::strlen(node->name()));
+			e._position = _count;
+
+			NODE *&head = _bucket(e._hash);
+			e._hash_next = head;
+			head         = node;
+
+			_entries[_count++] = node;
+		}
+
+		void remove(NODE *node)
+		{
+			Element &e = _element(node);
+
+			/* unlink node from its hash chain */
+			for (NODE **n = &_bucket(e._hash); *n; n = &_element(*n)._hash_next)
+				if (*n == node) {
+					*n = e._hash_next;
+					break;
+				}
+
+			/* fill the gap with the last entry */
+			NODE *last = _entries[--_count];
+			_entries[e._position]    = last;
+			_element(last)._position = e._position;
+			_entries[_count]         = nullptr;
+			e._hash_next             = nullptr;
+
+			/* release memory of directories that shrank considerably */
+			if (_capacity > MIN_CAPACITY && _count < _capacity/4)
+				try { _resize(_capacity/2); } catch (...) { }
+		}
+};
+
+#endif /* _INCLUDE__RAM_FS__DIRECTORY_INDEX_H_ */
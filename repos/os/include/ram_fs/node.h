@@ -5,7 +5,7 @@
  */
 
 /*
- * Copyright (C) 2012-2015 Genode Labs GmbH
+ * Copyright (C) 2012-2016 Genode Labs GmbH
  *
  * This file is part of the Genode OS framework, which is distributed
  * under the terms of the GNU General Public License version 2.
@@ -17,7 +17,7 @@
 /* Genode includes */
 #include <file_system/listener.h>
 #include <file_system/node.h>
-#include <util/list.h>
+#include <ram_fs/directory_index.h>
 
 namespace File_system {
 	using namespace Genode;
@@ -25,7 +25,7 @@ namespace File_system {
 }
 
 
-class File_system::Node : public Node_base, public List<Node>::Element
+class File_system::Node : public Node_base, public Directory_index<Node>::Element
 {
 	public:
 
@@ -16,6 +16,7 @@
 
 /* Genode includes */
 #include <util/volatile_object.h>
+#include <base/env.h>
 #include <os/attached_ram_dataspace.h>
 #include <os/session_policy.h>
 
@@ -34,6 +35,7 @@ namespace Rom {
 	typedef Genode::List<Module> Module_list;
 	typedef Genode::List<Reader> Reader_list;
 	typedef Genode::List<Writer> Writer_list;
+	typedef Genode::List<Buffer> Buffer_list;
 }
 
 
@@ -50,6 +52,35 @@ struct Rom::Reader : Reader_list::Element
 };
 
 
+/**
+ * Backing store of one version of the module content
+ *
+ * The content is kept in a RAM dataspace, which can be handed out to
+ * readers directly.
+ */
+class Rom::Buffer : public Buffer_list::Element
+{
+	private:
+
+		friend class Module;
+
+		Attached_ram_dataspace _ds;
+
+		size_t   _size       = 0; /* content size */
+		unsigned _generation = 0; /* version of the module content */
+		unsigned _users      = 0; /* readers sharing the buffer */
+
+	public:
+
+		Buffer(size_t capacity) : _ds(Genode::env()->ram_session(), capacity) { }
+
+		Genode::Dataspace_capability cap() const { return _ds.cap(); }
+
+		size_t   size()       const { return _size; }
+		unsigned generation() const { return _generation; }
+};
+
+
 struct Rom::Readable_module
 {
 	/**
@@ -68,6 +99,23 @@ struct Rom::Readable_module
 	                            size_t dst_len) const = 0;
 
 	virtual size_t size() const = 0;
+
+	/**
+	 * Obtain the buffer of the current content to share it with the reader
+	 *
+	 * The content of the buffer stays unchanged until the reader releases
+	 * the buffer. Further writes go to other buffers.
+	 *
+	 * \return buffer, or 0 if there is no content readable by the reader
+	 */
+	virtual Buffer *acquire_buffer(Reader const &reader) = 0;
+
+	virtual void release_buffer(Buffer &buffer) = 0;
+
+	/**
+	 * Return version of the current content
+	 */
+	virtual unsigned generation() const = 0;
 };
 
 
@@ -129,18 +177,61 @@ struct Rom::Module : Module_list::Element, Readable_module
 		Writer const *_last_writer = nullptr;
 
 		/**
-		 * Dataspace used as backing store
+		 * Buffers used as backing store
 		 *
-		 * The buffer for the content is not allocated from the heap to
-		 * allow for the immediate release of the underlying backing store when
-		 * the module gets destructed.
+		 * Usually, the content is written in place into the current buffer.
+		 * As long as readers share the current buffer, however, new content
+		 * goes to another buffer.
 		 */
-		Lazy_volatile_object<Attached_ram_dataspace> _ds;
+		Buffer_list _buffers;
+		Buffer     *_current    = nullptr;
+		unsigned    _generation = 0;
 
 		/**
-		 * Content size, which may less than the capacilty of '_ds'.
+		 * Return buffer with at least 'capacity' bytes not shared by readers
 		 */
-		size_t _size = 0;
+		Buffer &_writable_buffer(size_t capacity)
+		{
+			if (_current && !_current->_users && _current->_ds.size() >= capacity)
+				return *_current;
+
+			for (Buffer *b = _buffers.first(); b; b = b->next())
+				if (b != _current && !b->_users && b->_ds.size() >= capacity)
+					return *b;
+
+			Buffer *buffer = new (Genode::env()->heap()) Buffer(capacity);
+			_buffers.insert(buffer);
+			return *buffer;
+		}
+
+		/**
+		 * Destroy buffers not needed anymore
+		 *
+		 * While readers share buffers, one unused buffer is kept for the
+		 * next write.
+		 */
+		void _collect_buffers()
+		{
+			bool sharing = false;
+			for (Buffer *b = _buffers.first(); b; b = b->next())
+				sharing |= b->_users > 0;
+
+			bool spare = false;
+			for (Buffer *b = _buffers.first(), *next; b; b = next) {
+				next = b->next();
+
+				if (b == _current || b->_users)
+					continue;
+
+				if (sharing && !spare) {
+					spare = true;
+					continue;
+				}
+
+				_buffers.remove(b);
+				Genode::destroy(Genode::env()->heap(), b);
+			}
+		}
 
 
 		/********************************
@@ -194,9 +285,10 @@ struct Rom::Module : Module_list::Element, Readable_module
 
 			/* clear content if its origin disappears */
 			if (_last_writer == &writer) {
-				Genode::memset(_ds->local_addr<char>(), 0, _size);
-				_size = 0;
+				_current     = nullptr;
 				_last_writer = nullptr;
+				_generation++;
+				_collect_buffers();
 			}
 		}
 
@@ -218,6 +310,14 @@ struct Rom::Module : Module_list::Element, Readable_module
 
 	public:
 
+		~Module()
+		{
+			while (Buffer *b = _buffers.first()) {
+				_buffers.remove(b);
+				Genode::destroy(Genode::env()->heap(), b);
+			}
+		}
+
 		/**
 		 * Assign new content to the ROM module
 		 *
@@ -228,26 +328,26 @@ struct Rom::Module : Module_list::Element, Readable_module
 			if (!_write_policy.write_permitted(*this, writer))
 				return;
 
-			_size = 0;
-
 			_last_writer = &writer;
 
 			/*
-			 * Realloc backing store if needed
-			 *
 			 * Take a terminating zero into account, which we append to each
 			 * report. This way, we do not need to trust report clients to
 			 * append a zero termination to textual reports.
 			 */
-			if (!_ds.is_constructed() || _ds->size() < (src_len + 1))
-				_ds.construct(Genode::env()->ram_session(), (src_len + 1));
+			Buffer &buffer = _writable_buffer(src_len + 1);
 
 			/* copy content into backing store */
-			_size = src_len;
-			Genode::memcpy(_ds->local_addr<char>(), src, _size);
+			buffer._size = src_len;
+			Genode::memcpy(buffer._ds.local_addr<char>(), src, src_len);
 
 			/* append zero termination */
-			_ds->local_addr<char>()[src_len] = 0;
+			buffer._ds.local_addr<char>()[src_len] = 0;
+
+			buffer._generation = ++_generation;
+
+			_current = &buffer;
+			_collect_buffers();
 
 			/* notify ROM clients that access the module */
 			for (Reader *r = _readers.first(); r; r = r->next()) {
@@ -264,20 +364,50 @@ struct Rom::Module : Module_list::Element, Readable_module
 		 */
 		size_t read_content(Reader const &reader, char *dst, size_t dst_len) const override
 		{
-			if (!_ds.is_constructed() || !_last_writer)
+			if (!_current || !_last_writer)
 				return 0;
 
 			if (!_read_policy.read_permitted(*this, *_last_writer, reader))
 				return 0;
 
-			if (dst_len < _size)
+			if (dst_len < _current->_size)
 				throw Buffer_too_small();
 
-			Genode::memcpy(dst, _ds->local_addr<char>(), _size);
-			return _size;
+			Genode::memcpy(dst, _current->_ds.local_addr<char>(), _current->_size);
+			return _current->_size;
+		}
+
+		virtual size_t size() const override {
+			return _current ? _current->_size : 0; }
+
+		/**
+		 * Readable_module interface
+		 */
+		Buffer *acquire_buffer(Reader const &reader) override
+		{
+			if (!_current || !_current->_size || !_last_writer)
+				return 0;
+
+			if (!_read_policy.read_permitted(*this, *_last_writer, reader))
+				return 0;
+
+			_current->_users++;
+			return _current;
 		}
 
-		virtual size_t size() const override { return _size; }
+		/**
+		 * Readable_module interface
+		 */
+		void release_buffer(Buffer &buffer) override
+		{
+			buffer._users--;
+			_collect_buffers();
+		}
+
+		/**
+		 * Readable_module interface
+		 */
+		unsigned generation() const override { return _generation; }
 
 		Name name() const { return _name; }
 };
@@ -38,6 +38,12 @@ struct Rom::Registry_for_reader
 	                                Module::Name const &rom_label) = 0;
 
 	virtual void release(Reader &reader, Readable_module &module) = 0;
+
+	/**
+	 * Return true if the reader shares the backing store of the module
+	 * with other readers instead of obtaining a private copy
+	 */
+	virtual bool shared(Module::Name const &rom_label) { return false; }
 };
 
 
@@ -52,6 +52,24 @@ class Rom::Session_component : public Genode::Rpc_object<Genode::Rom_session>,
 
 		Lazy_volatile_object<Genode::Attached_ram_dataspace> _ds;
 
+		/**
+		 * Backing store of the module shared with other readers
+		 *
+		 * In shared mode, the client maps the module buffer directly.
+		 * Because the module never writes to a buffer in use by readers,
+		 * each update of the content costs only one copy regardless of the
+		 * number of readers.
+		 */
+		bool const _shared;
+		Buffer    *_buffer = nullptr;
+
+		void _release_buffer()
+		{
+			if (_buffer)
+				_module.release_buffer(*_buffer);
+			_buffer = nullptr;
+		}
+
 		size_t _content_size = 0;
 
 		/**
@@ -73,11 +91,13 @@ class Rom::Session_component : public Genode::Rpc_object<Genode::Rom_session>,
 		Session_component(Registry_for_reader &registry,
 		                  Genode::Session_label const &label)
 		:
-			_registry(registry), _label(label), _module(_init_module(label))
+			_registry(registry), _label(label), _module(_init_module(label)),
+			_shared(registry.shared(label.string()))
 		{ }
 
 		~Session_component()
 		{
+			_release_buffer();
 			_registry.release(*this, _module);
 		}
 
@@ -87,6 +107,20 @@ class Rom::Session_component : public Genode::Rpc_object<Genode::Rom_session>,
 		{
 			using namespace Genode;
 
+				if (_shared) {
+					_release_buffer();
+					_buffer = _module.acquire_buffer(*this);
+
+					if (_buffer) {
+						_ds.destruct();
+						_content_size = _buffer->size();
+						_valid = true;
+
+						Dataspace_capability ds_cap = _buffer->cap();
+						return static_cap_cast<Rom_dataspace>(ds_cap);
+					}
+				}
+
 				/* replace dataspace by new one */
 				/* XXX we could keep the old dataspace if the size fits */
 				_ds.construct(env()->ram_session(), _module.size());
@@ -104,6 +138,10 @@ class Rom::Session_component : public Genode::Rpc_object<Genode::Rom_session>,
 
 		bool update() override
 		{
+			/* the shared buffer stays valid only while it is up to date */
+			if (_buffer)
+				return _buffer->generation() == _module.generation();
+
 			if (!_ds.is_constructed() || _module.size() > _ds->size())
 				return false;
 
@@ -0,0 +1,37 @@
+/*
+ * \brief  CPU time counter used for extrapolating the time of a time page
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-22
+ *
+ * In contrast to 'Trace::timestamp', the time stamp counter is read without
+ * a preceding serializing instruction, which would cause a VM exit when
+ * executed in a virtual machine. The counter is assumed to run at a constant
+ * rate and synchronously on all CPUs.
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+#ifndef _INCLUDE__SPEC__X86__TIMER_SESSION__TIME_COUNTER_H_
+#define _INCLUDE__SPEC__X86__TIMER_SESSION__TIME_COUNTER_H_
+
+#include <base/fixed_stdint.h>
+
+namespace Timer {
+
+	/**
+	 * Return value of the time stamp counter
+	 */
+	inline Genode::uint64_t time_counter()
+	{
+		Genode::uint32_t lo, hi;
+		asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+		return (Genode::uint64_t)hi << 32 | lo;
+	}
+}
+
+#endif /* _INCLUDE__SPEC__X86__TIMER_SESSION__TIME_COUNTER_H_ */
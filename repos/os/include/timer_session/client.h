@@ -34,6 +34,8 @@ struct Timer::Session_client : Genode::Rpc_client<Session>
 	void sigh(Signal_context_capability sigh) override { call<Rpc_sigh>(sigh); }
 
 	unsigned long elapsed_ms() const override { return call<Rpc_elapsed_ms>(); }
+
+	Genode::Dataspace_capability time_page() override { return call<Rpc_time_page>(); }
 };
 
 #endif /* _INCLUDE__TIMER_SESSION__CLIENT_H_ */
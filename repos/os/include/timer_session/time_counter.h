@@ -0,0 +1,31 @@
+/*
+ * \brief  CPU time counter used for extrapolating the time of a time page
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-22
+ *
+ * This generic version is used on platforms without a time counter that is
+ * readable at user level. Platforms with such a counter provide a
+ * specialized version of this header.
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+#ifndef _INCLUDE__TIMER_SESSION__TIME_COUNTER_H_
+#define _INCLUDE__TIMER_SESSION__TIME_COUNTER_H_
+
+#include <base/fixed_stdint.h>
+
+namespace Timer {
+
+	/**
+	 * Return value of the time counter, or 0 if there is no counter
+	 */
+	inline Genode::uint64_t time_counter() { return 0; }
+}
+
+#endif /* _INCLUDE__TIMER_SESSION__TIME_COUNTER_H_ */
@@ -0,0 +1,160 @@
+/*
+ * \brief  Time base shared by the timer driver with its clients
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-22
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+#ifndef _INCLUDE__TIMER_SESSION__TIME_PAGE_H_
+#define _INCLUDE__TIMER_SESSION__TIME_PAGE_H_
+
+#include <base/lock.h>
+#include <cpu/memory_barrier.h>
+#include <os/attached_dataspace.h>
+#include <timer_session/time_counter.h>
+#include <timer_session/timer_session.h>
+
+namespace Timer {
+	struct Time_page;
+	class  Time_source;
+}
+
+
+/**
+ * Time page as provided via 'Session::time_page'
+ *
+ * The timer driver updates the page every 'UPDATE_PERIOD_US' microseconds.
+ * In between, readers extrapolate the time via the time counter of the CPU.
+ * The driver calibrates the rate of the counter against the platform timer.
+ * The page is protected by a sequence counter, which is odd while the
+ * driver updates the page.
+ */
+struct Timer::Time_page
+{
+	typedef Genode::uint64_t uint64_t;
+
+	enum { UPDATE_PERIOD_US = 1000*1000 };
+
+	unsigned long volatile seq;
+	uint64_t      volatile us;      /* microseconds since the driver started */
+	uint64_t      volatile counter; /* time counter at the update */
+	uint64_t      volatile scale;   /* microseconds per counter tick as 32.32
+	                                   fixed-point value, or 0 if the counter
+	                                   is not usable (yet) */
+
+	/**
+	 * Return true if the time is extrapolated via the time counter
+	 */
+	bool precise() const { return scale != 0; }
+
+	/**
+	 * Return microseconds since the driver started
+	 *
+	 * If the page is not 'precise', the result is the time of the last
+	 * update.
+	 */
+	uint64_t read() const
+	{
+		for (;;) {
+			unsigned long const s = seq;
+			Genode::memory_barrier();
+
+			uint64_t const t_us      = us;
+			uint64_t const t_counter = counter;
+			uint64_t const t_scale   = scale;
+
+			Genode::memory_barrier();
+			if ((s & 1) || s != seq)
+				continue;
+
+			if (!t_scale)
+				return t_us;
+
+			uint64_t const now = time_counter();
+			return now > t_counter ? t_us + (((now - t_counter)*t_scale) >> 32)
+			                       : t_us;
+		}
+	}
+};
+
+
+/**
+ * Client-side reader of the time page of a timer session
+ */
+class Timer::Time_source
+{
+	private:
+
+		typedef Genode::uint64_t uint64_t;
+
+		Session                   &_session;
+		Genode::Attached_dataspace _ds;
+		Time_page const           &_page;
+
+		Genode::Lock _lock;
+		bool         _anchored = false;
+		uint64_t     _offset   = 0; /* page time at session creation */
+		uint64_t     _last_us  = 0;
+
+		/*
+		 * Relate the page time to the session time once the page is
+		 * precise, so that the time continues seamlessly
+		 */
+		void _anchor()
+		{
+			_offset   = _page.read() - (uint64_t)_session.elapsed_ms()*1000;
+			_anchored = true;
+		}
+
+	public:
+
+		/**
+		 * Constructor
+		 *
+		 * \param session  timer session, which must outlive the time source
+		 */
+		Time_source(Session &session)
+		:
+			_session(session), _ds(session.time_page()),
+			_page(*_ds.local_addr<Time_page const>())
+		{ }
+
+		/**
+		 * Return true if the time is read without RPC
+		 */
+		bool precise() const { return _page.precise(); }
+
+		/**
+		 * Return microseconds since the creation of the timer session
+		 *
+		 * Until the timer driver calibrated the time counter, the time is
+		 * requested from the timer session at millisecond granularity. The
+		 * returned time never decreases.
+		 */
+		uint64_t elapsed_us()
+		{
+			bool const precise = _page.precise();
+
+			uint64_t const session_us =
+				precise ? 0 : (uint64_t)_session.elapsed_ms()*1000;
+
+			Genode::Lock::Guard guard(_lock);
+
+			if (precise && !_anchored)
+				_anchor();
+
+			uint64_t const us = precise ? _page.read() - _offset : session_us;
+			if (us > _last_us)
+				_last_us = us;
+
+			return _last_us;
+		}
+};
+
+#endif /* _INCLUDE__TIMER_SESSION__TIME_PAGE_H_ */
@@ -0,0 +1,52 @@
+/*
+ * \brief  Binary trace-event record
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-24
+ *
+ * The record is generated by the 'binary' trace policy and interpreted by
+ * the trace exporter. It must not depend on anything but fixed-size types
+ * because policy modules are built freestanding.
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+#ifndef _INCLUDE__TRACE__EVENT_RECORD_H_
+#define _INCLUDE__TRACE__EVENT_RECORD_H_
+
+#include <base/fixed_stdint.h>
+
+namespace Genode { namespace Trace { struct Event_record; } }
+
+
+/**
+ * Trace-buffer entry of the 'binary' policy
+ *
+ * All values are stored in the byte order of the traced CPU.
+ */
+struct Genode::Trace::Event_record
+{
+	enum Type {
+		RPC_CALL = 1, RPC_RETURNED, RPC_DISPATCH, RPC_REPLY,
+		SIGNAL_SUBMIT, SIGNAL_RECEIVED };
+
+	enum { MAX_NAME_LEN = 48 };
+
+	uint64_t timestamp;  /* value of 'Trace::timestamp()' */
+	uint32_t value;      /* number of signals, 0 for RPC events */
+	uint8_t  type;
+	uint8_t  name_len;   /* RPC name without termination */
+	uint16_t reserved;
+	char     name[0];
+
+	static unsigned long max_size() { return sizeof(Event_record) + MAX_NAME_LEN; }
+
+	unsigned long size() const { return sizeof(Event_record) + name_len; }
+
+} __attribute__((packed));
+
+#endif /* _INCLUDE__TRACE__EVENT_RECORD_H_ */
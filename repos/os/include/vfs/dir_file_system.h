@@ -1,6 +1,7 @@
 /*
  * \brief  Directory file system
  * \author Norman Feske
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
  * \date   2012-04-23
  */
 
@@ -15,6 +16,7 @@
 #define _INCLUDE__VFS__DIR_FILE_SYSTEM_H_
 
 #include <vfs/file_system_factory.h>
+#include <vfs/lookup_cache.h>
 #include <vfs/vfs_handle.h>
 
 
@@ -27,6 +29,9 @@ class Vfs::Dir_file_system : public File_system
 
 		enum { MAX_NAME_LEN = 128 };
 
+		/* number of lookup-cache entries of the root directory */
+		enum { DEFAULT_LOOKUP_CACHE = 128 };
+
 	private:
 
 		/* pointer to first child file system */
@@ -54,6 +59,92 @@ class Vfs::Dir_file_system : public File_system
 
 		bool _is_root() const { return _name[0] == 0; }
 
+		/* cache of paths resolved by our sub file systems, may be 0 */
+		Lookup_cache *_lookup_cache = nullptr;
+
+		typedef Lookup_cache::Node_type Node_type;
+
+		/**
+		 * Result of asking a sub file system for a path
+		 */
+		enum Probe { PROBE_UNKNOWN, PROBE_RESOLVED, PROBE_FAILED };
+
+		/**
+		 * Ask the sub file systems for 'path' until one of them knows it
+		 *
+		 * \param path  path local to our sub file systems
+		 * \param fn    functor that takes a file-system reference and a
+		 *              'Node_type' reference, which it may update, and
+		 *              returns a 'Probe' value
+		 *
+		 * The file system named by the lookup cache is asked first. If the
+		 * cache knows that no file system resolves the path, 'fn' is not
+		 * called at all. Otherwise, the outcome is recorded in the cache.
+		 */
+		template <typename FN>
+		Probe _resolve(char const *path, FN const &fn)
+		{
+			unsigned long const generation =
+				_lookup_cache ? _lookup_cache->generation() : 0;
+
+			if (_lookup_cache) {
+				Lookup_cache::Result const cached = _lookup_cache->lookup(path);
+
+				if (cached.state == Lookup_cache::Result::NEGATIVE)
+					return PROBE_UNKNOWN;
+
+				if (cached.state == Lookup_cache::Result::POSITIVE) {
+
+					Node_type type = cached.type;
+					Probe const probe = fn(*cached.fs, type);
+
+					if (probe == PROBE_RESOLVED && type != cached.type)
+						_lookup_cache->insert(path, *cached.fs, type, generation);
+
+					if (probe != PROBE_UNKNOWN)
+						return probe;
+
+					/* the path vanished from the file system */
+					_lookup_cache->drop(path);
+				}
+			}
+
+			for (File_system *fs = _first_file_system; fs; fs = fs->next) {
+
+				Node_type type = Lookup_cache::NODE_UNKNOWN;
+				Probe const probe = fn(*fs, type);
+
+				if (probe == PROBE_UNKNOWN)
+					continue;
+
+				if (probe == PROBE_RESOLVED && _lookup_cache)
+					_lookup_cache->insert(path, *fs, type, generation);
+
+				return probe;
+			}
+
+			if (_lookup_cache)
+				_lookup_cache->insert_negative(path, generation);
+
+			return PROBE_UNKNOWN;
+		}
+
+		/**
+		 * Invalidate cached lookups of 'path' and the paths below
+		 *
+		 * Called after modifying the name space. The 'path' is not yet
+		 * stripped by '_sub_path'.
+		 */
+		void _invalidate(char const *path)
+		{
+			if (!_lookup_cache)
+				return;
+
+			char const *sub_path = _sub_path(path);
+			if (sub_path)
+				_lookup_cache->invalidate(sub_path);
+		}
+
 		/**
 		 * Perform operation on a file system
 		 *
@@ -218,6 +309,20 @@ class Vfs::Dir_file_system : public File_system
 			else
 				node.attribute("name").value(_name, sizeof(_name));
 
+			/*
+			 * The lookup cache is enabled at the root by default. Negative
+			 * entries are only safe if no other component modifies the
+			 * underlying file systems and are therefore enabled on demand.
+			 */
+			unsigned const lookup_cache_size =
+				node.attribute_value("lookup_cache",
+				                     _is_root() ? (unsigned)DEFAULT_LOOKUP_CACHE : 0U);
+
+			if (lookup_cache_size)
+				_lookup_cache = new (env()->heap())
+					Lookup_cache(*env()->heap(), lookup_cache_size,
+					             node.attribute_value("negative_lookup_cache", false));
+
 			for (unsigned i = 0; i < node.num_sub_nodes(); i++) {
 
 				Xml_node sub_node = node.sub_node(i);
@@ -309,19 +414,29 @@ class Vfs::Dir_file_system : public File_system
 			 * The given path refers to one of our sub directories.
 			 * Propagate the request into our file systems.
 			 */
-			for (File_system *fs = _first_file_system; fs; fs = fs->next) {
+			Stat_result result = STAT_ERR_NO_ENTRY;
 
-				Stat_result const err = fs->stat(path, out);
+			auto stat_fn = [&] (File_system &fs, Node_type &type)
+			{
+				result = fs.stat(path, out);
 
-				if (err == STAT_OK)
-					return err;
+				switch (result) {
+				case STAT_ERR_NO_ENTRY: return PROBE_UNKNOWN;
+				case STAT_OK:           break;
+				default:                return PROBE_FAILED;
+				}
 
-				if (err != STAT_ERR_NO_ENTRY)
-					return err;
-			}
+				/* mask file-type bits of the mode */
+				type = ((out.mode & 0170000) == STAT_MODE_DIRECTORY)
+				     ? Lookup_cache::NODE_DIRECTORY : Lookup_cache::NODE_OTHER;
+				return PROBE_RESOLVED;
+			};
 
 			/* none of our file systems felt responsible for the path */
-			return STAT_ERR_NO_ENTRY;
+			if (_resolve(path, stat_fn) == PROBE_UNKNOWN)
+				return STAT_ERR_NO_ENTRY;
+
+			return result;
 		}
 
 		Dirent_result dirent(char const *path, file_offset index, Dirent &out) override
@@ -381,9 +496,56 @@ class Vfs::Dir_file_system : public File_system
 			if (strlen(path) == 0)
 				return true;
 
+			if (!_lookup_cache) {
+				for (File_system *fs = _first_file_system; fs; fs = fs->next)
+					if (fs->is_directory(path))
+						return true;
+
+				return false;
+			}
+
+			unsigned long const generation = _lookup_cache->generation();
+
+			Lookup_cache::Result const cached = _lookup_cache->lookup(path);
+
+			if (cached.state == Lookup_cache::Result::NEGATIVE)
+				return false;
+
+			/*
+			 * The node may have been replaced behind our back, e.g., a
+			 * directory by a file. So the cached type is not trusted but
+			 * confirmed by the cached file system.
+			 */
+			if (cached.state == Lookup_cache::Result::POSITIVE) {
+
+				File_system &fs = *cached.fs;
+
+				if (fs.is_directory(path)) {
+					if (cached.type != Lookup_cache::NODE_DIRECTORY)
+						_lookup_cache->insert(path, fs, Lookup_cache::NODE_DIRECTORY,
+						                      generation);
+					return true;
+				}
+
+				Stat stat;
+				if (fs.stat(path, stat) == STAT_OK
+				 && (stat.mode & 0170000) != STAT_MODE_DIRECTORY) {
+					if (cached.type != Lookup_cache::NODE_OTHER)
+						_lookup_cache->insert(path, fs, Lookup_cache::NODE_OTHER,
+						                      generation);
+					return false;
+				}
+
+				/* the path vanished from the file system */
+				_lookup_cache->drop(path);
+			}
+
 			for (File_system *fs = _first_file_system; fs; fs = fs->next)
-				if (fs->is_directory(path))
+				if (fs->is_directory(path)) {
+					_lookup_cache->insert(path, *fs, Lookup_cache::NODE_DIRECTORY,
+					                      generation);
 					return true;
+				}
 
 			return false;
 		}
@@ -397,13 +559,16 @@ class Vfs::Dir_file_system : public File_system
 			if (strlen(path) == 0)
 				return path;
 
-			for (File_system *fs = _first_file_system; fs; fs = fs->next) {
-				char const *leaf_path = fs->leaf_path(path);
-				if (leaf_path)
-					return leaf_path;
-			}
+			char const *leaf_path = 0;
 
-			return 0;
+			auto leaf_path_fn = [&] (File_system &fs, Node_type &)
+			{
+				leaf_path = fs.leaf_path(path);
+				return leaf_path ? PROBE_RESOLVED : PROBE_UNKNOWN;
+			};
+
+			_resolve(path, leaf_path_fn);
+			return leaf_path;
 		}
 
 		Open_result open(char const  *path,
@@ -439,20 +604,46 @@ class Vfs::Dir_file_system : public File_system
 				return OPEN_OK;
 			}
 
-			/* path refers to any of our sub file systems */
-			for (File_system *fs = _first_file_system; fs; fs = fs->next) {
+			/*
+			 * A file may be created by any of our file systems, so the
+			 * lookup cache cannot tell which one takes the request.
+			 */
+			if (mode & OPEN_MODE_CREATE) {
 
-				Open_result const err = fs->open(path, mode, out_handle, alloc);
-				switch (err) {
-				case OPEN_ERR_UNACCESSIBLE:
-					continue;
-				default:
-					return err;
+				Open_result result = OPEN_ERR_UNACCESSIBLE;
+
+				/* path refers to any of our sub file systems */
+				for (File_system *fs = _first_file_system; fs; fs = fs->next) {
+
+					result = fs->open(path, mode, out_handle, alloc);
+					if (result != OPEN_ERR_UNACCESSIBLE)
+						break;
 				}
+
+				if (_lookup_cache)
+					_lookup_cache->invalidate(path);
+
+				return result;
 			}
 
+			Open_result result = OPEN_ERR_UNACCESSIBLE;
+
+			auto open_fn = [&] (File_system &fs, Node_type &)
+			{
+				result = fs.open(path, mode, out_handle, alloc);
+
+				switch (result) {
+				case OPEN_ERR_UNACCESSIBLE: return PROBE_UNKNOWN;
+				case OPEN_OK:               return PROBE_RESOLVED;
+				default:                    return PROBE_FAILED;
+				}
+			};
+
 			/* path does not match any existing file or directory */
-			return OPEN_ERR_UNACCESSIBLE;
+			if (_resolve(path, open_fn) == PROBE_UNKNOWN)
+				return OPEN_ERR_UNACCESSIBLE;
+
+			return result;
 		}
 
 		void close(Vfs_handle *handle) override
@@ -468,8 +659,12 @@ class Vfs::Dir_file_system : public File_system
 				return fs.unlink(path);
 			};
 
-			return _dir_op(UNLINK_ERR_NO_ENTRY, UNLINK_ERR_NO_PERM, UNLINK_OK,
-			               path, unlink_fn);
+			Unlink_result const result =
+				_dir_op(UNLINK_ERR_NO_ENTRY, UNLINK_ERR_NO_PERM, UNLINK_OK,
+				        path, unlink_fn);
+
+			_invalidate(path);
+			return result;
 		}
 
 		Readlink_result readlink(char const *path, char *buf, file_size buf_size,
@@ -508,12 +703,18 @@ class Vfs::Dir_file_system : public File_system
 
 			Rename_result final = RENAME_ERR_NO_ENTRY;
 			for (File_system *fs = _first_file_system; fs; fs = fs->next) {
-				switch (fs->rename(from_path, to_path)) {
-				case RENAME_OK:           return RENAME_OK;
-				case RENAME_ERR_NO_ENTRY: continue;
-				case RENAME_ERR_NO_PERM:  return RENAME_ERR_NO_PERM;
-				case RENAME_ERR_CROSS_FS: final = RENAME_ERR_CROSS_FS;
-				}
+				Rename_result const result = fs->rename(from_path, to_path);
+				if (result == RENAME_ERR_NO_ENTRY)
+					continue;
+
+				final = result;
+				if (result != RENAME_ERR_CROSS_FS)
+					break;
+			}
+
+			if (_lookup_cache) {
+				_lookup_cache->invalidate(from_path);
+				_lookup_cache->invalidate(to_path);
 			}
 			return final;
 		}
@@ -525,8 +726,12 @@ class Vfs::Dir_file_system : public File_system
 				return fs.symlink(from, to);
 			};
 
-			return _dir_op(SYMLINK_ERR_NO_ENTRY, SYMLINK_ERR_NO_PERM, SYMLINK_OK,
-			               to, symlink_fn);
+			Symlink_result const result =
+				_dir_op(SYMLINK_ERR_NO_ENTRY, SYMLINK_ERR_NO_PERM, SYMLINK_OK,
+				        to, symlink_fn);
+
+			_invalidate(to);
+			return result;
 		}
 
 		Mkdir_result mkdir(char const *path, unsigned mode) override
@@ -536,8 +741,12 @@ class Vfs::Dir_file_system : public File_system
 				return fs.mkdir(path, mode);
 			};
 
-			return _dir_op(MKDIR_ERR_NO_ENTRY, MKDIR_ERR_NO_PERM, MKDIR_OK,
-			               path, mkdir_fn);
+			Mkdir_result const result =
+				_dir_op(MKDIR_ERR_NO_ENTRY, MKDIR_ERR_NO_PERM, MKDIR_OK,
+				        path, mkdir_fn);
+
+			_invalidate(path);
+			return result;
 		}
 
 
@@ -547,6 +756,17 @@ class Vfs::Dir_file_system : public File_system
 
 		char const *name() const { return "dir"; }
 
+		/**
+		 * Return statistics of the lookup cache
+		 *
+		 * All counters are zero if the cache is disabled.
+		 */
+		Lookup_cache::Stats lookup_cache_stats() const
+		{
+			return _lookup_cache ? _lookup_cache->stats()
+			                     : Lookup_cache::Stats { 0, 0, 0, 0, 0 };
+		}
+
 		/**
 		 * Synchronize all file systems
 		 */
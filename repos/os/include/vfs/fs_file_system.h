@@ -1,7 +1,19 @@
 /*
  * \brief  Adapter from Genode 'File_system' session to VFS
  * \author Norman Feske
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
  * \date   2011-02-17
+ *
+ * File content is transferred with several packets in flight. If enabled
+ * via the 'read_ahead' and 'write_behind' attributes of the '<fs>' node,
+ * sequential reads are served from a per-handle read-ahead window and small
+ * contiguous writes are coalesced into a per-handle write-behind buffer,
+ * which is flushed on 'sync', 'close', and before any other operation that
+ * could observe the file content.
+ *
+ * Both are disabled by default. Read-ahead data may be stale if another
+ * client modifies the file, and a write that is buffered cannot report a
+ * failure of the server, e.g., if it runs out of space.
  */
 
 /*
@@ -17,6 +29,7 @@
 /* Genode includes */
 #include <base/allocator_avl.h>
 #include <file_system_session/connection.h>
+#include <util/list.h>
 
 namespace Vfs { class Fs_file_system; }
 
@@ -46,22 +59,112 @@ class Vfs::Fs_file_system : public File_system
 
 		::File_system::Connection _fs;
 
-		class Fs_vfs_handle : public Vfs_handle
+		enum {
+			/* number of packets submitted to the server at once */
+			MAX_IN_FLIGHT = ::File_system::Session::TX_QUEUE_SIZE,
+
+			/* buffering is opt-in, see the description above */
+			DEFAULT_READ_AHEAD   = 0,
+			DEFAULT_WRITE_BEHIND = 0,
+		};
+
+		file_size const _read_ahead_size;
+		file_size const _write_behind_size;
+
+		/**
+		 * File content cached at the client side of a handle
+		 */
+		struct File_buffer
+		{
+			char     *data     = nullptr;
+			file_size capacity = 0;
+			file_size offset   = 0;   /* file offset of 'data' */
+			file_size length   = 0;
+
+			file_size end() const { return offset + length; }
+
+			bool contains(file_size pos) const {
+				return length && pos >= offset && pos < end(); }
+		};
+
+		class Fs_vfs_handle : public Vfs_handle,
+		                      public Genode::List<Fs_vfs_handle>::Element
 		{
 			private:
 
 				::File_system::File_handle const _handle;
 
+				void _alloc(File_buffer &buffer, file_size capacity)
+				{
+					if (!buffer.data) {
+						buffer.data     = (char *)alloc().alloc(capacity);
+						buffer.capacity = capacity;
+					}
+				}
+
+				void _free(File_buffer &buffer)
+				{
+					if (buffer.data)
+						alloc().free(buffer.data, buffer.capacity);
+				}
+
 			public:
 
+				File_buffer read_ahead;
+				File_buffer write_behind;
+
+				/* file offset following the last read, used to detect
+				 * sequential access */
+				file_size next_read = 0;
+
+				/*
+				 * A flush of write-behind data failed. The error is
+				 * reported by the next write or truncation of the handle.
+				 * From then on, the handle does not buffer writes anymore
+				 * so that each write reports its own outcome.
+				 */
+				bool write_error = false;
+				bool unbuffered  = false;
+
+				/**
+				 * Return and clear pending write error
+				 */
+				bool take_write_error()
+				{
+					bool const error = write_error;
+					write_error = false;
+					return error;
+				}
+
 				Fs_vfs_handle(File_system &fs, Allocator &alloc,
 				              int status_flags, ::File_system::File_handle handle)
 				: Vfs_handle(fs, fs, alloc, status_flags), _handle(handle)
 				{ }
 
+				~Fs_vfs_handle()
+				{
+					_free(read_ahead);
+					_free(write_behind);
+				}
+
 				::File_system::File_handle file_handle() const { return _handle; }
+
+				File_buffer &read_ahead_buffer(file_size capacity)
+				{
+					_alloc(read_ahead, capacity);
+					return read_ahead;
+				}
+
+				File_buffer &write_behind_buffer(file_size capacity)
+				{
+					_alloc(write_behind, capacity);
+					return write_behind;
+				}
 		};
 
+		/* open handles, needed for keeping their buffers coherent */
+		Genode::List<Fs_vfs_handle> _handles;
+
 		/**
 		 * Helper for managing the lifetime of temporary open node handles
 		 */
@@ -77,76 +180,176 @@ class Vfs::Fs_file_system : public File_system
 			~Fs_handle_guard() { _fs.close(_handle); }
 		};
 
-		file_size _read(::File_system::Node_handle node_handle, void *buf,
-		                file_size const count, file_size const seek_offset)
+		/**
+		 * Transfer 'count' bytes between 'buf' and the node at 'seek_offset'
+		 *
+		 * The transfer is split into packets, of which up to 'MAX_IN_FLIGHT'
+		 * are processed by the server while we wait for their
+		 * acknowledgements. The returned number of bytes is contiguous from
+		 * 'seek_offset', i.e., the transfer ends at the first packet that was
+		 * processed only partially, e.g., at the end of the file.
+		 *
+		 * Must be called with '_lock' held.
+		 */
+		file_size _transfer(::File_system::Node_handle node_handle,
+		                    ::File_system::Packet_descriptor::Opcode op,
+		                    char *buf, file_size const count,
+		                    file_size const seek_offset)
 		{
-			::File_system::Session::Tx::Source &source = *_fs.tx();
+			typedef ::File_system::Packet_descriptor Packet_descriptor;
+			typedef ::File_system::Session::Tx::Source Source;
 
-			file_size const max_packet_size = source.bulk_buffer_size() / 2;
-			file_size const clipped_count = min(max_packet_size, count);
+			Source &source = *_fs.tx();
 
-			::File_system::Packet_descriptor const
-				packet_in(source.alloc_packet(clipped_count),
-				          node_handle,
-				          ::File_system::Packet_descriptor::READ,
-				          clipped_count,
-				          seek_offset);
+			file_size const max_packet_size = source.bulk_buffer_size() / MAX_IN_FLIGHT;
 
-			/* pass packet to server side */
-			source.submit_packet(packet_in);
+			/* packets in flight in the order of their file offsets */
+			Packet_descriptor in_flight[MAX_IN_FLIGHT];
+			bool              acked[MAX_IN_FLIGHT];
+			unsigned          head = 0, num = 0;
 
-			/* obtain result packet descriptor with updated status info */
-			::File_system::Packet_descriptor const
-				packet_out = source.get_acked_packet();
+			file_size submitted = 0;   /* bytes covered by submitted packets */
+			file_size done      = 0;   /* bytes transferred contiguously */
+			bool      partial   = false;
 
-			file_size const read_num_bytes = min(packet_out.length(), count);
+			while (num || (!partial && submitted < count)) {
 
-			memcpy(buf, source.packet_content(packet_out), read_num_bytes);
+				/* submit as many packets as the bulk buffer can hold */
+				Packet_descriptor batch[MAX_IN_FLIGHT];
+				unsigned n = 0;
 
-			/*
-			 * XXX check if acked packet belongs to request,
-			 *     needed for thread safety
-			 */
+				while (!partial && submitted < count && num + n < MAX_IN_FLIGHT) {
 
-			source.release_packet(packet_out);
+					file_size const length = min(max_packet_size, count - submitted);
 
-			return read_num_bytes;
-		}
+					Packet_descriptor packet;
+					try {
+						packet = Packet_descriptor(source.alloc_packet(length),
+						                           node_handle, op, length,
+						                           seek_offset + submitted);
+					} catch (Source::Packet_alloc_failed) {
 
-		file_size _write(::File_system::Node_handle node_handle,
-		                 const char *buf, file_size count, file_size seek_offset)
-		{
-			::File_system::Session::Tx::Source &source = *_fs.tx();
+						/* wait for the release of packets in flight */
+						if (num + n)
+							break;
+						throw;
+					}
 
-			file_size const max_packet_size = source.bulk_buffer_size() / 2;
-			count = min(max_packet_size, count);
+					if (op == Packet_descriptor::WRITE)
+						memcpy(source.packet_content(packet), buf + submitted, length);
 
-			::File_system::Packet_descriptor
-				packet(source.alloc_packet(count),
-				       node_handle,
-				       ::File_system::Packet_descriptor::WRITE,
-				       count,
-				       seek_offset);
+					unsigned const slot = (head + num + n) % MAX_IN_FLIGHT;
+					in_flight[slot] = packet;
+					acked[slot]     = false;
 
-			memcpy(source.packet_content(packet), buf, count);
+					batch[n++] = packet;
+					submitted += length;
+				}
 
-			/* pass packet to server side */
-			source.submit_packet(packet);
+				if (n) {
+					source.submit_packets(batch, n);
+					num += n;
+				}
 
-			/* obtain result packet descriptor with updated status info */
-			::File_system::Packet_descriptor const
-				packet_out = source.get_acked_packet();
+				/* match acknowledgements to requests by their bulk-buffer offset */
+				source.get_acked_packets(num, [&] (Packet_descriptor const &packet) {
+					for (unsigned i = 0; i < num; i++) {
+						unsigned const slot = (head + i) % MAX_IN_FLIGHT;
+						if (!acked[slot] && in_flight[slot].offset() == packet.offset()) {
+							in_flight[slot] = packet;
+							acked[slot]     = true;
+							return;
+						}
+					}
+					PERR("acknowledgement of unknown packet");
+				});
 
-			/*
-			 * XXX check if acked packet belongs to request,
-			 *     needed for thread safety
-			 */
+				/* retire acknowledged requests in order */
+				while (num && acked[head]) {
+
+					Packet_descriptor const packet = in_flight[head];
+
+					if (!partial) {
+						file_size const length = min(packet.length(), packet.size());
+
+						if (op == Packet_descriptor::READ)
+							memcpy(buf + done, source.packet_content(packet), length);
+
+						done   += length;
+						partial = length < packet.size();
+					}
+
+					source.release_packet(packet);
+
+					head = (head + 1) % MAX_IN_FLIGHT;
+					num--;
+				}
+			}
+			return done;
+		}
+
+		file_size _read(::File_system::Node_handle node_handle, void *buf,
+		                file_size const count, file_size const seek_offset)
+		{
+			return _transfer(node_handle, ::File_system::Packet_descriptor::READ,
+			                 (char *)buf, count, seek_offset);
+		}
 
-			file_size const write_num_bytes = min(packet_out.length(), count);
+		file_size _write(::File_system::Node_handle node_handle,
+		                 const char *buf, file_size count, file_size seek_offset)
+		{
+			return _transfer(node_handle, ::File_system::Packet_descriptor::WRITE,
+			                 const_cast<char *>(buf), count, seek_offset);
+		}
+
+		/**
+		 * Write pending write-behind data of handle to the server
+		 *
+		 * \return false if not all data could be written, in which case
+		 *         the pending data is dropped and the error is kept
+		 *         pending at the handle
+		 */
+		bool _flush(Fs_vfs_handle &handle)
+		{
+			File_buffer &buffer = handle.write_behind;
+			if (!buffer.length)
+				return true;
+
+			file_size const written = _write(handle.file_handle(), buffer.data,
+			                                 buffer.length, buffer.offset);
+			bool const ok = (written == buffer.length);
+			if (!ok) {
+				PWRN("only %llu of %llu pending bytes have been written",
+				     written, buffer.length);
+				handle.write_error = true;
+				handle.unbuffered  = true;
+			}
 
-			source.release_packet(packet);
+			buffer.length = 0;
+			return ok;
+		}
 
-			return write_num_bytes;
+		/**
+		 * Flush the write-behind data of all handles
+		 *
+		 * Called before the server is asked for information that depends on
+		 * the file content, e.g., the content itself or the file size.
+		 */
+		void _flush_all()
+		{
+			for (Fs_vfs_handle *h = _handles.first(); h; h = h->next())
+				_flush(*h);
+		}
+
+		/**
+		 * Discard the read-ahead data of all handles
+		 *
+		 * Called whenever file content is modified via this file system.
+		 */
+		void _invalidate_read_ahead()
+		{
+			for (Fs_vfs_handle *h = _handles.first(); h; h = h->next())
+				h->read_ahead.length = 0;
 		}
 
 	public:
@@ -159,7 +362,11 @@ class Vfs::Fs_file_system : public File_system
 			_fs(_fs_packet_alloc,
 			    ::File_system::DEFAULT_TX_BUF_SIZE,
 			    _label.string(), _root.string(),
-			    config.attribute_value("writeable", true))
+			    config.attribute_value("writeable", true)),
+			_read_ahead_size(config.attribute_value("read_ahead",
+			                 Genode::Number_of_bytes(DEFAULT_READ_AHEAD))),
+			_write_behind_size(config.attribute_value("write_behind",
+			                   Genode::Number_of_bytes(DEFAULT_WRITE_BEHIND)))
 		{ }
 
 
@@ -181,6 +388,8 @@ class Vfs::Fs_file_system : public File_system
 			Ram_dataspace_capability ds_cap;
 			char *local_addr = 0;
 
+			_flush_all();
+
 			try {
 				::File_system::Dir_handle dir = _fs.dir(dir_path.base(),
 				                                        false);
@@ -193,47 +402,20 @@ class Vfs::Fs_file_system : public File_system
 
 				::File_system::Status status = _fs.status(file);
 
-				Ram_dataspace_capability ds_cap =
-				    env()->ram_session()->alloc(status.size);
+				ds_cap = env()->ram_session()->alloc(status.size);
 
 				local_addr = env()->rm_session()->attach(ds_cap);
 
-				::File_system::Session::Tx::Source &source = *_fs.tx();
-				file_size const max_packet_size = source.bulk_buffer_size() / 2;
-
-				for (file_size seek_offset = 0; seek_offset < status.size;
-				     seek_offset += max_packet_size) {
-
-					file_size const count = min(max_packet_size, status.size -
-					                                             seek_offset);
-
-					::File_system::Packet_descriptor
-						packet(source.alloc_packet(count),
-							   file,
-							   ::File_system::Packet_descriptor::READ,
-							   count,
-							   seek_offset);
-
-					/* pass packet to server side */
-					source.submit_packet(packet);
-					source.get_acked_packet();
-
-					memcpy(local_addr + seek_offset, source.packet_content(packet), count);
-
-					/*
-					 * XXX check if acked packet belongs to request,
-					 *     needed for thread safety
-					 */
-
-					source.release_packet(packet);
-				}
+				_read(file, local_addr, status.size, 0);
 
 				env()->rm_session()->detach(local_addr);
 
 				return ds_cap;
 			} catch(...) {
-				env()->rm_session()->detach(local_addr);
-				env()->ram_session()->free(ds_cap);
+				if (local_addr)
+					env()->rm_session()->detach(local_addr);
+				if (ds_cap.valid())
+					env()->ram_session()->free(ds_cap);
 				return Dataspace_capability();
 			}
 		}
@@ -246,6 +428,11 @@ class Vfs::Fs_file_system : public File_system
 
 		Stat_result stat(char const *path, Stat &out) override
 		{
+			Lock::Guard guard(_lock);
+
+			/* account pending writes in the file size */
+			_flush_all();
+
 			::File_system::Status status;
 
 			try {
@@ -278,8 +465,6 @@ class Vfs::Fs_file_system : public File_system
 		{
 			Lock::Guard guard(_lock);
 
-			::File_system::Session::Tx::Source &source = *_fs.tx();
-
 			if (strcmp(path, "") == 0)
 				path = "/";
 
@@ -290,29 +475,18 @@ class Vfs::Fs_file_system : public File_system
 			catch (...) { return DIRENT_ERR_NO_PERM; }
 			Fs_handle_guard dir_guard(_fs, dir_handle);
 
-			enum { DIRENT_SIZE = sizeof(::File_system::Directory_entry) };
-
-			::File_system::Packet_descriptor
-				packet(source.alloc_packet(DIRENT_SIZE),
-				       dir_handle,
-				       ::File_system::Packet_descriptor::READ,
-				       DIRENT_SIZE,
-				       index*DIRENT_SIZE);
-
-			/* pass packet to server side */
-			source.submit_packet(packet);
-			source.get_acked_packet();
-
-			/*
-			 * XXX check if acked packet belongs to request,
-			 *     needed for thread safety
-			 */
-
 			typedef ::File_system::Directory_entry Directory_entry;
 
-			/* copy-out payload into destination buffer */
-			Directory_entry const *entry =
-				(Directory_entry *)source.packet_content(packet);
+			Directory_entry entry;
+			file_size const length = _read(dir_handle, &entry, sizeof(entry),
+			                               index*sizeof(entry));
+
+			if (length < sizeof(entry)) {
+				out.fileno  = 0;
+				out.type    = DIRENT_TYPE_END;
+				out.name[0] = 0;
+				return DIRENT_OK;
+			}
 
 			/*
 			 * The default value has no meaning because the switch below
@@ -321,17 +495,15 @@ class Vfs::Fs_file_system : public File_system
 			 */
 			Dirent_type type = DIRENT_TYPE_END;
 
-			switch (entry->type) {
+			switch (entry.type) {
 			case Directory_entry::TYPE_DIRECTORY: type = DIRENT_TYPE_DIRECTORY; break;
 			case Directory_entry::TYPE_FILE:      type = DIRENT_TYPE_FILE;      break;
 			case Directory_entry::TYPE_SYMLINK:   type = DIRENT_TYPE_SYMLINK;   break;
 			}
 
-			out.fileno = entry->inode;
+			out.fileno = entry.inode;
 			out.type   = type;
-			strncpy(out.name, entry->name, sizeof(out.name));
-
-			source.release_packet(packet);
+			strncpy(out.name, entry.name, sizeof(out.name));
 
 			return DIRENT_OK;
 		}
@@ -363,6 +535,8 @@ class Vfs::Fs_file_system : public File_system
 		Readlink_result readlink(char const *path, char *buf, file_size buf_size,
 		                         file_size &out_len) override
 		{
+			Lock::Guard guard(_lock);
+
 			/*
 			 * Canonicalize path (i.e., path must start with '/')
 			 */
@@ -555,7 +729,9 @@ class Vfs::Fs_file_system : public File_system
 				::File_system::File_handle file = _fs.file(dir, file_name.base() + 1,
 				                                           mode, create);
 
-				*out_handle = new (alloc) Fs_vfs_handle(*this, alloc, vfs_mode, file);
+				Fs_vfs_handle *handle = new (alloc) Fs_vfs_handle(*this, alloc, vfs_mode, file);
+				_handles.insert(handle);
+				*out_handle = handle;
 			}
 			catch (::File_system::Lookup_failed)       { return OPEN_ERR_UNACCESSIBLE;  }
 			catch (::File_system::Permission_denied)   { return OPEN_ERR_NO_PERM;       }
@@ -569,6 +745,11 @@ class Vfs::Fs_file_system : public File_system
 			return OPEN_OK;
 		}
 
+		/*
+		 * A write error that is still pending at the handle, or that
+		 * occurs while flushing its write-behind data, cannot be reported
+		 * by 'close' and is lost.
+		 */
 		void close(Vfs_handle *vfs_handle) override
 		{
 			if (!vfs_handle) return;
@@ -578,6 +759,8 @@ class Vfs::Fs_file_system : public File_system
 			Fs_vfs_handle *fs_handle = static_cast<Fs_vfs_handle *>(vfs_handle);
 
 			if (fs_handle) {
+				_flush(*fs_handle);
+				_handles.remove(fs_handle);
 				_fs.close(fs_handle->file_handle());
 				destroy(fs_handle->alloc(), fs_handle);
 			}
@@ -590,8 +773,17 @@ class Vfs::Fs_file_system : public File_system
 
 		static char const *name() { return "fs"; }
 
+		/*
+		 * The interface does not allow for reporting errors. An error that
+		 * occurs while flushing write-behind data stays pending at the
+		 * affected handle.
+		 */
 		void sync(char const *path) override
 		{
+			Lock::Guard guard(_lock);
+
+			_flush_all();
+
 			try {
 				::File_system::Node_handle node = _fs.node(path);
 				_fs.sync(node);
@@ -609,9 +801,47 @@ class Vfs::Fs_file_system : public File_system
 		{
 			Lock::Guard guard(_lock);
 
-			Fs_vfs_handle const *handle = static_cast<Fs_vfs_handle *>(vfs_handle);
+			Fs_vfs_handle &handle = *static_cast<Fs_vfs_handle *>(vfs_handle);
+
+			file_size const seek = handle.seek();
+
+			out_count = 0;
+
+			/* report failed flush of previously buffered data */
+			if (handle.take_write_error())
+				return WRITE_ERR_IO;
+
+			/* read-ahead data of any handle may refer to the written range */
+			_invalidate_read_ahead();
+
+			/* coalesce small writes */
+			if (buf_size < _write_behind_size && !handle.unbuffered) {
+
+				File_buffer &buffer = handle.write_behind_buffer(_write_behind_size);
 
-			out_count = _write(handle->file_handle(), buf, buf_size, handle->seek());
+				if (buffer.length && (seek != buffer.end()
+				                   || buffer.length + buf_size > buffer.capacity))
+					if (!_flush(handle)) {
+						handle.take_write_error();
+						return WRITE_ERR_IO;
+					}
+
+				if (!buffer.length)
+					buffer.offset = seek;
+
+				memcpy(buffer.data + buffer.length, buf, buf_size);
+				buffer.length += buf_size;
+
+				out_count = buf_size;
+				return WRITE_OK;
+			}
+
+			if (!_flush(handle)) {
+				handle.take_write_error();
+				return WRITE_ERR_IO;
+			}
+
+			out_count = _write(handle.file_handle(), buf, buf_size, seek);
 
 			return WRITE_OK;
 		}
@@ -621,24 +851,74 @@ class Vfs::Fs_file_system : public File_system
 		{
 			Lock::Guard guard(_lock);
 
-			Fs_vfs_handle const *handle = static_cast<Fs_vfs_handle *>(vfs_handle);
+			Fs_vfs_handle &handle = *static_cast<Fs_vfs_handle *>(vfs_handle);
 
-			::File_system::Status status = _fs.status(handle->file_handle());
-			file_size const size_of_file = status.size;
+			/* make pending writes visible to the read */
+			_flush_all();
 
-			file_size const file_bytes_left = size_of_file >= handle->seek()
-			                                ? size_of_file  - handle->seek() : 0;
+			file_size const seek = handle.seek();
 
-			count = min(count, file_bytes_left);
+			/*
+			 * Only sequential reads are served from the read-ahead window.
+			 * A repeated read of the same range always consults the server.
+			 */
+			bool const sequential = (seek == handle.next_read);
+			if (!sequential)
+				handle.read_ahead.length = 0;
 
-			out_count = _read(handle->file_handle(), dst, count, handle->seek());
+			out_count = 0;
+
+			while (out_count < count) {
+
+				file_size const offset = seek + out_count;
+				file_size const left   = count - out_count;
+
+				File_buffer &window = handle.read_ahead;
+
+				if (window.contains(offset)) {
+					file_size const n = min(left, window.end() - offset);
+					memcpy(dst + out_count, window.data + (offset - window.offset), n);
+					out_count += n;
+
+					/* the window ended at the end of the file */
+					if (window.length < window.capacity && offset + n == window.end())
+						break;
+
+					continue;
+				}
+
+				/* large or random reads go directly to the destination */
+				if (!sequential || left >= _read_ahead_size) {
+					out_count += _read(handle.file_handle(), dst + out_count, left, offset);
+					break;
+				}
+
+				File_buffer &buffer = handle.read_ahead_buffer(_read_ahead_size);
+
+				buffer.offset = offset;
+				buffer.length = _read(handle.file_handle(), buffer.data,
+				                      buffer.capacity, offset);
+				if (!buffer.length)
+					break;
+			}
+
+			handle.next_read = seek + out_count;
 
 			return READ_OK;
 		}
 
 		Ftruncate_result ftruncate(Vfs_handle *vfs_handle, file_size len) override
 		{
-			Fs_vfs_handle const *handle = static_cast<Fs_vfs_handle *>(vfs_handle);
+			Lock::Guard guard(_lock);
+
+			Fs_vfs_handle *handle = static_cast<Fs_vfs_handle *>(vfs_handle);
+
+			_flush(*handle);
+			_invalidate_read_ahead();
+
+			/* report failed flush of previously buffered data */
+			if (handle->take_write_error())
+				return FTRUNCATE_ERR_NO_SPACE;
 
 			try {
 				_fs.truncate(handle->file_handle(), len);
@@ -0,0 +1,288 @@
+/*
+ * \brief  Cache of path lookups within a directory file system
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-26
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+#ifndef _INCLUDE__VFS__LOOKUP_CACHE_H_
+#define _INCLUDE__VFS__LOOKUP_CACHE_H_
+
+#include <vfs/types.h>
+
+namespace Vfs {
+	class File_system;
+	class Lookup_cache;
+}
+
+
+/**
+ * Direct-mapped cache that maps paths to the file system resolving them
+ *
+ * A positive entry names the sub file system that resolved the path, a
+ * negative entry records that none of the sub file systems knows the path.
+ * Paths longer than 'MAX_PATH_LEN' are not cached.
+ *
+ * Another component may modify the underlying file systems behind our
+ * back. Hence, positive entries are mere hints that the user confirms with
+ * the named file system before relying on them.
+ *
+ * Entries are invalidated by the directory file system whenever it
+ * modifies the name space. Because lookups are performed without holding
+ * the cache lock, results are inserted only if no invalidation happened
+ * since the lookup started, as tracked by the cache generation.
+ */
+class Vfs::Lookup_cache
+{
+	public:
+
+		enum { MAX_PATH_LEN = 128 };
+
+		enum Node_type { NODE_UNKNOWN, NODE_DIRECTORY, NODE_OTHER };
+
+		struct Result
+		{
+			enum State { MISS, NEGATIVE, POSITIVE };
+
+			State        state;
+			File_system *fs;
+			Node_type    type;
+		};
+
+		struct Stats
+		{
+			unsigned long hits;
+			unsigned long negative_hits;
+			unsigned long misses;
+			unsigned long evictions;
+			unsigned long invalidations;
+		};
+
+	private:
+
+		struct Entry
+		{
+			bool          valid;
+			unsigned long hash;
+			File_system  *fs;     /* 0 for negative entry */
+			Node_type     type;
+			char          path[MAX_PATH_LEN];
+		};
+
+		Genode::Allocator &_alloc;
+		Lock               _lock;
+
+		unsigned const _size;
+		bool     const _negative;
+		Entry  * const _entries;
+
+		unsigned long _generation = 0;
+		Stats         _stats { 0, 0, 0, 0, 0 };
+
+		/**
+		 * Copy path to 'dst' with repeated and trailing slashes removed
+		 *
+		 * \return false if the path does not fit into 'dst'
+		 */
+		static bool _normalize(char const *path, char (&dst)[MAX_PATH_LEN])
+		{
+			unsigned len = 0;
+			for (char const *s = path; *s; s++) {
+
+				if (*s == '/' && len && dst[len - 1] == '/')
+					continue;
+
+				if (len + 1 >= MAX_PATH_LEN)
+					return false;
+
+				dst[len++] = *s;
+			}
+
+			if (len > 1 && dst[len - 1] == '/')
+				len--;
+
+			dst[len] = 0;
+			return true;
+		}
+
+		static unsigned long _hash(char const *path)
+		{
+			unsigned long h = 5381;
+			for (; *path; path++)
+				h = (h << 5) + h + (unsigned char)*path;
+			return h;
+		}
+
+		Entry &_slot(unsigned long hash) { return _entries[hash % _size]; }
+
+		/**
+		 * Return true if 'path' equals 'prefix' or lies below it
+		 */
+		static bool _below(char const *path, char const *prefix)
+		{
+			if (strcmp(prefix, "/") == 0)
+				return true;
+
+			Genode::size_t const len = strlen(prefix);
+			return strcmp(path, prefix, len) == 0
+			    && (path[len] == 0 || path[len] == '/');
+		}
+
+		void _insert(char const *path, File_system *fs, Node_type type,
+		             unsigned long generation)
+		{
+			char key[MAX_PATH_LEN];
+			if (!_normalize(path, key))
+				return;
+
+			unsigned long const hash = _hash(key);
+
+			Lock::Guard guard(_lock);
+
+			if (generation != _generation)
+				return;
+
+			Entry &e = _slot(hash);
+
+			if (e.valid && (e.hash != hash || strcmp(e.path, key) != 0))
+				_stats.evictions++;
+
+			e.valid = true;
+			e.hash  = hash;
+			e.fs    = fs;
+			e.type  = type;
+			strncpy(e.path, key, sizeof(e.path));
+		}
+
+	public:
+
+		/**
+		 * Constructor
+		 *
+		 * \param size      number of entries
+		 * \param negative  cache paths that are unknown to all file
+		 *                  systems
+		 */
+		Lookup_cache(Genode::Allocator &alloc, unsigned size, bool negative)
+		:
+			_alloc(alloc), _size(size), _negative(negative),
+			_entries((Entry *)alloc.alloc(size*sizeof(Entry)))
+		{
+			for (unsigned i = 0; i < _size; i++)
+				_entries[i].valid = false;
+		}
+
+		~Lookup_cache() { _alloc.free(_entries, _size*sizeof(Entry)); }
+
+		/**
+		 * Return generation to be passed to subsequent insertions
+		 */
+		unsigned long generation()
+		{
+			Lock::Guard guard(_lock);
+			return _generation;
+		}
+
+		Result lookup(char const *path)
+		{
+			Result result { Result::MISS, 0, NODE_UNKNOWN };
+
+			char key[MAX_PATH_LEN];
+			if (!_normalize(path, key))
+				return result;
+
+			unsigned long const hash = _hash(key);
+
+			Lock::Guard guard(_lock);
+
+			Entry const &e = _slot(hash);
+
+			if (!e.valid || e.hash != hash || strcmp(e.path, key) != 0) {
+				_stats.misses++;
+				return result;
+			}
+
+			if (e.fs) {
+				_stats.hits++;
+				result.state = Result::POSITIVE;
+				result.fs    = e.fs;
+				result.type  = e.type;
+			} else {
+				_stats.negative_hits++;
+				result.state = Result::NEGATIVE;
+			}
+			return result;
+		}
+
+		/**
+		 * Record that 'fs' resolved 'path'
+		 */
+		void insert(char const *path, File_system &fs, Node_type type,
+		            unsigned long generation)
+		{
+			_insert(path, &fs, type, generation);
+		}
+
+		/**
+		 * Record that no file system knows 'path'
+		 */
+		void insert_negative(char const *path, unsigned long generation)
+		{
+			if (_negative)
+				_insert(path, 0, NODE_UNKNOWN, generation);
+		}
+
+		/**
+		 * Drop entry of 'path', e.g., if it turned out to be stale
+		 */
+		void drop(char const *path)
+		{
+			char key[MAX_PATH_LEN];
+			if (!_normalize(path, key))
+				return;
+
+			unsigned long const hash = _hash(key);
+
+			Lock::Guard guard(_lock);
+
+			Entry &e = _slot(hash);
+			if (e.valid && e.hash == hash && strcmp(e.path, key) == 0)
+				e.valid = false;
+		}
+
+		/**
+		 * Invalidate entries of 'path' and of all paths below
+		 */
+		void invalidate(char const *path)
+		{
+			char key[MAX_PATH_LEN];
+			bool const fits = _normalize(path, key);
+
+			Lock::Guard guard(_lock);
+
+			_generation++;
+			_stats.invalidations++;
+
+			for (unsigned i = 0; i < _size; i++) {
+				Entry &e = _entries[i];
+
+				/* an overlong path may still be the prefix of a cached one */
+				if (e.valid && (!fits || _below(e.path, key)))
+					e.valid = false;
+			}
+		}
+
+		Stats stats()
+		{
+			Lock::Guard guard(_lock);
+			return _stats;
+		}
+};
+
+#endif /* _INCLUDE__VFS__LOOKUP_CACHE_H_ */
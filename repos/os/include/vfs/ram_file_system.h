@@ -1,6 +1,7 @@
 /*
  * \brief  Embedded RAM VFS
  * \author Emery Hemingway
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
  * \date   2015-07-21
  */
 
@@ -15,9 +16,9 @@
 #define _INCLUDE__VFS__RAM_FILE_SYSTEM_H_
 
 #include <ram_fs/chunk.h>
+#include <ram_fs/directory_index.h>
 #include <vfs/file_system.h>
 #include <dataspace/client.h>
-#include <util/avl_tree.h>
 
 namespace Vfs_ram {
 
@@ -52,7 +53,8 @@ namespace Vfs_ram {
 namespace Vfs { class Ram_file_system; }
 
 
-class Vfs_ram::Node : public Genode::Avl_node<Node>, public Genode::Lock
+class Vfs_ram::Node : public ::File_system::Directory_index<Node>::Element,
+                      public Genode::Lock
 {
 	private:
 
@@ -81,45 +83,6 @@ class Vfs_ram::Node : public Genode::Avl_node<Node>, public Genode::Lock
 
 		virtual Vfs::file_size length() = 0;
 
-		/************************
-		 ** Avl node interface **
-		 ************************/
-
-		bool higher(Node *c) { return (strcmp(c->_name, _name) > 0); }
-
-		/**
-		 * Find index N by walking down the tree N times,
-		 * not the most efficient way to do this.
-		 */
-		Node *index(file_offset &i)
-		{
-			if (i-- == 0)
-				return this;
-
-			Node *n;
-
-			n = child(LEFT);
-			if (n)
-				n = n->index(i);
-
-			if (n) return n;
-
-			n = child(RIGHT);
-			if (n)
-				n = n->index(i);
-
-			return n;
-		}
-
-		Node *sibling(const char *name)
-		{
-			if (strcmp(name, _name) == 0) return this;
-
-			Node *c =
-				Avl_node<Node>::child(strcmp(name, _name) > 0);
-			return c ? c->sibling(name) : 0;
-		}
-
 		struct Guard
 		{
 			Node *node;
@@ -263,17 +226,16 @@ class Vfs_ram::Directory : public Vfs_ram::Node
 {
 	private:
 
-		Avl_tree<Node>  _entries;
-		file_size       _count = 0;
+		::File_system::Directory_index<Node> _entries;
 
 	public:
 
-		Directory(char const *name)
-		: Node(name) { }
+		Directory(char const *name, Allocator &alloc)
+		: Node(name), _entries(alloc) { }
 
 		void empty(Allocator &alloc)
 		{
-			while (Node *node = _entries.first()) {
+			while (Node *node = _entries.at(0)) {
 				_entries.remove(node);
 				if (File *file = dynamic_cast<File*>(node)) {
 					if (file->close_but_keep())
@@ -285,30 +247,22 @@ class Vfs_ram::Directory : public Vfs_ram::Node
 			}
 		}
 
-		void adopt(Node *node)
-		{
-			_entries.insert(node);
-			++_count;
-		}
+		/**
+		 * Add node to directory
+		 *
+		 * \throw Out_of_memory
+		 */
+		void adopt(Node *node) { _entries.insert(node); }
 
-		Node *child(char const *name)
-		{
-			Node *node = _entries.first();
-			return node ? node->sibling(name) : 0;
-		}
+		Node *child(char const *name) { return _entries.lookup(name); }
 
-		void release(Node *node)
-		{
-			_entries.remove(node);
-			--_count;
-		}
+		void release(Node *node) { _entries.remove(node); }
 
-		file_size length() override { return _count; }
+		file_size length() override { return _entries.count(); }
 
 		void dirent(file_offset index, Directory_service::Dirent &dirent)
 		{
-			Node *node = _entries.first();
-			if (node) node = node->index(index);
+			Node *node = index >= 0 ? _entries.at(index) : 0;
 			if (!node) {
 				dirent.type = Directory_service::DIRENT_TYPE_END;
 				return;
@@ -357,7 +311,7 @@ class Vfs::Ram_file_system : public Vfs::File_system
 		};
 
 		Genode::Allocator  &_alloc;
-		Vfs_ram::Directory  _root = { "" };
+		Vfs_ram::Directory  _root = { "", _alloc };
 
 		Vfs_ram::Node *lookup(char const *path, bool return_parent = false)
 		{
@@ -468,8 +422,15 @@ class Vfs::Ram_file_system : public Vfs::File_system
 
 			if (parent->child(name)) return MKDIR_ERR_EXISTS;
 
-			try { parent->adopt(new (_alloc) Directory(name)); }
-			catch (Out_of_memory) { return MKDIR_ERR_NO_SPACE; }
+			Directory *dir = 0;
+			try {
+				dir = new (_alloc) Directory(name, _alloc);
+				parent->adopt(dir);
+			} catch (Out_of_memory) {
+				if (dir)
+					destroy(_alloc, dir);
+				return MKDIR_ERR_NO_SPACE;
+			}
 
 			return MKDIR_OK;
 		}
@@ -495,7 +456,12 @@ class Vfs::Ram_file_system : public Vfs::File_system
 
 				try { file = new (_alloc) File(name, _alloc); }
 				catch (Out_of_memory) { return OPEN_ERR_NO_SPACE; }
-				parent->adopt(file);
+
+				try { parent->adopt(file); }
+				catch (Out_of_memory) {
+					destroy(_alloc, file);
+					return OPEN_ERR_NO_SPACE;
+				}
 			} else {
 				Node *node = lookup(path);
 				if (!node) return OPEN_ERR_UNACCESSIBLE;
@@ -595,8 +561,13 @@ class Vfs::Ram_file_system : public Vfs::File_system
 				try { link = new (_alloc) Symlink(name); }
 				catch (Out_of_memory) { return SYMLINK_ERR_NO_SPACE; }
 
+				try { parent->adopt(link); }
+				catch (Out_of_memory) {
+					destroy(_alloc, link);
+					return SYMLINK_ERR_NO_SPACE;
+				}
+
 				link->lock();
-				parent->adopt(link);
 			}
 
 			if (*target)
@@ -666,7 +637,18 @@ class Vfs::Ram_file_system : public Vfs::File_system
 
 			from_dir->release(from_node);
 			from_node->name(new_name);
-			to_dir->adopt(from_node);
+
+			/*
+			 * Re-adding the node to 'from_dir' cannot fail because releasing
+			 * a node never shrinks the directory index below the former
+			 * number of entries.
+			 */
+			try { to_dir->adopt(from_node); }
+			catch (Out_of_memory) {
+				from_node->name(basename(from));
+				from_dir->adopt(from_node);
+				return RENAME_ERR_NO_PERM;
+			}
 
 			return RENAME_OK;
 		}
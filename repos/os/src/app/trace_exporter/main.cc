@@ -0,0 +1,427 @@
+/*
+ * \brief  Stream trace buffers to a file
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-24
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+/* Genode includes */
+#include <base/allocator_avl.h>
+#include <base/env.h>
+#include <dataspace/client.h>
+#include <file_system/util.h>
+#include <file_system_session/connection.h>
+#include <os/config.h>
+#include <os/server.h>
+#include <rom_session/connection.h>
+#include <timer_session/connection.h>
+#include <trace/timestamp.h>
+#include <trace_session/connection.h>
+
+/* local includes */
+#include <stream.h>
+
+namespace Trace_exporter {
+
+	using namespace Genode;
+
+	struct Subject;
+	class  Output;
+	struct Main;
+
+	enum {
+		BLOCK_SIZE  = 512,
+		QUEUE_SIZE  = File_system::Session::TX_QUEUE_SIZE,
+		TX_BUF_SIZE = BLOCK_SIZE * (QUEUE_SIZE*2 + 1)
+	};
+}
+
+
+/**
+ * Trace subject followed by the exporter
+ */
+struct Trace_exporter::Subject : List<Subject>::Element
+{
+	Trace::Subject_id const id;
+
+	Trace::Buffer const  &buffer;
+	Trace::Buffer::Reader reader { buffer };
+
+	unsigned long reported_lost = 0;
+	unsigned long events        = 0;
+
+	static Trace::Buffer const &_attach(Dataspace_capability ds)
+	{
+		Trace::Buffer const *buffer = env()->rm_session()->attach(ds);
+		return *buffer;
+	}
+
+	Subject(Trace::Subject_id id, Dataspace_capability buffer_ds)
+	: id(id), buffer(_attach(buffer_ds)) { }
+
+	~Subject() { env()->rm_session()->detach(&buffer); }
+};
+
+
+/**
+ * Buffer for records that are written to the file in large chunks
+ */
+class Trace_exporter::Output
+{
+	private:
+
+		File_system::Session     &_fs;
+		File_system::File_handle  _file;
+
+		size_t const _capacity;
+		char * const _buf;
+		size_t       _len    = 0;
+		size_t       _offset = 0;  /* file offset of '_buf' */
+
+	public:
+
+		Output(File_system::Session &fs, File_system::File_handle file,
+		       size_t capacity)
+		:
+			_fs(fs), _file(file), _capacity(capacity),
+			_buf((char *)env()->heap()->alloc(capacity))
+		{ }
+
+		~Output()
+		{
+			flush();
+			env()->heap()->free(_buf, _capacity);
+		}
+
+		size_t length() const { return _len; }
+		size_t avail()  const { return _capacity - _len; }
+
+		/**
+		 * Drop records appended after 'length' was 'len'
+		 */
+		void rewind(size_t len) { _len = min(len, _len); }
+
+		void append(void const *src, size_t len)
+		{
+			if (len > avail())
+				flush();
+
+			len = min(len, avail());
+			memcpy(_buf + _len, src, len);
+			_len += len;
+		}
+
+		/**
+		 * Append header of a record with 'len' bytes of payload
+		 */
+		void header(Trace::Subject_id id, Record_header::Type type, size_t len)
+		{
+			Record_header const header { (uint32_t)id.id, (uint16_t)type,
+			                             (uint16_t)len };
+			append(&header, sizeof(header));
+		}
+
+		void record(Trace::Subject_id id, Record_header::Type type,
+		            void const *payload, size_t len)
+		{
+			header(id, type, len);
+			append(payload, len);
+		}
+
+		void flush()
+		{
+			if (!_len)
+				return;
+
+			size_t const written = File_system::write(_fs, _file, _buf, _len, _offset);
+			if (written < _len)
+				PWRN("%zu of %zu bytes have been written", written, _len);
+
+			_offset += _len;
+			_len     = 0;
+		}
+};
+
+
+struct Trace_exporter::Main
+{
+	Server::Entrypoint &ep;
+
+	enum { MAX_SUBJECTS = 512, ARG_BUFFER_SIZE = 32*1024 };
+
+	typedef String<64> Name;
+
+	Xml_node const config = Genode::config()->xml_node();
+
+	Name   const policy_name = config.attribute_value("policy", Name("binary"));
+	Name   const file_name   = config.attribute_value("file", Name("trace.bin"));
+	size_t const buffer_size = config.attribute_value("buffer_size",
+	                                                  Number_of_bytes(64*1024));
+	size_t const trace_quota = config.attribute_value("trace_quota",
+	                                                  Number_of_bytes(4*1024*1024));
+
+	unsigned long const period_ms = config.attribute_value("period_ms", 100UL);
+	bool          const verbose   = config.attribute_value("verbose", false);
+
+	Timer::Connection timer;
+
+	Trace::Connection trace { trace_quota, ARG_BUFFER_SIZE, 0 };
+	Trace::Policy_id  policy { _load_policy() };
+
+	Trace::Subject_id subject_ids[MAX_SUBJECTS];
+	List<Subject>     subjects;
+
+	Allocator_avl           fs_alloc { env()->heap() };
+	File_system::Connection fs { fs_alloc, TX_BUF_SIZE };
+
+	/**
+	 * Return upper bound of the output of exporting one subject
+	 *
+	 * An export covers at most two rounds of the trace buffer. An entry
+	 * occupies its payload plus a 'size_t' in the trace buffer but its
+	 * payload plus a 'Record_header' in the output, which is larger on
+	 * 32-bit platforms. The ratio is highest for entries of one byte.
+	 */
+	static size_t _round_size(size_t buffer_size)
+	{
+		size_t const entry  = sizeof(size_t) + 1;
+		size_t const record = max(sizeof(Record_header), sizeof(size_t)) + 1;
+
+		return (2*buffer_size*record + entry - 1) / entry;
+	}
+
+	size_t const round_size = _round_size(buffer_size);
+
+	/*
+	 * The records of an export must never be flushed partially because
+	 * they are dropped if the reader detects an inconsistency. Hence, the
+	 * output is flushed before each export unless it has room for a
+	 * complete round.
+	 */
+	Output output { fs, _open_file(), round_size + 4096 };
+
+	Trace::Policy_id _load_policy();
+
+	File_system::File_handle _open_file();
+
+	/**
+	 * Return true if the subject is selected by a '<subject>' config node
+	 */
+	bool _selected(Trace::Subject_info const &info) const;
+
+	Subject *_lookup(Trace::Subject_id id)
+	{
+		for (Subject *s = subjects.first(); s; s = s->next())
+			if (s->id == id)
+				return s;
+
+		return nullptr;
+	}
+
+	void _follow(Trace::Subject_id id, Trace::Subject_info const &info);
+
+	void _export(Subject &subject);
+
+	void _handle_period(unsigned);
+
+	Signal_rpc_member<Main> _period_dispatcher = {
+		ep, *this, &Main::_handle_period };
+
+	/**
+	 * Measure rate of the trace timestamps
+	 */
+	uint64_t _timestamps_per_ms()
+	{
+		enum { MEASURE_MS = 100 };
+		Trace::Timestamp const start = Trace::timestamp();
+		timer.msleep(MEASURE_MS);
+		return (Trace::timestamp() - start)/MEASURE_MS;
+	}
+
+	Main(Server::Entrypoint &ep) : ep(ep)
+	{
+		Stream_header const header(_timestamps_per_ms());
+		output.append(&header, sizeof(header));
+		output.flush();
+
+		timer.sigh(_period_dispatcher);
+		timer.trigger_periodic(1000*period_ms);
+	}
+};
+
+
+Genode::Trace::Policy_id Trace_exporter::Main::_load_policy()
+{
+	Rom_connection policy_rom(policy_name.string());
+	Dataspace_capability rom_ds = policy_rom.dataspace();
+	size_t const rom_size = Dataspace_client(rom_ds).size();
+
+	Trace::Policy_id const id = trace.alloc_policy(rom_size);
+
+	void *ram = env()->rm_session()->attach(trace.policy(id));
+	void *rom = env()->rm_session()->attach(rom_ds);
+	memcpy(ram, rom, rom_size);
+
+	env()->rm_session()->detach(ram);
+	env()->rm_session()->detach(rom);
+	return id;
+}
+
+
+File_system::File_handle Trace_exporter::Main::_open_file()
+{
+	using namespace File_system;
+
+	Dir_handle   dir = ensure_dir(fs, "/");
+	Handle_guard dir_guard(fs, dir);
+
+	File_handle file;
+	try { file = fs.file(dir, file_name.string(), WRITE_ONLY, true); }
+	catch (Node_already_exists) {
+		file = fs.file(dir, file_name.string(), WRITE_ONLY, false); }
+
+	fs.truncate(file, 0);
+	return file;
+}
+
+
+bool Trace_exporter::Main::_selected(Trace::Subject_info const &info) const
+{
+	bool selected = false;
+
+	config.for_each_sub_node("subject", [&] (Xml_node node) {
+
+		typedef Trace::Session_label Label;
+		typedef Trace::Thread_name   Thread;
+
+		if (node.attribute_value("label", Label()) != info.session_label())
+			return;
+
+		if (node.has_attribute("thread")
+		 && node.attribute_value("thread", Thread()) != info.thread_name())
+			return;
+
+		selected = true;
+	});
+	return selected;
+}
+
+
+void Trace_exporter::Main::_follow(Trace::Subject_id id,
+                                   Trace::Subject_info const &info)
+{
+	try {
+		trace.trace(id, policy, buffer_size);
+
+		Subject *subject = new (env()->heap()) Subject(id, trace.buffer(id));
+		subjects.insert(subject);
+	}
+	catch (Trace::Source_is_dead)          { return; }
+	catch (Trace::Traced_by_other_session) { return; }
+	catch (Trace::Out_of_metadata) {
+		PWRN("trace quota exceeded, cannot follow \"%s\" %s",
+		     info.session_label().string(), info.thread_name().string());
+		return;
+	}
+
+	char const *label  = info.session_label().string();
+	char const *thread = info.thread_name().string();
+
+	Subject_record const record {
+		(uint32_t)info.affinity().xpos(), (uint32_t)info.affinity().ypos(),
+		(uint8_t)strlen(label), (uint8_t)strlen(thread) };
+
+	output.header(id, Record_header::SUBJECT,
+	              sizeof(record) + record.label_len + record.thread_len);
+	output.append(&record, sizeof(record));
+	output.append(label,   record.label_len);
+	output.append(thread,  record.thread_len);
+}
+
+
+void Trace_exporter::Main::_export(Subject &subject)
+{
+	if (output.avail() < round_size)
+		output.flush();
+
+	size_t const  mark   = output.length();
+	unsigned long events = 0;
+
+	bool const valid = subject.reader.for_each_new_entry([&] (Trace::Buffer::Entry entry) {
+		output.record(subject.id, Record_header::EVENT, entry.data(), entry.length());
+		events++;
+	});
+
+	/* entries were overwritten while being copied */
+	if (!valid) {
+		output.rewind(mark);
+		events = 0;
+	}
+
+	subject.events += events;
+
+	unsigned long const lost = subject.reader.lost();
+	if (lost != subject.reported_lost) {
+		Lost_record const record { Trace::timestamp(),
+		                           (uint32_t)(lost - subject.reported_lost) };
+		output.record(subject.id, Record_header::LOST, &record, sizeof(record));
+		subject.reported_lost = lost;
+	}
+}
+
+
+void Trace_exporter::Main::_handle_period(unsigned)
+{
+	unsigned num_subjects = 0;
+	try { num_subjects = trace.subjects(subject_ids, MAX_SUBJECTS); }
+	catch (Trace::Out_of_metadata) { PWRN("trace quota exceeded"); }
+
+	for (unsigned i = 0; i < num_subjects; i++) {
+
+		Trace::Subject_id const id = subject_ids[i];
+		Trace::Subject_info const info = trace.subject_info(id);
+
+		Subject *subject = _lookup(id);
+
+		if (!subject) {
+			if (info.state() == Trace::Subject_info::UNTRACED && _selected(info))
+				_follow(id, info);
+			continue;
+		}
+
+		_export(*subject);
+
+		if (verbose)
+			PLOG("\"%s\" %s: %lu events, %lu losses",
+			     info.session_label().string(), info.thread_name().string(),
+			     subject->events, subject->reported_lost);
+
+		/* the buffer of a dead thread does not change anymore */
+		if (info.state() == Trace::Subject_info::DEAD) {
+			subjects.remove(subject);
+			destroy(env()->heap(), subject);
+			trace.free(id);
+		}
+	}
+
+	output.flush();
+}
+
+
+namespace Server {
+
+	char const *name() { return "trace_exporter_ep"; }
+
+	size_t stack_size() { return 4*1024*sizeof(long); }
+
+	void construct(Entrypoint &ep)
+	{
+		static Trace_exporter::Main main(ep);
+	}
+}
@@ -0,0 +1,97 @@
+/*
+ * \brief  Format of the trace stream written by the trace exporter
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-24
+ *
+ * The stream starts with a 'Stream_header' followed by records. Each
+ * record consists of a 'Record_header' and 'length' bytes of payload. All
+ * values are stored in the byte order of the machine running the exporter.
+ * The 'tool/trace_to_json' script converts the stream to the trace-event
+ * JSON format understood by trace viewers like Chrome's 'about:tracing'.
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+#ifndef _STREAM_H_
+#define _STREAM_H_
+
+/* Genode includes */
+#include <base/fixed_stdint.h>
+
+namespace Trace_exporter {
+
+	using Genode::uint8_t;
+	using Genode::uint16_t;
+	using Genode::uint32_t;
+	using Genode::uint64_t;
+
+	struct Stream_header;
+	struct Record_header;
+	struct Subject_record;
+	struct Lost_record;
+}
+
+
+struct Trace_exporter::Stream_header
+{
+	enum { MAGIC = 0x43525447 /* "GTRC" */, VERSION = 1 };
+
+	uint32_t magic   = MAGIC;
+	uint32_t version = VERSION;
+
+	/* rate of 'Trace::timestamp', measured by the exporter */
+	uint64_t timestamps_per_ms;
+
+	Stream_header(uint64_t timestamps_per_ms)
+	: timestamps_per_ms(timestamps_per_ms) { }
+
+} __attribute__((packed));
+
+
+struct Trace_exporter::Record_header
+{
+	enum Type {
+		SUBJECT = 1, /* payload is a 'Subject_record'                  */
+		EVENT   = 2, /* payload is a trace-buffer entry of the policy  */
+		LOST    = 3  /* payload is a 'Lost_record'                     */
+	};
+
+	uint32_t subject;  /* trace-subject ID */
+	uint16_t type;
+	uint16_t length;   /* size of the payload in bytes */
+
+} __attribute__((packed));
+
+
+/**
+ * Description of a trace subject, emitted once when tracing starts
+ *
+ * The record is followed by the session label and the thread name without
+ * termination.
+ */
+struct Trace_exporter::Subject_record
+{
+	uint32_t xpos;        /* affinity of the thread */
+	uint32_t ypos;
+	uint8_t  label_len;
+	uint8_t  thread_len;
+
+} __attribute__((packed));
+
+
+/**
+ * Entries of a subject lost since the previous record of the subject
+ */
+struct Trace_exporter::Lost_record
+{
+	uint64_t timestamp;   /* time of the detection */
+	uint32_t count;       /* number of detected losses */
+
+} __attribute__((packed));
+
+#endif /* _STREAM_H_ */
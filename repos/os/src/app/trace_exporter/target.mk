@@ -0,0 +1,4 @@
+TARGET = trace_exporter
+SRC_CC = main.cc
+LIBS   = base config server
+INC_DIR += $(PRG_DIR)
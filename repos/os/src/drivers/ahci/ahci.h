@@ -242,6 +242,27 @@ struct Command_fis : Genode::Mmio
 		/* packet command */
 		write<Command>(0xa0);
 	}
+
+	void flush_cache_ext()
+	{
+		write<Bits::C>(1);
+		write<Device::Lba>(1);
+		write<Command>(0xea);
+	}
+
+	/**
+	 * Data set management command with TRIM bit set
+	 *
+	 * \param range_blocks  number of 512-byte blocks of LBA range entries
+	 */
+	void trim(Genode::size_t range_blocks)
+	{
+		write<Bits::C>(1);
+		write<Device::Lba>(1);
+		write<Command>(0x06);
+		write<Features>(1);
+		write<Sector>(range_blocks);
+	}
 };
 
 
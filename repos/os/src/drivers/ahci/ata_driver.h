@@ -5,7 +5,7 @@
  */
 
 /*
- * Copyright (C) 2015 Genode Labs GmbH
+ * Copyright (C) 2015-2016 Genode Labs GmbH
  *
  * This file is part of the Genode OS framework, which is distributed
  * under the terms of the GNU General Public License version 2.
@@ -39,8 +39,16 @@ struct Identity : Genode::Mmio
 		struct Ncq_support : Bitfield<8, 1> { };
 	};
 
+	struct Cmd_set_2   : Register<0xa6, 16>
+	{
+		struct Flush_cache_ext : Bitfield<13, 1> { };
+	};
+
 	struct Sector_count : Register<0xc8, 64> { };
 
+	/* maximum number of 512-byte blocks of LBA range entries per TRIM */
+	struct Dsm_max_blocks : Register<0xd2, 16> { };
+
 	struct Logical_block  : Register<0xd4, 16>
 	{
 		struct Per_physical : Bitfield<0,  3> { }; /* 2^X logical per physical */
@@ -50,6 +58,11 @@ struct Identity : Genode::Mmio
 
 	struct Logical_words : Register<0xea, 32> { }; /* words (16 bit) per logical block */
 
+	struct Data_set_mgmt : Register<0x152, 16>
+	{
+		struct Trim : Bitfield<0, 1> { };
+	};
+
 	struct Alignment : Register<0x1a2, 16>
 	{
 		struct Logical_offset : Bitfield<0, 14> { }; /* offset first logical block in physical */
@@ -61,6 +74,9 @@ struct Identity : Genode::Mmio
 		     read<Queue_depth::Max_depth>() + 1,
 		     read<Sata_caps::Ncq_support>());
 		PLOG("\t\tnumer of sectors: %llu", read<Sector_count>());
+		PLOG("\t\tflush cache ext: %u trim: %u",
+		     read<Cmd_set_2::Flush_cache_ext>(),
+		     read<Data_set_mgmt::Trim>());
 		PLOG("\t\tmultiple logical blocks per physical: %s",
 		     read<Logical_block::Multiple>() ? "yes" : "no");
 		PLOG("\t\tlogical blocks per physical: %u",
@@ -181,6 +197,11 @@ struct Ata_driver : Port_driver
 
 	Io_command                               *io_cmd = nullptr;
 	Block::Packet_descriptor                  pending[32];
+	unsigned                                  issue = 0; /* slots to start */
+
+	/* buffer holding the LBA range entries of a TRIM command */
+	Ram_dataspace_capability                  trim_ds;
+	addr_t                                    trim_ranges = 0;
 
 	Ata_driver(Port &port, Signal_context_capability state_change)
 	: Port_driver(port, state_change)
@@ -193,6 +214,39 @@ struct Ata_driver : Port_driver
 	{
 		if (io_cmd)
 			destroy (Genode::env()->heap(), io_cmd);
+
+		if (trim_ds.valid()) {
+			Genode::env()->rm_session()->detach((void *)trim_ranges);
+			platform_hba.free_dma_buffer(trim_ds);
+		}
+	}
+
+	/**
+	 * Return true if a request is pending that cannot be queued
+	 *
+	 * TRIM and FLUSH are non-queued ATA commands, which must not be issued
+	 * while other commands are in flight and vice versa.
+	 */
+	bool non_queued_pending()
+	{
+		for (unsigned slot = 0; slot < cmd_slots; slot++) {
+			if (!pending[slot].valid())
+				continue;
+
+			Block::Packet_descriptor::Opcode op = pending[slot].operation();
+			if (op == Block::Packet_descriptor::TRIM ||
+			    op == Block::Packet_descriptor::FLUSH)
+				return true;
+		}
+		return false;
+	}
+
+	bool any_pending()
+	{
+		for (unsigned slot = 0; slot < cmd_slots; slot++)
+			if (pending[slot].valid())
+				return true;
+		return false;
 	}
 
 	unsigned find_free_cmd_slot()
@@ -206,10 +260,19 @@ struct Ata_driver : Port_driver
 
 	void ack_packets()
 	{
-		unsigned slots =  Port::read<Ci>() | Port::read<Sact>();
+		unsigned slots =  Port::read<Ci>() | Port::read<Sact>() | issue;
+
+		/*
+		 * Determine completed slots up front, acknowledging a packet may
+		 * hand over new requests that occupy free slots
+		 */
+		unsigned done = 0;
+		for (unsigned slot = 0; slot < cmd_slots; slot++)
+			if (!(slots & (1U << slot)) && pending[slot].valid())
+				done |= 1U << slot;
 
 		for (unsigned slot = 0; slot < cmd_slots; slot++) {
-			if ((slots & (1U << slot)) || !pending[slot].valid())
+			if (!(done & (1U << slot)))
 				continue;
 
 			Block::Packet_descriptor p = pending[slot];
@@ -250,6 +313,9 @@ struct Ata_driver : Port_driver
 		sanity_check(block_number, count);
 		overlap_check(block_number, count);
 
+		if (non_queued_pending())
+			throw Block::Driver::Request_congestion();
+
 		unsigned slot = find_free_cmd_slot();
 		pending[slot] = packet;
 
@@ -264,7 +330,35 @@ struct Ata_driver : Port_driver
 		header.write<Command_header::Bits::W>(read ? 0 : 1);
 		header.clear_byte_count();
 
-		execute(slot);
+		/* started by 'submit_batch' */
+		issue |= 1U << slot;
+	}
+
+	/**
+	 * Issue non-queued command without data transfer or with DMA out
+	 */
+	void non_queued(Block::Packet_descriptor &packet, addr_t phys, size_t bytes,
+	                bool trim, size_t range_blocks = 0)
+	{
+		/* wait until all queued commands are completed */
+		if (any_pending())
+			throw Block::Driver::Request_congestion();
+
+		unsigned slot = find_free_cmd_slot();
+		pending[slot] = packet;
+
+		Command_table table(command_table_addr(slot), phys, bytes);
+
+		if (trim)
+			table.fis.trim(range_blocks);
+		else
+			table.fis.flush_cache_ext();
+
+		Command_header header(command_header_addr(slot));
+		header.write<Command_header::Bits::W>(trim ? 1 : 0);
+		header.clear_byte_count();
+
+		issue |= 1U << slot;
 	}
 
 
@@ -307,6 +401,11 @@ struct Ata_driver : Port_driver
 		case READY:
 
 			io_cmd->handle_irq(*this, status);
+
+			/* completion of a non-queued command in NCQ mode */
+			if (Port::Is::Dhrs::get(status))
+				ack_irq();
+
 			ack_packets();
 
 		default:
@@ -316,6 +415,16 @@ struct Ata_driver : Port_driver
 		stop();
 	}
 
+	bool trim_support()
+	{
+		return info->read<Identity::Data_set_mgmt::Trim>();
+	}
+
+	bool flush_support()
+	{
+		return info->read<Identity::Cmd_set_2::Flush_cache_ext>();
+	}
+
 	bool ncq_support()
 	{
 		return info->read<Identity::Sata_caps::Ncq_support>() && hba.ncq();
@@ -351,11 +460,31 @@ struct Ata_driver : Port_driver
 
 	bool dma_enabled() { return true; };
 
+	unsigned queue_depth() override { return cmd_slots; }
+
+	void submit_batch() override
+	{
+		if (!issue)
+			return;
+
+		/* start all commands set up since the last batch at once */
+		start();
+		Port::write<Ci>(issue);
+		issue = 0;
+	}
+
 	Block::Session::Operations ops() override
 	{
 		Block::Session::Operations o;
 		o.set_operation(Block::Packet_descriptor::READ);
 		o.set_operation(Block::Packet_descriptor::WRITE);
+
+		if (trim_support())
+			o.set_operation(Block::Packet_descriptor::TRIM);
+
+		if (flush_support())
+			o.set_operation(Block::Packet_descriptor::FLUSH);
+
 		return o;
 	}
 
@@ -375,6 +504,68 @@ struct Ata_driver : Port_driver
 		io(false, block_number, block_count, phys, packet);
 	}
 
+	void trim(Block::sector_t           block_number,
+	          size_t                    block_count,
+	          Block::Packet_descriptor &packet) override
+	{
+		if (!trim_support())
+			throw Io_error();
+
+		/* the range entries may still be in use by the device */
+		if (any_pending())
+			throw Block::Driver::Request_congestion();
+
+		/*
+		 * Each LBA range entry covers up to 65535 sectors. The entries
+		 * occupy as many 512-byte blocks of the 4-KiB buffer as the device
+		 * accepts. A request exceeding these entries is refused rather than
+		 * trimmed partially.
+		 */
+		enum {
+			BUFFER_SIZE      = 0x1000,
+			RANGE_BLOCK_SIZE = 512,
+			RANGES_PER_BLOCK = RANGE_BLOCK_SIZE / sizeof(uint64_t),
+			MAX_RANGE        = 0xffff
+		};
+
+		size_t const max_blocks   = info->read<Identity::Dsm_max_blocks>();
+		size_t const range_blocks =
+			min(max(max_blocks, (size_t)1), (size_t)BUFFER_SIZE/RANGE_BLOCK_SIZE);
+
+		size_t const needed_ranges = (block_count + MAX_RANGE - 1) / MAX_RANGE;
+		size_t const used_blocks   =
+			(needed_ranges + RANGES_PER_BLOCK - 1) / RANGES_PER_BLOCK;
+
+		if (!block_count || used_blocks > range_blocks)
+			throw Io_error();
+
+		if (!trim_ds.valid()) {
+			trim_ds     = platform_hba.alloc_dma_buffer(BUFFER_SIZE);
+			trim_ranges = Genode::env()->rm_session()->attach(trim_ds);
+		}
+
+		uint64_t *range = (uint64_t *)trim_ranges;
+		Genode::memset(range, 0, used_blocks*RANGE_BLOCK_SIZE);
+
+		for (unsigned i = 0; block_count; i++) {
+			size_t const n = min(block_count, (size_t)MAX_RANGE);
+			range[i]      = block_number | ((uint64_t)n << 48);
+			block_number += n;
+			block_count  -= n;
+		}
+
+		non_queued(packet, Dataspace_client(trim_ds).phys_addr(),
+		           used_blocks*RANGE_BLOCK_SIZE, true, used_blocks);
+	}
+
+	void flush(Block::Packet_descriptor &packet) override
+	{
+		if (!flush_support())
+			throw Io_error();
+
+		non_queued(packet, 0, 0, false);
+	}
+
 	Genode::size_t block_size() override
 	{
 		Genode::size_t size = 512;
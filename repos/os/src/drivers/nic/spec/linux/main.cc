@@ -10,6 +10,10 @@
  * - TAP device to connect to (default is tap0)
  * - MAC address (default is 02-00-00-00-00-01)
  *
+ * Frames are moved in batches between the TAP device and the packet
+ * streams, so that the client is signalled once per batch instead of once
+ * per frame.
+ *
  * These can be set in the config section as follows:
  *  <config>
  *  	<nic mac="12:23:34:45:56:67" tap="tap1"/>
@@ -24,6 +28,7 @@
  */
 
 /* Genode */
+#include <base/semaphore.h>
 #include <base/thread.h>
 #include <nic/root.h>
 #include <nic/xml_node.h>
@@ -44,14 +49,38 @@ class Linux_session_component : public Nic::Session_component
 {
 	private:
 
+		/**
+		 * Thread signalling the arrival of frames on the TAP device
+		 *
+		 * After signalling, the thread waits until the entrypoint has read
+		 * all pending frames and re-armed it. So the entrypoint gets only
+		 * one signal per batch of frames.
+		 */
 		struct Rx_signal_thread : Genode::Thread<0x1000>
 		{
 			int                               fd;
 			Genode::Signal_context_capability sigh;
 
+			Genode::Lock      _lock;
+			bool              _armed = true;
+			Genode::Semaphore _rearmed;
+
 			Rx_signal_thread(int fd, Genode::Signal_context_capability sigh)
 			: Genode::Thread<0x1000>("rx_signal"), fd(fd), sigh(sigh) { }
 
+			/**
+			 * Called by the entrypoint when reading returned 'EAGAIN'
+			 */
+			void rearm()
+			{
+				Genode::Lock::Guard guard(_lock);
+				if (_armed)
+					return;
+
+				_armed = true;
+				_rearmed.up();
+			}
+
 			void entry()
 			{
 				while (true) {
@@ -63,12 +92,21 @@ class Linux_session_component : public Nic::Session_component
 					FD_SET(fd, &rfds);
 					do { ret = select(fd + 1, &rfds, 0, 0, 0); } while (ret < 0);
 
+					{
+						Genode::Lock::Guard guard(_lock);
+						_armed = false;
+					}
+
 					/* signal incoming packet */
 					Genode::Signal_transmitter(sigh).submit();
+
+					_rearmed.down();
 				}
 			}
 		};
 
+		enum { BATCH = 64 };
+
 		Nic::Mac_address _mac_addr;
 		int              _tap_fd;
 		Rx_signal_thread _rx_thread;
@@ -117,62 +155,94 @@ class Linux_session_component : public Nic::Session_component
 			return fd;
 		}
 
+		/**
+		 * Write a batch of packets of the tx sink to the TAP device
+		 *
+		 * \return true if further packets may be available
+		 */
 		bool _send()
 		{
 			using namespace Genode;
 
-			if (!_tx.sink()->ready_to_ack())
+			unsigned const max = min((unsigned)BATCH, _tx.sink()->ack_slots_free());
+			if (!max || !_tx.sink()->packet_avail())
 				return false;
 
-			if (!_tx.sink()->packet_avail())
-				return false;
+			Packet_descriptor packets[BATCH];
+			unsigned          count = 0;
 
-			Packet_descriptor packet = _tx.sink()->get_packet();
-			if (!packet.valid()) {
-				PWRN("Invalid tx packet");
-				return true;
-			}
+			_tx.sink()->get_packets(max, [&] (Packet_descriptor packet) {
 
-			int ret;
+				int ret;
+
+				/* non-blocking-write packet to TAP */
+				do {
+					ret = write(_tap_fd, _tx.sink()->packet_content(packet), packet.size());
+					/* retry if write would block */
+					if (ret < 0 && errno == EAGAIN)
+						continue;
 
-			/* non-blocking-write packet to TAP */
-			do {
-				ret = write(_tap_fd, _tx.sink()->packet_content(packet), packet.size());
-				/* drop packet if write would block */
-				if (ret < 0 && errno == EAGAIN)
-					continue;
+					if (ret < 0) PERR("write: errno=%d", errno);
+				} while (ret < 0);
 
-				if (ret < 0) PERR("write: errno=%d", errno);
-			} while (ret < 0);
+				packets[count++] = packet;
+			});
 
-			_tx.sink()->acknowledge_packet(packet);
+			/* the sink gets signalled once for the whole batch */
+			_tx.sink()->acknowledge_packets(packets, count);
 
 			return true;
 		}
 
+		/**
+		 * Read a batch of frames from the TAP device into the rx source
+		 *
+		 * \return true if further frames may be available
+		 */
 		bool _receive()
 		{
+			using namespace Genode;
+
 			unsigned const max_size = Nic::Packet_allocator::DEFAULT_PACKET_SIZE;
 
-			if (!_rx.source()->ready_to_submit())
+			unsigned const max = min((unsigned)BATCH, _rx.source()->submit_slots_free());
+			if (!max)
 				return false;
 
-			Nic::Packet_descriptor p;
-			try {
-				p = _rx.source()->alloc_packet(max_size);
-			} catch (Session::Rx::Source::Packet_alloc_failed) { return false; }
+			Nic::Packet_descriptor packets[BATCH];
+			unsigned               count = 0;
+			bool                   more  = true;
 
-			int size = read(_tap_fd, _rx.source()->packet_content(p), max_size);
-			if (size <= 0) {
-				_rx.source()->release_packet(p);
-				return false;
+			while (count < max) {
+
+				Nic::Packet_descriptor p;
+				try {
+					p = _rx.source()->alloc_packet(max_size);
+				} catch (Session::Rx::Source::Packet_alloc_failed) {
+					more = false;
+					break;
+				}
+
+				int size = read(_tap_fd, _rx.source()->packet_content(p), max_size);
+				if (size <= 0) {
+					_rx.source()->release_packet(p);
+
+					/* all pending frames are read (EAGAIN), wait for new ones */
+					_rx_thread.rearm();
+
+					more = false;
+					break;
+				}
+
+				/* adjust packet size */
+				packets[count++] = Nic::Packet_descriptor(p.offset(), size);
 			}
 
-			/* adjust packet size */
-			Nic::Packet_descriptor p_adjust(p.offset(), size);
-			_rx.source()->submit_packet(p_adjust);
+			/* the client gets signalled once for the whole batch */
+			if (count)
+				_rx.source()->submit_packets(packets, count);
 
-			return true;
+			return more;
 		}
 
 	protected:
@@ -180,7 +250,8 @@ class Linux_session_component : public Nic::Session_component
 		void _handle_packet_stream() override
 		{
 			while (_rx.source()->ack_avail())
-				_rx.source()->release_packet(_rx.source()->get_acked_packet());
+				_rx.source()->get_acked_packets(BATCH, [&] (Nic::Packet_descriptor p) {
+					_rx.source()->release_packet(p); });
 
 			while (_send()) ;
 			while (_receive()) ;
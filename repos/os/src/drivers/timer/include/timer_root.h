@@ -5,7 +5,7 @@
  */
 
 /*
- * Copyright (C) 2006-2013 Genode Labs GmbH
+ * Copyright (C) 2006-2016 Genode Labs GmbH
  *
  * This file is part of the Genode OS framework, which is distributed
  * under the terms of the GNU General Public License version 2.
@@ -42,9 +42,14 @@ class Timer::Root_component : public Genode::Root_component<Session_component>
 		{
 			Genode::size_t ram_quota = Genode::Arg_string::find_arg(args, "ram_quota").ulong_value(0);
 
-			if (ram_quota < sizeof(Session_component)) {
+			/* the time page is allocated from our RAM session */
+			Genode::size_t const session_size = sizeof(Session_component)
+			                                  + Session_time_page::quota();
+
+			if (ram_quota < session_size) {
 				PWRN("Insufficient donated ram_quota (%zd bytes), require %zd bytes",
-				     ram_quota, sizeof(Session_component));
+				     ram_quota, session_size);
+				throw Genode::Root::Quota_exceeded();
 			}
 
 			return new (md_alloc())
@@ -6,7 +6,7 @@
  */
 
 /*
- * Copyright (C) 2006-2013 Genode Labs GmbH
+ * Copyright (C) 2006-2016 Genode Labs GmbH
  * Copyright (C) 2012 Intel Corporation
  *
  * This file is part of the Genode OS framework, which is distributed
@@ -19,7 +19,9 @@
 /* Genode includes */
 #include <util/list.h>
 #include <os/alarm.h>
+#include <os/attached_ram_dataspace.h>
 #include <base/rpc_server.h>
+#include <timer_session/time_page.h>
 #include <timer_session/timer_session.h>
 
 /* local includes */
@@ -31,6 +33,8 @@ namespace Timer {
 	enum { STACK_SIZE = 32*1024 };
 
 	struct Irq_dispatcher;
+	class Session_time_page;
+	class Time_page_updater;
 	class Irq_dispatcher_component;
 	class Wake_up_alarm;
 	class Timeout_scheduler;
@@ -45,6 +49,143 @@ struct Timer::Irq_dispatcher
 };
 
 
+/**
+ * Time page of one session
+ *
+ * Each session has a page of its own because RAM dataspaces cannot be
+ * handed out read-only. So a client cannot corrupt the time of others.
+ * The page is paid for by the session quota.
+ */
+class Timer::Session_time_page : public Genode::List<Session_time_page>::Element
+{
+	private:
+
+		Genode::Attached_ram_dataspace _ds { Genode::env()->ram_session(),
+		                                     sizeof(Time_page) };
+
+	public:
+
+		/**
+		 * Return amount of RAM quota consumed by the page
+		 */
+		static Genode::size_t quota() {
+			return Genode::align_addr(sizeof(Time_page), 12); }
+
+		Time_page &page() { return *_ds.local_addr<Time_page>(); }
+
+		Genode::Dataspace_capability cap() const { return _ds.cap(); }
+};
+
+
+/**
+ * Maintainer of the time pages of all sessions
+ *
+ * The time base is updated with each timeout whereas the pages are written
+ * on 'publish' only, which happens once per 'Time_page::UPDATE_PERIOD_US'.
+ * So the cost of handling a timeout does not depend on the number of
+ * sessions. In between, clients extrapolate the time via the time counter.
+ *
+ * The updater is executed by the entrypoint only, which also creates and
+ * destroys the sessions.
+ */
+class Timer::Time_page_updater
+{
+	private:
+
+		typedef Genode::uint64_t uint64_t;
+
+		enum {
+			CALIBRATION_MIN_US = 100*1000,
+			CALIBRATION_MAX_US = 60*1000*1000,
+		};
+
+		Genode::List<Session_time_page> _pages;
+
+		unsigned long _prev_now    = 0; /* platform time of last update */
+		uint64_t      _us          = 0; /* time since driver start      */
+		uint64_t      _counter     = 0;
+		uint64_t      _scale       = 0;
+		uint64_t      _cal_us      = 0; /* start of calibration window  */
+		uint64_t      _cal_counter = 0;
+
+		void _write(Time_page &page)
+		{
+			page.seq++;
+			Genode::memory_barrier();
+
+			page.us      = _us;
+			page.counter = _counter;
+			page.scale   = _scale;
+
+			Genode::memory_barrier();
+			page.seq++;
+		}
+
+		/**
+		 * Determine rate of the time counter against the platform time
+		 */
+		void _calibrate()
+		{
+			if (!_counter)
+				return;
+
+			if (!_cal_counter) {
+				_cal_us      = _us;
+				_cal_counter = _counter;
+				return;
+			}
+
+			uint64_t const us = _us - _cal_us;
+			if (us < CALIBRATION_MIN_US || _counter <= _cal_counter)
+				return;
+
+			_scale = (us << 32) / (_counter - _cal_counter);
+
+			/* restart window before the fixed-point calculation overflows */
+			if (us >= CALIBRATION_MAX_US) {
+				_cal_us      = _us;
+				_cal_counter = _counter;
+			}
+		}
+
+	public:
+
+		Time_page_updater(unsigned long now) : _prev_now(now) { }
+
+		/**
+		 * Update time base
+		 *
+		 * \param now  current platform time in microseconds
+		 */
+		void update(unsigned long now)
+		{
+			/* extend platform time, which may wrap on 32-bit platforms */
+			_us      += now - _prev_now;
+			_prev_now = now;
+			_counter  = time_counter();
+
+			_calibrate();
+		}
+
+		/**
+		 * Write time base to the pages of all sessions
+		 */
+		void publish()
+		{
+			for (Session_time_page *p = _pages.first(); p; p = p->next())
+				_write(p->page());
+		}
+
+		void insert(Session_time_page &page)
+		{
+			_write(page.page());
+			_pages.insert(&page);
+		}
+
+		void remove(Session_time_page &page) { _pages.remove(&page); }
+};
+
+
 /**
  * Timer interrupt handler
  *
@@ -62,6 +203,7 @@ class Timer::Irq_dispatcher_component : public Genode::Rpc_object<Irq_dispatcher
 
 		Genode::Alarm_scheduler *_alarm_scheduler;
 		Platform_timer          *_platform_timer;
+		Time_page_updater       *_time_page_updater;
 
 	public:
 
@@ -69,8 +211,9 @@ class Timer::Irq_dispatcher_component : public Genode::Rpc_object<Irq_dispatcher
 		 * Constructor
 		 */
 		Irq_dispatcher_component(Genode::Alarm_scheduler *as,
-		                         Platform_timer          *pt)
-		: _alarm_scheduler(as), _platform_timer(pt) { }
+		                         Platform_timer          *pt,
+		                         Time_page_updater       *tpu)
+		: _alarm_scheduler(as), _platform_timer(pt), _time_page_updater(tpu) { }
 
 
 		/******************************
@@ -84,6 +227,9 @@ class Timer::Irq_dispatcher_component : public Genode::Rpc_object<Irq_dispatcher
 			Alarm::Time now = _platform_timer->curr_time();
 			Alarm::Time sleep_time;
 
+			/* update time base for the time-page alarm */
+			_time_page_updater->update(now);
+
 			/* trigger timeout alarms */
 			_alarm_scheduler->handle(now);
 
@@ -147,7 +293,26 @@ class Timer::Timeout_scheduler : public Genode::Alarm_scheduler,
 		typedef Genode::Capability<Irq_dispatcher>
 		        Irq_dispatcher_capability;
 
+		/**
+		 * Alarm for publishing the time base once per
+		 * 'Time_page::UPDATE_PERIOD_US'
+		 */
+		struct Time_page_alarm : Genode::Alarm
+		{
+			Time_page_updater &updater;
+
+			Time_page_alarm(Time_page_updater &updater) : updater(updater) { }
+
+			bool on_alarm(unsigned) override
+			{
+				updater.publish();
+				return true;
+			}
+		};
+
 		Platform_timer           *_platform_timer;
+		Time_page_updater         _time_page_updater;
+		Time_page_alarm           _time_page_alarm;
 		Irq_dispatcher_component  _irq_dispatcher_component;
 		Irq_dispatcher_capability _irq_dispatcher_cap;
 
@@ -182,9 +347,17 @@ class Timer::Timeout_scheduler : public Genode::Alarm_scheduler,
 		:
 			Thread("timeout_scheduler"),
 			_platform_timer(pt),
-			_irq_dispatcher_component(this, pt),
+			_time_page_updater(pt->curr_time()),
+			_time_page_alarm(_time_page_updater),
+			_irq_dispatcher_component(this, pt, &_time_page_updater),
 			_irq_dispatcher_cap(ep->manage(&_irq_dispatcher_component))
 		{
+			/* refresh time pages only if clients extrapolate the time */
+			if (time_counter()) {
+				handle(_platform_timer->curr_time());
+				schedule(&_time_page_alarm, Time_page::UPDATE_PERIOD_US);
+			}
+
 			_platform_timer->schedule_timeout(0);
 			start();
 		}
@@ -209,6 +382,8 @@ class Timer::Timeout_scheduler : public Genode::Alarm_scheduler,
 		{
 			return _platform_timer->curr_time();
 		}
+
+		Time_page_updater &time_page_updater() { return _time_page_updater; }
 };
 
 
@@ -223,6 +398,7 @@ class Timer::Session_component : public Genode::Rpc_object<Session>,
 		Timeout_scheduler  &_timeout_scheduler;
 		Wake_up_alarm       _wake_up_alarm;
 		unsigned long const _initial_time;
+		Session_time_page   _time_page;
 
 		void _trigger(unsigned us, bool periodic)
 		{
@@ -239,13 +415,16 @@ class Timer::Session_component : public Genode::Rpc_object<Session>,
 		:
 			_timeout_scheduler(ts),
 			_initial_time(_timeout_scheduler.curr_time())
-		{ }
+		{
+			_timeout_scheduler.time_page_updater().insert(_time_page);
+		}
 
 		/**
 		 * Destructor
 		 */
 		~Session_component()
 		{
+			_timeout_scheduler.time_page_updater().remove(_time_page);
 			_timeout_scheduler.discard(&_wake_up_alarm);
 		}
 
@@ -275,6 +454,11 @@ class Timer::Session_component : public Genode::Rpc_object<Session>,
 			return (now - _initial_time) / 1000;
 		}
 
+		Genode::Dataspace_capability time_page() override
+		{
+			return _time_page.cap();
+		}
+
 		void msleep(unsigned) { /* never called at the server side */ }
 		void usleep(unsigned) { /* never called at the server side */ }
 };
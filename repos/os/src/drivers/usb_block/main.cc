@@ -740,6 +740,11 @@ struct Usb::Block_driver : Usb::Completion,
 	Block::sector_t    block_count() override { return _block_count; }
 	Block::Session::Operations ops() override { return _block_ops;   }
 
+	/*
+	 * The bulk-only transport protocol permits only one command at a time
+	 */
+	unsigned           queue_depth() override { return 1; }
+
 	void read(Block::sector_t lba, size_t count,
 	          char *buffer, Block::Packet_descriptor &p) override {
 		io(true, lba, count, buffer, p); }
@@ -5,7 +5,7 @@
  */
 
 /*
- * Copyright (C) 2005-2013 Genode Labs GmbH
+ * Copyright (C) 2005-2016 Genode Labs GmbH
  *
  * This file is part of the Genode OS framework, which is distributed
  * under the terms of the GNU General Public License version 2.
@@ -17,80 +17,157 @@
 using namespace Genode;
 
 
-void Alarm_scheduler::_unsynchronized_enqueue(Alarm *alarm)
+Alarm *Alarm_scheduler::_meld(Alarm *a, Alarm *b)
 {
-	if (alarm->_active) {
-		PERR("trying to insert the same alarm twice!");
-		return;
-	}
+	if (!a) return b;
+	if (!b) return a;
 
-	alarm->_active++;
+	/* the heap with the earlier deadline becomes the parent */
+	if (_earlier(b, a)) {
+		Alarm *tmp = a; a = b; b = tmp; }
 
-	/* if alarmlist is empty add first element */
-	if (!_head) {
-		alarm->_next = 0;
-		_head = alarm;
-		return;
+	b->_sibling = a->_child;
+	b->_prev    = a;
+	if (a->_child)
+		a->_child->_prev = b;
+	a->_child = b;
+
+	return a;
+}
+
+
+Alarm *Alarm_scheduler::_merge_pairs(Alarm *first)
+{
+	/* meld pairs from left to right, chain the results in reverse order */
+	Alarm *pairs = 0;
+	while (first) {
+		Alarm *a = first;
+		Alarm *b = a->_sibling;
+
+		first = b ? b->_sibling : 0;
+
+		a->_sibling = a->_prev = 0;
+		if (b)
+			b->_sibling = b->_prev = 0;
+
+		Alarm *melded = _meld(a, b);
+		melded->_sibling = pairs;
+		pairs = melded;
 	}
 
-	/* if deadline is smaller than any other deadline, put it on the head */
-	if ((int)alarm->_deadline - (int)_now < (int)_head->_deadline - (int)_now) {
-		alarm->_next = _head;
-		_head = alarm;
-		return;
+	/* meld the results from right to left */
+	Alarm *root = 0;
+	while (pairs) {
+		Alarm *next = pairs->_sibling;
+		pairs->_sibling = 0;
+		root  = _meld(root, pairs);
+		pairs = next;
 	}
+	return root;
+}
 
-	/* find list element with a higher deadline */
-	Alarm *curr = _head;
-	while (curr->_next &&
-	       (int)curr->_next->_deadline - (int)_now < (int)alarm->_deadline - (int)_now)
-		curr = curr->_next;
 
-	/* if end of list is reached, append new element */
-	if (curr->_next == 0) {
-		curr->_next = alarm;
+void Alarm_scheduler::_unsynchronized_enqueue(Alarm *alarm)
+{
+	if (alarm->_state != Alarm::INACTIVE) {
+		PERR("trying to insert the same alarm twice!");
 		return;
 	}
 
-	/* insert element in middle of list */
-	alarm->_next = curr->_next;
-	curr->_next  = alarm;
+	alarm->_state = Alarm::QUEUED;
+	alarm->_unlink();
+
+	_root = _meld(_root, alarm);
 }
 
 
 void Alarm_scheduler::_unsynchronized_dequeue(Alarm *alarm)
 {
-	if (!_head) return;
+	switch (alarm->_state) {
 
-	if (_head == alarm) {
-		_head = alarm->_next;
-		alarm->_reset();
+	case Alarm::INACTIVE:
+
+		/* alarm is not enqueued */
 		return;
-	}
 
-	/* find predecessor in alarm queue */
-	Alarm *curr;
-	for (curr = _head; curr && (curr->_next != alarm); curr = curr->_next);
+	case Alarm::QUEUED:
+
+		if (_root == alarm) {
+			_root = _merge_pairs(alarm->_child);
+			break;
+		}
+
+		/* cut sub heap of alarm from its parent or previous sibling */
+		if (alarm->_prev->_child == alarm)
+			alarm->_prev->_child = alarm->_sibling;
+		else
+			alarm->_prev->_sibling = alarm->_sibling;
 
-	/* alarm is not enqueued */
-	if (!curr) return;
+		if (alarm->_sibling)
+			alarm->_sibling->_prev = alarm->_prev;
+
+		_root = _meld(_root, _merge_pairs(alarm->_child));
+		break;
+
+	case Alarm::PENDING:
+
+		/* remove alarm from pending list */
+		if (alarm->_prev)
+			alarm->_prev->_sibling = alarm->_sibling;
+		else
+			_pending = alarm->_sibling;
+
+		if (alarm->_sibling)
+			alarm->_sibling->_prev = alarm->_prev;
+		else
+			_pending_tail = alarm->_prev;
+		break;
+	}
 
-	/* remove alarm from alarm queue */
-	curr->_next = alarm->_next;
 	alarm->_reset();
 }
 
 
+void Alarm_scheduler::_collect_pending_alarms()
+{
+	while (_root && _due(_root)) {
+
+		Alarm *alarm = _root;
+		_root = _merge_pairs(alarm->_child);
+
+		/* append alarm to pending list */
+		alarm->_unlink();
+		alarm->_state = Alarm::PENDING;
+		alarm->_prev  = _pending_tail;
+
+		if (_pending_tail)
+			_pending_tail->_sibling = alarm;
+		else
+			_pending = alarm;
+
+		_pending_tail = alarm;
+	}
+}
+
+
 Alarm *Alarm_scheduler::_get_pending_alarm()
 {
 	Lock::Guard lock_guard(_lock);
 
-	if (!_head || ((int)_head->_deadline - (int)_now >= 0))
+	if (!_pending)
+		_collect_pending_alarms();
+
+	if (!_pending)
 		return 0;
 
-	/* remove alarm from head of the list */
-	Alarm *pending_alarm = _head;
-	_head = _head->_next;
+	/* remove alarm from head of the pending list */
+	Alarm *pending_alarm = _pending;
+	_pending = pending_alarm->_sibling;
+
+	if (_pending)
+		_pending->_prev = 0;
+	else
+		_pending_tail = 0;
 
 	/*
 	 * Acquire dispatch lock to defer destruction until the call of 'on_alarm'
@@ -99,8 +176,8 @@ Alarm *Alarm_scheduler::_get_pending_alarm()
 	pending_alarm->_dispatch_lock.lock();
 
 	/* reset alarm object */
-	pending_alarm->_next = 0;
-	pending_alarm->_active--;
+	pending_alarm->_unlink();
+	pending_alarm->_state = Alarm::INACTIVE;
 
 	return pending_alarm;
 }
@@ -109,7 +186,14 @@ Alarm *Alarm_scheduler::_get_pending_alarm()
 void Alarm_scheduler::handle(Alarm::Time curr_time)
 {
 	Alarm *curr;
-	_now = curr_time;
+
+	{
+		Lock::Guard lock_guard(_lock);
+		_now = curr_time;
+
+		/* move all alarms that are due by now to the pending list at once */
+		_collect_pending_alarms();
+	}
 
 	while ((curr = _get_pending_alarm())) {
 
@@ -154,7 +238,7 @@ void Alarm_scheduler::_setup_alarm(Alarm &alarm, Alarm::Time period, Alarm::Time
 	 * position because its deadline might have changed. I.e., if an alarm is
 	 * rescheduled with a new timeout before the original timeout triggered.
 	 */
-	if (alarm._active)
+	if (alarm._state != Alarm::INACTIVE)
 		_unsynchronized_dequeue(&alarm);
 
 	alarm._assign(period, deadline, this);
@@ -215,10 +299,11 @@ bool Alarm_scheduler::next_deadline(Alarm::Time *deadline)
 {
 	Lock::Guard alarm_list_lock_guard(_lock);
 
-	if (!_head) return false;
+	Alarm const *next = _next_alarm();
+	if (!next) return false;
 
 	if (deadline)
-		*deadline = _head->_deadline;
+		*deadline = next->_deadline;
 
 	return true;
 }
@@ -228,16 +313,8 @@ Alarm_scheduler::~Alarm_scheduler()
 {
 	Lock::Guard lock_guard(_lock);
 
-	while (_head) {
-
-		Alarm *next = _head->_next;
-
-		/* reset alarm object */
-		_head->_reset();
-
-		/* remove from list */
-		_head = next;
-	}
+	while (Alarm *alarm = _next_alarm())
+		_unsynchronized_dequeue(alarm);
 }
 
 
@@ -0,0 +1,62 @@
+#include <trace/event_record.h>
+#include <trace/policy.h>
+#include <trace/timestamp.h>
+#include <util/string.h>
+
+using namespace Genode;
+
+typedef Trace::Event_record Event_record;
+
+
+static size_t record(char *dst, Event_record::Type type, unsigned value,
+                     char const *name)
+{
+	Event_record &r = *(Event_record *)dst;
+
+	size_t const name_len = name ? min(strlen(name), (size_t)Event_record::MAX_NAME_LEN) : 0;
+
+	r.timestamp = Trace::timestamp();
+	r.value     = value;
+	r.type      = type;
+	r.name_len  = name_len;
+	r.reserved  = 0;
+
+	memcpy(r.name, (void *)name, name_len);
+	return r.size();
+}
+
+
+size_t max_event_size()
+{
+	return Event_record::max_size();
+}
+
+size_t rpc_call(char *dst, char const *rpc_name, Msgbuf_base const &)
+{
+	return record(dst, Event_record::RPC_CALL, 0, rpc_name);
+}
+
+size_t rpc_returned(char *dst, char const *rpc_name, Msgbuf_base const &)
+{
+	return record(dst, Event_record::RPC_RETURNED, 0, rpc_name);
+}
+
+size_t rpc_dispatch(char *dst, char const *rpc_name)
+{
+	return record(dst, Event_record::RPC_DISPATCH, 0, rpc_name);
+}
+
+size_t rpc_reply(char *dst, char const *rpc_name)
+{
+	return record(dst, Event_record::RPC_REPLY, 0, rpc_name);
+}
+
+size_t signal_submit(char *dst, unsigned const num)
+{
+	return record(dst, Event_record::SIGNAL_SUBMIT, num, 0);
+}
+
+size_t signal_receive(char *dst, Signal_context const &, unsigned num)
+{
+	return record(dst, Event_record::SIGNAL_RECEIVED, num, 0);
+}
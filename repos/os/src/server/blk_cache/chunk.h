@@ -108,7 +108,7 @@ namespace Cache {
 		private:
 
 			char        _data[CHUNK_SIZE];
-			unsigned    _writes;
+			unsigned    _writes; /* 0: not loaded, 1: clean, 2: dirty */
 
 		public:
 
@@ -155,7 +155,36 @@ namespace Cache {
 
 				_num_entries = Genode::max(_num_entries, local_offset + len);
 
-				_writes++;
+				/* the content differs from the backend device from now on */
+				if (_writes < 2) {
+					_writes = 2;
+					POLICY::dirty(this);
+				}
+			}
+
+			/**
+			 * Load chunk with data read from the backend device
+			 *
+			 * A chunk that is already loaded is left untouched. It might
+			 * have been written meanwhile, and the data read from the
+			 * backend is outdated.
+			 */
+			void load(char const *src, size_t len, offset_t seek_offset)
+			{
+				assert_valid_range(seek_offset, len, SIZE);
+
+				if (_writes)
+					return;
+
+				POLICY::write(this);
+
+				offset_t const local_offset = seek_offset - base_offset();
+
+				Genode::memcpy(&_data[local_offset], src, len);
+
+				_num_entries = Genode::max(_num_entries, local_offset + len);
+
+				_writes = 1;
 			}
 
 			void read(char *dst, size_t len, offset_t seek_offset) const
@@ -180,6 +209,21 @@ namespace Cache {
 				if (_writes > 1) {
 					POLICY::sync(this, (char*)_data);
 					_writes = 1;
+					POLICY::clean(this);
+				}
+			}
+
+			/**
+			 * Drop dirty state of chunk
+			 *
+			 * Used when the content of the chunk is discarded at the backend
+			 * device, which renders writing it back pointless.
+			 */
+			void discard(size_t len, offset_t seek_offset)
+			{
+				if (_writes > 1) {
+					_writes = 1;
+					POLICY::clean(this);
 				}
 			}
 
@@ -365,6 +409,20 @@ namespace Cache {
 				}
 			}
 
+			struct Load_func
+			{
+				typedef ENTRY_TYPE Entry;
+
+				static Entry &lookup(Chunk_index &chunk, unsigned i) {
+					return chunk._entry(i); }
+
+				void operator () (Entry &entry, char const *src, size_t len,
+				                  offset_t seek_offset) const
+				{
+					entry.load(src, len, seek_offset);
+				}
+			};
+
 			struct Alloc_func
 			{
 				typedef ENTRY_TYPE Entry;
@@ -431,6 +489,20 @@ namespace Cache {
 				}
 			};
 
+			struct Discard_func
+			{
+				typedef ENTRY_TYPE Entry;
+
+				static Entry &lookup(Chunk_index const &chunk, unsigned i) {
+					return chunk._entry_for_syncing(i); }
+
+				void operator () (Entry &entry, char*, size_t len,
+				                  offset_t seek_offset) const
+				{
+					entry.discard(len, seek_offset);
+				}
+			};
+
 			void _init_entries()
 			{
 				for (unsigned i = 0; i < NUM_ENTRIES; i++)
@@ -499,6 +571,12 @@ namespace Cache {
 			void write(char const *src, size_t len, offset_t seek_offset) {
 				_range_op(*this, src, len, seek_offset, Write_func()); }
 
+			/**
+			 * Load chunks with data read from the backend device
+			 */
+			void load(char const *src, size_t len, offset_t seek_offset) {
+				_range_op(*this, src, len, seek_offset, Load_func()); }
+
 			/**
 			 * Allocate needed chunks
 			 */
@@ -524,6 +602,13 @@ namespace Cache {
 				if (zero()) return;
 				_range_op(*this, (char*)0, len, seek_offset, Sync_func()); }
 
+			/**
+			 * Drop dirty state of chunks
+			 */
+			void discard(size_t len, offset_t seek_offset) {
+				if (zero()) return;
+				_range_op(*this, (char*)0, len, seek_offset, Discard_func()); }
+
 			/**
 			 * Free chunks
 			 */
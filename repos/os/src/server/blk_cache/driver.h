@@ -5,7 +5,7 @@
  */
 
 /*
- * Copyright (C) 2013 Genode Labs GmbH
+ * Copyright (C) 2013-2016 Genode Labs GmbH
  *
  * This file is part of the Genode OS framework, which is distributed
  * under the terms of the GNU General Public License version 2.
@@ -14,7 +14,11 @@
 #include <base/printf.h>
 #include <block_session/connection.h>
 #include <block/component.h>
+#include <os/config.h>
 #include <os/packet_allocator.h>
+#include <os/reporter.h>
+#include <timer_session/connection.h>
+#include <util/volatile_object.h>
 
 #include "chunk.h"
 
@@ -49,7 +53,8 @@ class Driver : public Block::Driver
 			 */
 			bool match(const Block::Packet_descriptor& reply) const
 			{
-				return reply.operation()    == srv.operation()  &&
+				return reply.offset()       == srv.offset()     &&
+				       reply.operation()    == srv.operation()  &&
 				       reply.block_number() == srv.block_number() &&
 				       reply.block_count()  == srv.block_count();
 			}
@@ -99,7 +104,10 @@ class Driver : public Block::Driver
 
 		enum {
 			SLAB_SZ = Block::Session::TX_QUEUE_SIZE*sizeof(Request),
-			CACHE_BLK_SIZE = 4096
+			CACHE_BLK_SIZE = 4096,
+			DEFAULT_DIRTY_RATIO = 10, /* percent of cache capacity */
+			DEFAULT_READ_AHEAD = 128*1024,
+			REPORT_PERIOD_US = 1000*1000
 		};
 
 		/**
@@ -128,6 +136,33 @@ class Driver : public Block::Driver
 		Genode::Signal_rpc_member<Driver> _source_submit;
 		Genode::Signal_rpc_member<Driver> _yield;
 
+		unsigned              _writes_in_flight = 0; /* pending write backs */
+		Genode::List<Request> _flush_list;           /* flushes waiting for
+		                                                write backs */
+		bool                  _flush_sync = false;   /* write back for
+		                                                flushes ongoing */
+		Cache::offset_t       _flush_off  = 0;       /* resume write back
+		                                                at this offset */
+
+		/*
+		 * Detection of a sequentially reading client
+		 */
+		struct Stream
+		{
+			Block::sector_t next   = 0; /* block following the last read */
+			Block::sector_t ra_end = 0; /* end of read ahead issued     */
+			Genode::size_t  window = 0; /* read-ahead window in blocks  */
+		} _stream;
+
+		Genode::size_t _ra_max      = 0; /* maximum read-ahead window   */
+		unsigned long  _dirty_limit = 0; /* dirty chunks tolerated */
+		unsigned long _hits        = 0; /* reads served by the cache */
+		unsigned long _misses      = 0; /* reads involving the backend */
+
+		Genode::Reporter                                 _reporter { "statistics" };
+		Genode::Lazy_volatile_object<Timer::Connection> _timer;
+		Genode::Signal_rpc_member<Driver>                _report_dispatcher;
+
 		Driver(Driver const&);            /* singleton pattern */
 		Driver& operator=(Driver const&); /* singleton pattern */
 
@@ -158,13 +193,24 @@ class Driver : public Block::Driver
 		 */
 		inline void _handle_reply(Block::Packet_descriptor &srv, Request *r)
 		{
+			/* read ahead is not related to any client request */
+			if (!r->cli.valid())
+				return;
+
 			try {
-			if (r->cli.operation() == Block::Packet_descriptor::READ)
-				read(r->cli.block_number(), r->cli.block_count(),
-				     r->buffer, r->cli);
-			else
+			switch (r->cli.operation()) {
+			case Block::Packet_descriptor::READ:
+				_read(r->cli.block_number(), r->cli.block_count(),
+				      r->buffer, r->cli);
+				break;
+			case Block::Packet_descriptor::WRITE:
 				write(r->cli.block_number(), r->cli.block_count(),
 				      r->buffer, r->cli);
+				break;
+			default:
+				/* requests without payload are passed through */
+				ack_packet(r->cli, srv.succeeded());
+			}
 			} catch(Block::Driver::Request_congestion) {
 				PWRN("cli (%lld %zu) srv (%lld %zu)",
 					 r->cli.block_number(), r->cli.block_count(),
@@ -180,11 +226,34 @@ class Driver : public Block::Driver
 			while (_blk.tx()->ack_avail()) {
 				Block::Packet_descriptor p = _blk.tx()->get_acked_packet();
 
-				/* when reading, write result into cache */
+				/* when reading, load result into cache */
 				if (p.operation() == Block::Packet_descriptor::READ)
-					_cache.write(_blk.tx()->packet_content(p),
-					             p.block_count() * _blk_sz,
-					             p.block_number() * _blk_sz);
+					_cache.load(_blk.tx()->packet_content(p),
+					            p.block_count() * _blk_sz,
+					            p.block_number() * _blk_sz);
+
+				/* writes to the backend are write backs of dirty chunks */
+				if (p.operation() == Block::Packet_descriptor::WRITE)
+					_writes_in_flight--;
+
+				/*
+				 * Requests without payload are indistinguishable if they
+				 * name the same operation and blocks, ack the oldest one
+				 * only, which is the last in the list
+				 */
+				if (!p.valid()) {
+					Request *oldest = 0;
+					for (Request *r = _r_list.first(); r; r = r->next())
+						if (r->match(p))
+							oldest = r;
+
+					if (oldest) {
+						_handle_reply(p, oldest);
+						_r_list.remove(oldest);
+						Genode::destroy(&_r_slab, oldest);
+					}
+					continue;
+				}
 
 				/* loop through the list of requests, and ack all related */
 				for (Request *r = _r_list.first(), *r_to_handle = r; r;
@@ -199,6 +268,97 @@ class Driver : public Block::Driver
 
 				_blk.tx()->release_packet(p);
 			}
+
+			/* resume write back for waiting flushes */
+			if (_flush_writeback() && !_writes_in_flight)
+				_flush_pending();
+
+			/* resume write back that stopped due to a busy backend */
+			_writeback();
+		}
+
+		/*
+		 * Write back the oldest dirty chunks exceeding the dirty limit
+		 */
+		void _writeback()
+		{
+			try { POLICY::writeback(_dirty_limit); }
+			catch (Write_failed) { /* resumed on the next acknowledgement */ }
+		}
+
+		/*
+		 * Setup a request without payload to the backend device
+		 *
+		 * \param op      'TRIM' or 'FLUSH' operation
+		 * \param packet  original packet request received from the client
+		 */
+		void _request_no_data(Block::Packet_descriptor::Opcode op,
+		                      Block::sector_t                  block_number,
+		                      Genode::size_t                   block_count,
+		                      Block::Packet_descriptor        &packet)
+		{
+			if (!_blk.tx()->ready_to_submit())
+				throw Request_congestion();
+
+			/* the packet occupies no space in the bulk buffer */
+			Block::Packet_descriptor p_to_dev =
+				Block::Packet_descriptor(Block::Packet_descriptor(),
+				                         op, block_number, block_count);
+			_r_list.insert(new (&_r_slab) Request(p_to_dev, packet, 0));
+			_blk.tx()->submit_packet(p_to_dev);
+		}
+
+		/*
+		 * Flush backend device after all dirty chunks are written back
+		 */
+		void _flush_backend(Block::Packet_descriptor &packet)
+		{
+			if (_ops.supported(Block::Packet_descriptor::FLUSH)) {
+				_request_no_data(Block::Packet_descriptor::FLUSH, 0, 0, packet);
+				return;
+			}
+
+			/* the backend lacks asynchronous flushing, resort to 'sync' */
+			_blk.sync();
+			ack_packet(packet);
+		}
+
+		/*
+		 * Hand dirty chunks to the backend on behalf of waiting flushes
+		 *
+		 * In contrast to '_sync', the write back does not block if the
+		 * backend is busy but is resumed on the next acknowledgement.
+		 *
+		 * \return true if no dirty chunk is left to hand to the backend
+		 */
+		bool _flush_writeback()
+		{
+			if (!_flush_sync)
+				return true;
+
+			try {
+				_cache.sync(_blk_sz * _blk_cnt - _flush_off, _flush_off);
+			} catch (Write_failed &e) {
+				_flush_off = e.off;
+				return false;
+			}
+
+			_flush_sync = false;
+			return true;
+		}
+
+		/*
+		 * Issue flush requests that waited for the completion of write backs
+		 */
+		void _flush_pending()
+		{
+			while (Request *r = _flush_list.first()) {
+				try { _flush_backend(r->cli); }
+				catch (Request_congestion) { return; }
+
+				_flush_list.remove(r);
+				Genode::destroy(&_r_slab, r);
+			}
 		}
 
 		/*
@@ -260,6 +420,111 @@ class Driver : public Block::Driver
 			}
 		}
 
+		/*
+		 * Return true if the cache block at 'nr' is loaded or requested
+		 */
+		bool _present(Block::sector_t nr)
+		{
+			for (Request *r = _r_list.first(); r; r = r->next())
+				if (r->match(false, nr, _cache_blk_mod()))
+					return true;
+
+			try {
+				_cache.stat(CACHE_BLK_SIZE, nr * _blk_sz);
+				return true;
+			} catch (Cache::Chunk_base::Range_exception) { }
+			return false;
+		}
+
+		/*
+		 * Request cache blocks from the backend without a client waiting
+		 *
+		 * \return false if the backend cannot take the request currently
+		 */
+		bool _request_ahead(Block::sector_t nr, Genode::size_t cnt)
+		{
+			if (!_blk.tx()->ready_to_submit())
+				return false;
+
+			Block::Packet_descriptor p_to_dev;
+
+			try {
+				_cache.alloc(cnt * _blk_sz, nr * _blk_sz);
+
+				p_to_dev =
+					Block::Packet_descriptor(_blk.dma_alloc_packet(_blk_sz*cnt),
+					                         Block::Packet_descriptor::READ,
+					                         nr, cnt);
+				Block::Packet_descriptor none;
+				_r_list.insert(new (&_r_slab) Request(p_to_dev, none, 0));
+				_blk.tx()->submit_packet(p_to_dev);
+				return true;
+			} catch(Block::Session::Tx::Source::Packet_alloc_failed) {
+			} catch(Genode::Allocator::Out_of_memory) {
+				if (p_to_dev.valid()) /* clean up */
+					_blk.tx()->release_packet(p_to_dev);
+			} catch(Request_congestion) { }
+			return false;
+		}
+
+		/*
+		 * Detect sequential reads and read ahead of the client
+		 *
+		 * The read-ahead window doubles with each sequential request up
+		 * to the configured maximum. New read ahead is issued as soon as
+		 * the client consumed half of the window.
+		 */
+		void _read_ahead(Block::sector_t nr, Genode::size_t cnt)
+		{
+			using Genode::min;
+			using Genode::max;
+
+			if (!_ra_max)
+				return;
+
+			Block::sector_t const end = nr + cnt;
+
+			/* random access resets the stream */
+			if (nr != _stream.next) {
+				_stream.next   = end;
+				_stream.ra_end = 0;
+				_stream.window = 0;
+				return;
+			}
+
+			_stream.next   = end;
+			_stream.window = _stream.window
+			               ? min(_stream.window * 2, _ra_max)
+			               : min<Genode::size_t>(4 * _cache_blk_mod(), _ra_max);
+
+			if (_stream.ra_end >= end + _stream.window / 2)
+				return;
+
+			Block::sector_t from = _cache_blk_round_up(max(_stream.ra_end, end));
+			Block::sector_t to   =
+				_cache_blk_round_off(min<Block::sector_t>(end + _stream.window,
+				                                          _blk_cnt));
+
+			/* request contiguous runs of cache blocks not present yet */
+			while (from < to) {
+				if (_present(from)) {
+					from += _cache_blk_mod();
+					continue;
+				}
+
+				Block::sector_t run = from;
+				while (from < to && !_present(from))
+					from += _cache_blk_mod();
+
+				if (!_request_ahead(run, from - run)) {
+					from = run;
+					break;
+				}
+			}
+
+			_stream.ra_end = max(_stream.ra_end, from);
+		}
+
 		/*
 		 * Synchronize dirty chunks with backend device
 		 */
@@ -309,6 +574,89 @@ class Driver : public Block::Driver
 			return false;
 		}
 
+		/*
+		 * Serve read request from cache, or request missing chunks
+		 *
+		 * \return true if the request was served from the cache
+		 */
+		bool _read(Block::sector_t           block_number,
+		           Genode::size_t            block_count,
+		           char*                     buffer,
+		           Block::Packet_descriptor &packet)
+		{
+			if (!_stat(block_number, block_count, buffer, packet))
+				return false;
+
+			_cache.read(buffer, block_count*_blk_sz, block_number*_blk_sz);
+			ack_packet(packet);
+			return true;
+		}
+
+		/*
+		 * Signal handler for periodic statistics report
+		 */
+		void _report(unsigned)
+		{
+			Cache::Policy_stats const &stats = POLICY::stats();
+
+			try {
+				Genode::Reporter::Xml_generator xml(_reporter, [&] () {
+					xml.attribute("policy",     POLICY::name());
+					xml.attribute("hits",       _hits);
+					xml.attribute("misses",     _misses);
+					xml.attribute("chunks",     stats.chunks);
+					xml.attribute("dirty",      stats.dirty);
+					xml.attribute("evictions",  stats.evictions);
+					xml.attribute("writebacks", stats.writebacks);
+				});
+			} catch (...) { PWRN("could not generate statistics report"); }
+		}
+
+		/*
+		 * Apply configuration
+		 */
+		void _configure()
+		{
+			using namespace Genode;
+
+			unsigned long dirty_ratio = DEFAULT_DIRTY_RATIO;
+			bool          report      = false;
+
+			Number_of_bytes read_ahead = (size_t)DEFAULT_READ_AHEAD;
+
+			try {
+				Xml_node config = Genode::config()->xml_node();
+				dirty_ratio = config.attribute_value("dirty_ratio", dirty_ratio);
+				read_ahead  = config.attribute_value("read_ahead", read_ahead);
+				report      = config.sub_node("report").attribute("statistics")
+				                                       .has_value("yes");
+			} catch (...) { }
+
+			/*
+			 * The cache grows until the RAM quota is exhausted, hence the
+			 * limit refers to the number of chunks fitting into the quota
+			 */
+			_dirty_limit = env()->ram_session()->quota()
+			               / sizeof(Chunk_level_4) * min(dirty_ratio, 100UL) / 100;
+
+			/*
+			 * Leave at least half of the packet buffer to client requests,
+			 * the window is a multiple of the cache block size
+			 */
+			size_t const ra_bytes =
+				min((size_t)read_ahead,
+				    (size_t)Block::Session::TX_QUEUE_SIZE*CACHE_BLK_SIZE/2);
+			_ra_max = ra_bytes / CACHE_BLK_SIZE * _cache_blk_mod();
+
+			if (!report)
+				return;
+
+			_reporter.enabled(true);
+			_timer.construct();
+			_timer->sigh(_report_dispatcher);
+			_timer->trigger_periodic(REPORT_PERIOD_US);
+		}
+
 		/*
 		 * Signal handler for yield requests of the parent
 		 */
@@ -339,7 +687,8 @@ class Driver : public Block::Driver
 		  _cache(*Genode::env()->heap(), 0),
 		  _source_ack(ep, *this, &Driver::_ack_avail),
 		  _source_submit(ep, *this, &Driver::_ready_to_submit),
-		  _yield(ep, *this, &Driver::_parent_yield)
+		  _yield(ep, *this, &Driver::_parent_yield),
+		  _report_dispatcher(ep, *this, &Driver::_report)
 		{
 			_blk.info(&_blk_cnt, &_blk_sz, &_ops);
 			_blk.tx_channel()->sigh_ack_avail(_source_ack);
@@ -354,6 +703,8 @@ class Driver : public Block::Driver
 
 			/* truncate chunk structure to real size of the device */
 			_cache.truncate(_blk_sz*_blk_cnt);
+
+			_configure();
 		}
 
 	public:
@@ -388,7 +739,17 @@ class Driver : public Block::Driver
 
 		Genode::size_t  block_size()     { return _blk_sz;  }
 		Block::sector_t block_count()    { return _blk_cnt; }
-		Block::Session::Operations ops() { return _ops;     }
+
+		/*
+		 * Besides the operations of the backend device, the cache supports
+		 * flushing in any case by writing back its dirty chunks.
+		 */
+		Block::Session::Operations ops()
+		{
+			Block::Session::Operations o = _ops;
+			o.set_operation(Block::Packet_descriptor::FLUSH);
+			return o;
+		}
 
 		void read(Block::sector_t           block_number,
 		          Genode::size_t            block_count,
@@ -398,11 +759,12 @@ class Driver : public Block::Driver
 			if (!_ops.supported(Block::Packet_descriptor::READ))
 				throw Io_error();
 
-			if (!_stat(block_number, block_count, buffer, packet))
-				return;
+			if (_read(block_number, block_count, buffer, packet))
+				_hits++;
+			else
+				_misses++;
 
-			_cache.read(buffer, block_count*_blk_sz, block_number*_blk_sz);
-			ack_packet(packet);
+			_read_ahead(block_number, block_count);
 		}
 
 		void write(Block::sector_t           block_number,
@@ -427,6 +789,48 @@ class Driver : public Block::Driver
 			_cache.write(buffer, block_count * _blk_sz,
 			             block_number * _blk_sz);
 			ack_packet(packet);
+
+			_writeback();
+		}
+
+		void trim(Block::sector_t           block_number,
+		          Genode::size_t            block_count,
+		          Block::Packet_descriptor &packet)
+		{
+			if (!_ops.supported(Block::Packet_descriptor::TRIM))
+				throw Io_error();
+
+			/*
+			 * Cache blocks that are discarded completely need not be written
+			 * back anymore.
+			 */
+			Block::sector_t const first = _cache_blk_round_up(block_number);
+			Block::sector_t const last  =
+				_cache_blk_round_off(block_number + block_count);
+
+			if (last > first)
+				_cache.discard((last - first) * _blk_sz, first * _blk_sz);
+
+			_request_no_data(Block::Packet_descriptor::TRIM,
+			                 block_number, block_count, packet);
+		}
+
+		void flush(Block::Packet_descriptor &packet)
+		{
+			/*
+			 * We must not block for the write back here because the packet
+			 * is owned by the session component, which handles further
+			 * packets while we wait. Hence, keep a copy of the packet and
+			 * acknowledge it once all write backs are completed.
+			 */
+			_flush_list.insert(new (&_r_slab) Request(packet, packet, 0));
+
+			/* restart write back to cover chunks dirtied meanwhile */
+			_flush_sync = true;
+			_flush_off  = 0;
+
+			if (_flush_writeback() && !_writes_in_flight)
+				_flush_pending();
 		}
 
 		void sync() { _sync(); }
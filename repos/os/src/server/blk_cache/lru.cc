@@ -16,18 +16,27 @@
 
 typedef Driver<Lru_policy>::Chunk_level_4 Chunk;
 
-static const Lru_policy::Element        *lru = 0;
-static Genode::List<Lru_policy::Element> lru_list;
+static Cache::Queue        lru_list;   /* least recently used first */
+static Cache::Dirty_queue  dirty_list; /* oldest dirty chunk first  */
+static Cache::Policy_stats lru_stats;
+
+
+static Chunk *chunk(Cache::Queue::Element *e) {
+	return static_cast<Chunk*>(static_cast<Lru_policy::Element*>(e)); }
+
+
+static Chunk *chunk(Cache::Dirty_queue::Element *e) {
+	return static_cast<Chunk*>(static_cast<Lru_policy::Element*>(e)); }
 
 
 static void lru_access(const Lru_policy::Element *e)
 {
-	if (e == lru) return;
+	Lru_policy::Element *le = const_cast<Lru_policy::Element*>(e);
 
-	if (e->next()) lru_list.remove(e);
+	if (le->Cache::Queue::Element::linked())
+		lru_list.remove(le);
 
-	lru_list.insert(e, lru);
-	lru = e;
+	lru_list.append(le);
 }
 
 
@@ -39,24 +48,57 @@ void Lru_policy::write(const Lru_policy::Element *e) {
 	lru_access(e); }
 
 
+void Lru_policy::dirty(const Lru_policy::Element *e)
+{
+	Lru_policy::Element *le = const_cast<Lru_policy::Element*>(e);
+
+	if (!le->Cache::Dirty_queue::Element::linked())
+		dirty_list.append(le);
+}
+
+
+void Lru_policy::clean(const Lru_policy::Element *e)
+{
+	Lru_policy::Element *le = const_cast<Lru_policy::Element*>(e);
+
+	if (le->Cache::Dirty_queue::Element::linked())
+		dirty_list.remove(le);
+}
+
+
 void Lru_policy::flush(Cache::size_t size)
 {
 	Cache::size_t s = 0;
-	for (Lru_policy::Element *e = lru_list.first();
+	for (Cache::Queue::Element *e = lru_list.first();
 		 e && ((size == 0) || (s < size));
 		 e = lru_list.first(), s += sizeof(Chunk)) {
-		Chunk *cb = static_cast<Chunk*>(e);
-		e = e->next();
-		try {
-			cb->free(Driver<Lru_policy>::CACHE_BLK_SIZE,
-			         cb->base_offset());
-			lru_list.remove(cb);
-		} catch(Chunk::Dirty_chunk &e) {
-			cb->sync(e.size, e.off);
-		}
-	}
+		Chunk *cb = chunk(e);
 
-	if (!lru_list.first()) lru = 0;
+		/* write back dirty chunk before it gets freed */
+		cb->sync(Driver<Lru_policy>::CACHE_BLK_SIZE, cb->base_offset());
+
+		lru_list.remove(e);
+		cb->free(Driver<Lru_policy>::CACHE_BLK_SIZE, cb->base_offset());
+		lru_stats.evictions++;
+	}
 
 	if (s < size) throw Block::Driver::Request_congestion();
 }
+
+
+void Lru_policy::writeback(unsigned long dirty_limit)
+{
+	while (dirty_list.count() > dirty_limit) {
+		Chunk *cb = chunk(dirty_list.first());
+		cb->sync(Driver<Lru_policy>::CACHE_BLK_SIZE, cb->base_offset());
+		lru_stats.writebacks++;
+	}
+}
+
+
+Cache::Policy_stats const &Lru_policy::stats()
+{
+	lru_stats.chunks = lru_list.count();
+	lru_stats.dirty  = dirty_list.count();
+	return lru_stats;
+}
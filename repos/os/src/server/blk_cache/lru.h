@@ -11,15 +11,22 @@
  * under the terms of the GNU General Public License version 2.
  */
 
-#include <util/list.h>
-
 #include "chunk.h"
+#include "policy.h"
 
 struct Lru_policy
 {
-	class Element : public Genode::List<Element>::Element {};
+	class Element : public Cache::Queue::Element,
+	                public Cache::Dirty_queue::Element {};
+
+	static char const *name() { return "lru"; }
 
 	static void read(const Element  *e);
 	static void write(const Element *e);
+	static void dirty(const Element *e);
+	static void clean(const Element *e);
 	static void flush(Cache::size_t size = 0);
+	static void writeback(unsigned long dirty_limit);
+
+	static Cache::Policy_stats const &stats();
 };
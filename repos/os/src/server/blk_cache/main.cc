@@ -11,9 +11,11 @@
  * under the terms of the GNU General Public License version 2.
  */
 
+#include <os/config.h>
 #include <os/server.h>
 
 #include "lru.h"
+#include "two_queue.h"
 #include "driver.h"
 
 
@@ -37,7 +39,10 @@ void Driver<POLICY>::Policy::sync(const typename POLICY::Element *e, char *dst)
 		      Block::Packet_descriptor::WRITE,
 		      off / Driver::instance()->blk_sz(),
 		      Driver::CACHE_BLK_SIZE / Driver::instance()->blk_sz());
+		Genode::memcpy(Driver::instance()->blk()->tx()->packet_content(p),
+		               dst, Driver::CACHE_BLK_SIZE);
 		Driver::instance()->blk()->tx()->submit_packet(p);
+		Driver::instance()->_writes_in_flight++;
 	} catch(Block::Session::Tx::Source::Packet_alloc_failed) {
 		throw Write_failed(off);
 	}
@@ -51,11 +56,29 @@ struct Main
 	struct Factory : Block::Driver_factory
 	{
 		Server::Entrypoint &ep;
-
-		Factory(Server::Entrypoint &ep) : ep(ep) {}
-
-		Block::Driver *create() { return Driver<Lru_policy>::instance(ep); }
-		void destroy(Block::Driver *driver) { Driver<Lru_policy>::destroy(); }
+		bool                lru; /* use LRU instead of 2Q strategy */
+
+		static bool _lru_configured()
+		{
+			try {
+				return Genode::config()->xml_node().attribute("policy")
+				                                   .has_value("lru");
+			} catch (...) { return false; }
+		}
+
+		Factory(Server::Entrypoint &ep) : ep(ep), lru(_lru_configured()) {}
+
+		Block::Driver *create()
+		{
+			if (lru) return Driver<Lru_policy>::instance(ep);
+			return Driver<Two_queue_policy>::instance(ep);
+		}
+
+		void destroy(Block::Driver *driver)
+		{
+			if (lru) Driver<Lru_policy>::destroy();
+			else     Driver<Two_queue_policy>::destroy();
+		}
 	} factory;
 
 	void resource_handler(unsigned) { }
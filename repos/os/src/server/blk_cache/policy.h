@@ -0,0 +1,125 @@
+/*
+ * \brief  Utilities shared by the cache replacement strategies
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-12
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+#ifndef _POLICY_H_
+#define _POLICY_H_
+
+/* Genode includes */
+#include <util/noncopyable.h>
+
+namespace Cache {
+
+	template <typename> class Dlist;
+
+	struct Queue_tag;
+	struct Dirty_tag;
+
+	/**
+	 * Replacement queue of a strategy
+	 */
+	typedef Dlist<Queue_tag> Queue;
+
+	/**
+	 * Dirty chunks in the order they got dirty
+	 */
+	typedef Dlist<Dirty_tag> Dirty_queue;
+
+	struct Policy_stats;
+}
+
+
+/**
+ * Doubly-linked list with constant-time removal
+ *
+ * In contrast to 'Genode::List', an element can be removed without walking
+ * the list. The 'TAG' parameter allows an object to be member of multiple
+ * lists by inheriting from different element types.
+ */
+template <typename TAG>
+class Cache::Dlist : Genode::Noncopyable
+{
+	public:
+
+		class Element
+		{
+			private:
+
+				friend class Dlist;
+
+				Element *_prev   = nullptr;
+				Element *_next   = nullptr;
+				bool     _linked = false;
+
+			public:
+
+				bool     linked() const { return _linked; }
+				Element *next()   const { return _next;   }
+		};
+
+	private:
+
+		Element      *_first = nullptr;
+		Element      *_last  = nullptr;
+		unsigned long _count = 0;
+
+	public:
+
+		Element      *first() const { return _first; }
+		unsigned long count() const { return _count; }
+
+		/**
+		 * Append element to the end of the list
+		 */
+		void append(Element *e)
+		{
+			e->_prev   = _last;
+			e->_next   = nullptr;
+			e->_linked = true;
+
+			if (_last) _last->_next = e;
+			else       _first       = e;
+
+			_last = e;
+			_count++;
+		}
+
+		/**
+		 * Remove element from the list
+		 */
+		void remove(Element *e)
+		{
+			if (e->_prev) e->_prev->_next = e->_next;
+			else          _first          = e->_next;
+
+			if (e->_next) e->_next->_prev = e->_prev;
+			else          _last           = e->_prev;
+
+			e->_prev   = e->_next = nullptr;
+			e->_linked = false;
+			_count--;
+		}
+};
+
+
+/**
+ * Counters maintained by a replacement strategy
+ */
+struct Cache::Policy_stats
+{
+	unsigned long chunks     = 0; /* chunks currently cached      */
+	unsigned long dirty      = 0; /* chunks not written back yet  */
+	unsigned long evictions  = 0; /* chunks freed by the strategy */
+	unsigned long writebacks = 0; /* chunks written back by the strategy */
+};
+
+#endif /* _POLICY_H_ */
@@ -0,0 +1,170 @@
+/*
+ * \brief  2Q cache replacement strategy
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-12
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+#include "two_queue.h"
+#include "driver.h"
+
+typedef Driver<Two_queue_policy>::Chunk_level_4 Chunk;
+
+enum { CACHE_BLK_SIZE = Driver<Two_queue_policy>::CACHE_BLK_SIZE };
+
+static Cache::Queue        a1in;       /* loaded once, oldest first     */
+static Cache::Queue        am;         /* least recently used first     */
+static Cache::Dirty_queue  dirty_list; /* oldest dirty chunk first      */
+static Cache::Policy_stats tq_stats;
+
+/*
+ * The ghost table is direct mapped, a newer ghost replaces an older one
+ * mapped to the same slot. It stores the offset plus one, so that zero
+ * denotes an empty slot.
+ */
+static Cache::offset_t a1out[Two_queue_policy::GHOST_SLOTS];
+
+
+static Chunk *chunk(Cache::Queue::Element *e) {
+	return static_cast<Chunk*>(static_cast<Two_queue_policy::Element*>(e)); }
+
+
+static Chunk *chunk(Cache::Dirty_queue::Element *e) {
+	return static_cast<Chunk*>(static_cast<Two_queue_policy::Element*>(e)); }
+
+
+static Cache::offset_t &ghost(Cache::offset_t off) {
+	return a1out[(off / CACHE_BLK_SIZE) % Two_queue_policy::GHOST_SLOTS]; }
+
+
+static void access(Two_queue_policy::Element *e, bool &hot)
+{
+	/* repeated reference of a chunk in 'Am' */
+	if (hot) {
+		am.remove(e);
+		am.append(e);
+		return;
+	}
+
+	/* references of chunks in 'A1in' are considered correlated */
+	if (e->Cache::Queue::Element::linked())
+		return;
+
+	/* newly loaded chunk, promote it if recently evicted from 'A1in' */
+	Cache::offset_t const off = static_cast<Chunk*>(e)->base_offset();
+	Cache::offset_t &g = ghost(off);
+	if (g == off + 1) {
+		g   = 0;
+		hot = true;
+		am.append(e);
+	} else
+		a1in.append(e);
+}
+
+
+void Two_queue_policy::read(const Element *e)
+{
+	Element *te = const_cast<Element*>(e);
+	access(te, te->_hot);
+}
+
+
+void Two_queue_policy::write(const Element *e)
+{
+	Element *te = const_cast<Element*>(e);
+	access(te, te->_hot);
+}
+
+
+void Two_queue_policy::dirty(const Element *e)
+{
+	Element *te = const_cast<Element*>(e);
+
+	if (!te->Cache::Dirty_queue::Element::linked())
+		dirty_list.append(te);
+}
+
+
+void Two_queue_policy::clean(const Element *e)
+{
+	Element *te = const_cast<Element*>(e);
+
+	if (te->Cache::Dirty_queue::Element::linked())
+		dirty_list.remove(te);
+}
+
+
+/**
+ * Return first chunk of queue that can be freed without writing it back
+ */
+static Cache::Queue::Element *clean_victim(Cache::Queue &queue)
+{
+	for (Cache::Queue::Element *e = queue.first(); e; e = e->next())
+		if (!static_cast<Two_queue_policy::Element*>(e)
+		     ->Cache::Dirty_queue::Element::linked())
+			return e;
+	return nullptr;
+}
+
+
+void Two_queue_policy::flush(Cache::size_t size)
+{
+	Cache::size_t s = 0;
+	while ((a1in.first() || am.first()) && ((size == 0) || (s < size))) {
+
+		unsigned long const chunks = a1in.count() + am.count();
+
+		/* evict from 'A1in' as long as it exceeds its share */
+		bool const from_a1in = !am.first() ||
+		                       a1in.count() * 100 > chunks * A1IN_PERCENT;
+
+		Cache::Queue &queue = from_a1in ? a1in : am;
+
+		/*
+		 * Prefer clean chunks, dirty ones are written back in the
+		 * background. If there is none, write back the oldest one.
+		 */
+		Cache::Queue::Element *e = clean_victim(queue);
+		if (!e) {
+			e = queue.first();
+			chunk(e)->sync(CACHE_BLK_SIZE, chunk(e)->base_offset());
+		}
+
+		Chunk *cb = chunk(e);
+		queue.remove(e);
+
+		if (from_a1in)
+			ghost(cb->base_offset()) = cb->base_offset() + 1;
+
+		static_cast<Element*>(cb)->_hot = false;
+		cb->free(CACHE_BLK_SIZE, cb->base_offset());
+		tq_stats.evictions++;
+		s += sizeof(Chunk);
+	}
+
+	if (s < size) throw Block::Driver::Request_congestion();
+}
+
+
+void Two_queue_policy::writeback(unsigned long dirty_limit)
+{
+	while (dirty_list.count() > dirty_limit) {
+		Chunk *cb = chunk(dirty_list.first());
+		cb->sync(CACHE_BLK_SIZE, cb->base_offset());
+		tq_stats.writebacks++;
+	}
+}
+
+
+Cache::Policy_stats const &Two_queue_policy::stats()
+{
+	tq_stats.chunks = a1in.count() + am.count();
+	tq_stats.dirty  = dirty_list.count();
+	return tq_stats;
+}
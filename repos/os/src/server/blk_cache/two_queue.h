@@ -0,0 +1,54 @@
+/*
+ * \brief  2Q cache replacement strategy
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-12
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+#include "chunk.h"
+#include "policy.h"
+
+/**
+ * Scan-resistant replacement strategy after Johnson and Shasha
+ *
+ * Newly loaded chunks enter the FIFO queue 'A1in'. When evicted from there,
+ * only their offset is remembered in the ghost table 'A1out'. A chunk that
+ * is loaded again while its ghost is still present has proven to be
+ * referenced repeatedly and enters the LRU queue 'Am'. Thereby, a sequential
+ * scan of the device cycles through 'A1in' only and leaves the hot set in
+ * 'Am' untouched.
+ */
+struct Two_queue_policy
+{
+	class Element : public Cache::Queue::Element,
+	                public Cache::Dirty_queue::Element
+	{
+		private:
+
+			friend struct Two_queue_policy;
+
+			bool _hot = false; /* member of 'Am' */
+	};
+
+	enum {
+		A1IN_PERCENT = 25,     /* share of 'A1in' in the cached chunks */
+		GHOST_SLOTS  = 16384,  /* number of entries of 'A1out'         */
+	};
+
+	static char const *name() { return "2q"; }
+
+	static void read(const Element  *e);
+	static void write(const Element *e);
+	static void dirty(const Element *e);
+	static void clean(const Element *e);
+	static void flush(Cache::size_t size = 0);
+	static void writeback(unsigned long dirty_limit);
+
+	static Cache::Policy_stats const &stats();
+};
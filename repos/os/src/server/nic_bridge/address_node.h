@@ -15,13 +15,14 @@
 #define _ADDRESS_NODE_H_
 
 /* Genode */
-#include <util/avl_tree.h>
 #include <util/list.h>
 #include <nic_session/nic_session.h>
 #include <net/netaddress.h>
 #include <net/ethernet.h>
 #include <net/ipv4.h>
 
+#include <address_table.h>
+
 namespace Net {
 
 	/* Forward declaration */
@@ -30,12 +31,11 @@ namespace Net {
 
 	/**
 	 * An Address_node encapsulates a session-component and can be hold in
-	 * a list and/or avl-tree, whereby the network-address (MAC or IP)
+	 * a list and/or address table, whereby the network-address (MAC or IP)
 	 * acts as a key.
 	 */
 	template <unsigned LEN>
-	class Address_node : public Genode::Avl_node<Address_node<LEN> >,
-	                     public Genode::List<Address_node<LEN> >::Element
+	class Address_node : public Genode::List<Address_node<LEN> >::Element
 	{
 		public:
 
@@ -45,6 +45,9 @@ namespace Net {
 
 			Address            _addr;       /* MAC or IP address  */
 			Session_component *_component;  /* client's component */
+			Address_node      *_table_next = 0;
+
+			friend class Address_table<Address_node>;
 
 		public:
 
@@ -64,35 +67,6 @@ namespace Net {
 
 			Address            addr()      { return _addr;      }
 			Session_component *component() { return _component; }
-
-
-			/************************
-			 ** Avl node interface **
-			 ************************/
-
-			bool higher(Address_node *c)
-			{
-				using namespace Genode;
-
-				return (memcmp(&c->_addr.addr, &_addr.addr,
-				               sizeof(_addr.addr)) > 0);
-			}
-
-			/**
-			 * Find by address
-			 */
-			Address_node *find_by_address(Address addr)
-			{
-				using namespace Genode;
-
-				if (addr == _addr)
-					return this;
-
-				bool side = memcmp(&addr.addr, _addr.addr,
-				                   sizeof(_addr.addr)) > 0;
-				Address_node *c = Avl_node<Address_node>::child(side);
-				return c ? c->find_by_address(addr) : 0;
-			}
 	};
 
 
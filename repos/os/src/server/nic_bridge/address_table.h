@@ -0,0 +1,103 @@
+/*
+ * \brief  Thread-safe hash table of address nodes
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-20
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+#ifndef _ADDRESS_TABLE_H_
+#define _ADDRESS_TABLE_H_
+
+/* Genode */
+#include <base/lock.h>
+#include <base/lock_guard.h>
+
+namespace Net { template <typename> class Address_table; }
+
+
+/**
+ * Lock-guarded hash table, using the network address of a node as key
+ *
+ * Each modification increments the generation of the table, which allows
+ * for caching lookup results, see 'Flow_cache'.
+ */
+template <typename NT>
+class Net::Address_table
+{
+	public:
+
+		typedef typename NT::Address Address;
+
+	private:
+
+		enum { BUCKETS = 256 };
+
+		Genode::Lock _lock;
+		NT          *_buckets[BUCKETS];
+		unsigned     _generation = 0;
+
+		/*
+		 * The low-order bytes of MAC and IPv4 addresses differ the most
+		 * within a local network, so they are weighted the least.
+		 */
+		static unsigned _hash(Address const &addr)
+		{
+			unsigned h = 0;
+			for (unsigned i = 0; i < sizeof(addr.addr); i++)
+				h = h*31 + addr.addr[i];
+			return h % BUCKETS;
+		}
+
+	public:
+
+		Address_table()
+		{
+			for (unsigned i = 0; i < BUCKETS; i++)
+				_buckets[i] = 0;
+		}
+
+		void insert(NT *node)
+		{
+			Genode::Lock::Guard lock_guard(_lock);
+
+			NT *&bucket = _buckets[_hash(node->addr())];
+			node->_table_next = bucket;
+			bucket = node;
+			_generation++;
+		}
+
+		void remove(NT *node)
+		{
+			Genode::Lock::Guard lock_guard(_lock);
+
+			for (NT **n = &_buckets[_hash(node->addr())]; *n; n = &(*n)->_table_next)
+				if (*n == node) {
+					*n = node->_table_next;
+					break;
+				}
+			_generation++;
+		}
+
+		/**
+		 * Find node by address
+		 *
+		 * \return node, or 0 if no node matches
+		 */
+		NT *find(Address const &addr)
+		{
+			for (NT *n = _buckets[_hash(addr)]; n; n = n->_table_next)
+				if (n->addr() == addr)
+					return n;
+			return 0;
+		}
+
+		unsigned generation() const { return _generation; }
+};
+
+#endif /* _ADDRESS_TABLE_H_ */
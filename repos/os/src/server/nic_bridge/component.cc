@@ -41,9 +41,7 @@ bool Session_component::handle_arp(Ethernet_frame *eth, Genode::size_t size)
 		 if (arp->src_ip() == arp->dst_ip())
 			return false;
 
-		Ipv4_address_node *node = vlan().ip_tree()->first();
-		if (node)
-			node = node->find_by_address(arp->dst_ip());
+		Ipv4_address_node *node = lookup_ip(arp->dst_ip());
 		if (!node) {
 			arp->src_mac(_nic.mac());
 		}
@@ -77,9 +75,7 @@ bool Session_component::handle_ip(Ethernet_frame *eth, Genode::size_t size)
 void Session_component::finalize_packet(Ethernet_frame *eth,
                                                     Genode::size_t size)
 {
-	Mac_address_node *node = vlan().mac_tree()->first();
-	if (node)
-		node = node->find_by_address(eth->dst());
+	Mac_address_node *node = lookup_mac(eth->dst());
 	if (node)
 		node->component()->send(eth, size);
 	else {
@@ -93,7 +89,7 @@ void Session_component::finalize_packet(Ethernet_frame *eth,
 void Session_component::_free_ipv4_node()
 {
 	if (_ipv4_node) {
-		vlan().ip_tree()->remove(_ipv4_node);
+		vlan().ip_table()->remove(_ipv4_node);
 		destroy(this->guarded_allocator(), _ipv4_node);
 	}
 }
@@ -107,7 +103,7 @@ void Session_component::set_ipv4_address(Ipv4_packet::Ipv4_address ip_addr)
 	_free_ipv4_node();
 	_ipv4_node = new (this->guarded_allocator())
 		Ipv4_address_node(ip_addr, this);
-	vlan().ip_tree()->insert(_ipv4_node);
+	vlan().ip_table()->insert(_ipv4_node);
 }
 
 
@@ -129,7 +125,7 @@ Session_component::Session_component(Genode::Allocator          *allocator,
   _ipv4_node(0),
   _nic(nic)
 {
-	vlan().mac_tree()->insert(&_mac_node);
+	vlan().mac_table()->insert(&_mac_node);
 	vlan().mac_list()->insert(&_mac_node);
 
 	/* static ip parsing */
@@ -157,7 +153,7 @@ Session_component::Session_component(Genode::Allocator          *allocator,
 
 
 Session_component::~Session_component() {
-	vlan().mac_tree()->remove(&_mac_node);
+	vlan().mac_table()->remove(&_mac_node);
 	vlan().mac_list()->remove(&_mac_node);
 	_free_ipv4_node();
 }
@@ -0,0 +1,70 @@
+/*
+ * \brief  Cache of recent address-table lookups
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-20
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+#ifndef _FLOW_CACHE_H_
+#define _FLOW_CACHE_H_
+
+#include <address_table.h>
+
+namespace Net { template <typename> class Flow_cache; }
+
+
+/**
+ * Direct-mapped cache of address-table lookups of one packet handler
+ *
+ * The entries remember misses too, so that frames to addresses outside
+ * the bridge do not walk the table each time. All entries become stale
+ * as soon as the table changes.
+ */
+template <typename NT>
+class Net::Flow_cache
+{
+	private:
+
+		typedef Address_table<NT>     Table;
+		typedef typename NT::Address Address;
+
+		enum { SIZE = 16 };
+
+		struct Entry
+		{
+			Address  addr;
+			NT      *node       = 0;
+			unsigned generation = 0;
+			bool     valid      = false;
+		};
+
+		Table &_table;
+		Entry  _entries[SIZE];
+
+	public:
+
+		Flow_cache(Table &table) : _table(table) { }
+
+		NT *lookup(Address const &addr)
+		{
+			unsigned const generation = _table.generation();
+
+			Entry &e = _entries[addr.addr[sizeof(addr.addr) - 1] % SIZE];
+			if (e.valid && e.generation == generation && e.addr == addr)
+				return e.node;
+
+			e.addr       = addr;
+			e.node       = _table.find(addr);
+			e.generation = generation;
+			e.valid      = true;
+			return e.node;
+		}
+};
+
+#endif /* _FLOW_CACHE_H_ */
@@ -29,18 +29,27 @@ void Packet_handler::_ready_to_submit(unsigned)
 {
 	/* as long as packets are available, and we can ack them */
 	while (sink()->packet_avail()) {
-		_packet = sink()->get_packet();
-		if (!_packet.valid()) continue;
-		handle_ethernet(sink()->packet_content(_packet), _packet.size());
 
-		if (!sink()->ready_to_ack()) {
+		unsigned const max = Genode::min((unsigned)BATCH, sink()->ack_slots_free());
+		if (!max) {
 			if (verbose)
 				PWRN("ack state FULL");
-			return;
+			break;
 		}
 
-		sink()->acknowledge_packet(_packet);
+		Packet_descriptor packets[BATCH];
+		unsigned          count = 0;
+
+		sink()->get_packets(max, [&] (Packet_descriptor packet) {
+			handle_ethernet(sink()->packet_content(packet), packet.size());
+			packets[count++] = packet;
+		});
+
+		sink()->acknowledge_packets(packets, count);
 	}
+
+	/* hand over the frames forwarded during this burst */
+	_vlan.submit_batches();
 }
 
 
@@ -48,7 +57,28 @@ void Packet_handler::_ready_to_ack(unsigned)
 {
 	/* check for acknowledgements */
 	while (source()->ack_avail())
-		source()->release_packet(source()->get_acked_packet());
+		source()->get_acked_packets(BATCH, [&] (Packet_descriptor packet) {
+			source()->release_packet(packet); });
+}
+
+
+void Packet_handler::_submit_batch()
+{
+	Tx_batch &batch = _tx_batch;
+
+	/* drop what does not fit into the submit queue instead of blocking */
+	unsigned const count = Genode::min(batch.count, source()->submit_slots_free());
+
+	for (unsigned i = count; i < batch.count; i++) {
+		source()->release_packet(batch.packets[i]);
+		if (verbose)
+			PWRN("Packet dropped");
+	}
+
+	if (count)
+		source()->submit_packets(batch.packets, count);
+
+	batch.count = 0;
 }
 
 
@@ -112,12 +142,20 @@ void Packet_handler::handle_ethernet(void* src, Genode::size_t size)
 
 void Packet_handler::send(Ethernet_frame *eth, Genode::size_t size)
 {
+	/* submit the batch early if it is full */
+	if (_tx_batch.count == BATCH) {
+		_vlan.unschedule(_tx_batch);
+		_submit_batch();
+	}
+
 	try {
-		/* copy and submit packet */
+		/* copy packet, it gets submitted with the batch */
 		Packet_descriptor packet  = source()->alloc_packet(size);
 		char             *content = source()->packet_content(packet);
 		Genode::memcpy((void*)content, (void*)eth, size);
-		source()->submit_packet(packet);
+
+		_tx_batch.packets[_tx_batch.count++] = packet;
+		_vlan.schedule(_tx_batch);
 	} catch(Packet_stream_source< ::Nic::Session::Policy>::Packet_alloc_failed) {
 		if (verbose)
 			PWRN("Packet dropped");
@@ -127,6 +165,8 @@ void Packet_handler::send(Ethernet_frame *eth, Genode::size_t size)
 
 Packet_handler::Packet_handler(Server::Entrypoint &ep, Vlan &vlan)
 : _vlan(vlan),
+  _mac_cache(*vlan.mac_table()),
+  _ip_cache(*vlan.ip_table()),
   _sink_ack(ep, *this, &Packet_handler::_ack_avail),
   _sink_submit(ep, *this, &Packet_handler::_ready_to_submit),
   _source_ack(ep, *this, &Packet_handler::_ready_to_ack),
@@ -22,6 +22,7 @@
 #include <net/ethernet.h>
 #include <net/ipv4.h>
 
+#include <flow_cache.h>
 #include <vlan.h>
 
 namespace Net {
@@ -40,8 +41,32 @@ class Net::Packet_handler
 {
 	private:
 
-		Packet_descriptor _packet;
-		Net::Vlan        &_vlan;
+		enum { BATCH = 64 };
+
+		/**
+		 * Frames forwarded to this handler during the current burst
+		 */
+		struct Tx_batch : Vlan::Batch
+		{
+			Packet_handler   &handler;
+			Packet_descriptor packets[BATCH];
+			unsigned          count = 0;
+
+			Tx_batch(Packet_handler &handler) : handler(handler) { }
+
+			void submit() override { handler._submit_batch(); }
+		};
+
+		Net::Vlan &_vlan;
+		Tx_batch   _tx_batch { *this };
+
+		Flow_cache<Mac_address_node>  _mac_cache;
+		Flow_cache<Ipv4_address_node> _ip_cache;
+
+		/**
+		 * Submit frames forwarded to this handler
+		 */
+		void _submit_batch();
 
 		/**
 		 * submit queue not empty anymore
@@ -86,11 +111,25 @@ class Net::Packet_handler
 
 		Packet_handler(Server::Entrypoint&, Vlan&);
 
+		virtual ~Packet_handler() { _vlan.unschedule(_tx_batch); }
+
 		virtual Packet_stream_sink< ::Nic::Session::Policy>   * sink()   = 0;
 		virtual Packet_stream_source< ::Nic::Session::Policy> * source() = 0;
 
 		Net::Vlan & vlan() { return _vlan; }
 
+		/**
+		 * Look up client by MAC address, using the handler's flow cache
+		 */
+		Mac_address_node *lookup_mac(Mac_address_node::Address addr) {
+			return _mac_cache.lookup(addr); }
+
+		/**
+		 * Look up client by IP address, using the handler's flow cache
+		 */
+		Ipv4_address_node *lookup_ip(Ipv4_address_node::Address addr) {
+			return _ip_cache.lookup(addr); }
+
 		/**
 		 * Broadcasts ethernet frame to all clients,
 		 * as long as its really a broadcast packtet.
@@ -104,6 +143,9 @@ class Net::Packet_handler
 		/**
 		 * Send ethernet frame
 		 *
+		 * The frame is copied immediately but submitted at the end of the
+		 * burst of frames currently handled.
+		 *
 		 * \param eth   ethernet frame to send.
 		 * \param size  ethernet frame's size.
 		 */
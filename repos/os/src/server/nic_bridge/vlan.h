@@ -17,7 +17,7 @@
 #define _VLAN_H_
 
 #include <address_node.h>
-#include <avl_safe.h>
+#include <address_table.h>
 #include <list_safe.h>
 
 namespace Net {
@@ -30,23 +30,67 @@ namespace Net {
 	{
 		public:
 
-			typedef Avl_tree_safe<Mac_address_node>  Mac_address_tree;
-			typedef Avl_tree_safe<Ipv4_address_node> Ipv4_address_tree;
+			typedef Address_table<Mac_address_node>  Mac_address_table;
+			typedef Address_table<Ipv4_address_node> Ipv4_address_table;
 			typedef List_safe<Mac_address_node>      Mac_address_list;
 
+			/**
+			 * Packet handler with forwarded frames pending for submission
+			 */
+			struct Batch : Genode::List<Batch>::Element
+			{
+				bool scheduled = false;
+
+				virtual void submit() = 0;
+			};
+
 		private:
 
-			Mac_address_tree  _mac_tree;
-			Mac_address_list  _mac_list;
-			Ipv4_address_tree _ip_tree;
+			Mac_address_table  _mac_table;
+			Mac_address_list   _mac_list;
+			Ipv4_address_table _ip_table;
+
+			Genode::List<Batch> _batches;
 
 		public:
 
 			Vlan() {}
 
-			Mac_address_tree  *mac_tree() { return &_mac_tree; }
-			Mac_address_list  *mac_list() { return &_mac_list; }
-			Ipv4_address_tree *ip_tree()  { return &_ip_tree;  }
+			Mac_address_table  *mac_table() { return &_mac_table; }
+			Mac_address_list   *mac_list()  { return &_mac_list;  }
+			Ipv4_address_table *ip_table()  { return &_ip_table;  }
+
+			/**
+			 * Remember batch to be submitted at the end of the burst
+			 */
+			void schedule(Batch &batch)
+			{
+				if (batch.scheduled)
+					return;
+
+				batch.scheduled = true;
+				_batches.insert(&batch);
+			}
+
+			void unschedule(Batch &batch)
+			{
+				if (!batch.scheduled)
+					return;
+
+				_batches.remove(&batch);
+				batch.scheduled = false;
+			}
+
+			/**
+			 * Submit all scheduled batches
+			 */
+			void submit_batches()
+			{
+				while (Batch *batch = _batches.first()) {
+					unschedule(*batch);
+					batch->submit();
+				}
+			}
 	};
 }
 
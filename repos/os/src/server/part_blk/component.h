@@ -5,7 +5,7 @@
  */
 
 /*
- * Copyright (C) 2013-2015 Genode Labs GmbH
+ * Copyright (C) 2013-2016 Genode Labs GmbH
  *
  * This file is part of the Genode OS framework, which is distributed
  * under the terms of the GNU General Public License version 2.
@@ -61,8 +61,14 @@ class Block::Session_component : public Block::Session_rpc_object,
 		/**
 		 * Range check packet request
 		 */
-		inline bool _range_check(Packet_descriptor &p) {
-			return p.block_number() + p.block_count() <= _partition->sectors; }
+		inline bool _range_check(Packet_descriptor &p)
+		{
+			/* the block range of a flush request is meaningless */
+			if (p.operation() == Packet_descriptor::FLUSH)
+				return true;
+
+			return p.block_number() + p.block_count() <= _partition->sectors;
+		}
 
 		/**
 		 * Handle a single request
@@ -72,18 +78,25 @@ class Block::Session_component : public Block::Session_rpc_object,
 			_p_to_handle = packet;
 			_p_to_handle.succeeded(false);
 
+			Packet_descriptor::Opcode op = _p_to_handle.operation();
+
+			/* requests without payload come without bulk-buffer space */
+			bool const payload = op == Packet_descriptor::READ ||
+			                     op == Packet_descriptor::WRITE;
+
 			/* ignore invalid packets */
-			if (!packet.valid() || !_range_check(_p_to_handle)) {
+			if ((payload && !packet.valid()) || !_range_check(_p_to_handle)) {
 				_ack_packet(_p_to_handle);
 				return;
 			}
 
-			bool write   = _p_to_handle.operation() == Packet_descriptor::WRITE;
-			sector_t off = _p_to_handle.block_number() + _partition->lba;
+			/* a flush request applies to the whole device */
+			sector_t off = op == Packet_descriptor::FLUSH ? 0
+			             : _p_to_handle.block_number() + _partition->lba;
 			size_t cnt   = _p_to_handle.block_count();
 			void* addr   = tx_sink()->packet_content(_p_to_handle);
 			try {
-				Driver::driver().io(write, off, cnt, addr, *this, _p_to_handle);
+				Driver::driver().io(op, off, cnt, addr, *this, _p_to_handle);
 			} catch (Block::Session::Tx::Source::Packet_alloc_failed) {
 				_req_queue_full = true;
 				Session_component::wait_queue().insert(this);
@@ -5,7 +5,7 @@
  */
 
 /*
- * Copyright (C) 2013 Genode Labs GmbH
+ * Copyright (C) 2013-2016 Genode Labs GmbH
  *
  * This file is part of the Genode OS framework, which is distributed
  * under the terms of the GNU General Public License version 2.
@@ -38,7 +38,8 @@ class Block::Block_dispatcher
 bool operator== (const Block::Packet_descriptor& p1,
                  const Block::Packet_descriptor& p2)
 {
-	return p1.operation()    == p2.operation()    &&
+	return p1.offset()       == p2.offset()       &&
+	       p1.operation()    == p2.operation()    &&
 	       p1.block_number() == p2.block_number() &&
 	       p1.block_count()  == p2.block_count();
 }
@@ -63,12 +64,11 @@ class Block::Driver
 			        Packet_descriptor &srv)
 			: _dispatcher(d), _cli(cli), _srv(srv) {}
 
-			bool handle(Packet_descriptor& reply)
-			{
-				bool ret =  reply == _srv;
-				if (ret) _dispatcher.dispatch(_cli, reply);
-				return ret;
-			}
+			bool match(Packet_descriptor const &reply) const {
+				return reply == _srv; }
+
+			void handle(Packet_descriptor &reply) {
+				_dispatcher.dispatch(_cli, reply); }
 	};
 
 	private:
@@ -92,12 +92,22 @@ class Block::Driver
 			/* check for acknowledgements */
 			while (_session.tx()->ack_avail()) {
 				Packet_descriptor p = _session.tx()->get_acked_packet();
-				for (Request *r = _r_list.first(); r; r = r->next()) {
-					if (r->handle(p)) {
-						_r_list.remove(r);
-						Genode::destroy(&_r_slab, r);
-						break;
-					}
+
+				/*
+				 * Requests without payload are indistinguishable if they
+				 * name the same operation and blocks. Complete the oldest
+				 * one, which is the last in the list. For a 'FLUSH', any
+				 * acknowledged one covers the writes preceding the oldest.
+				 */
+				Request *oldest = 0;
+				for (Request *r = _r_list.first(); r; r = r->next())
+					if (r->match(p))
+						oldest = r;
+
+				if (oldest) {
+					oldest->handle(p);
+					_r_list.remove(oldest);
+					Genode::destroy(&_r_slab, oldest);
 				}
 				_session.tx()->release_packet(p);
 			}
@@ -130,17 +140,19 @@ class Block::Driver
 
 		static Driver& driver();
 
-		void io(bool write, sector_t nr, Genode::size_t cnt, void* addr,
-		        Block_dispatcher &dispatcher, Packet_descriptor& cli)
+		void io(Packet_descriptor::Opcode op, sector_t nr, Genode::size_t cnt,
+		        void* addr, Block_dispatcher &dispatcher, Packet_descriptor& cli)
 		{
 			if (!_session.tx()->ready_to_submit())
 				throw Block::Session::Tx::Source::Packet_alloc_failed();
 
-			Block::Packet_descriptor::Opcode op = write
-			    ? Block::Packet_descriptor::WRITE
-			    : Block::Packet_descriptor::READ;
+			bool const write = op == Block::Packet_descriptor::WRITE;
+			bool const data  = write || op == Block::Packet_descriptor::READ;
+
+			/* requests without payload occupy no bulk-buffer space */
 			Genode::size_t size = _blk_size * cnt;
-			Packet_descriptor p(_session.dma_alloc_packet(size),
+			Packet_descriptor p(data ? _session.dma_alloc_packet(size)
+			                         : Packet_descriptor(),
 			                    op,  nr, cnt);
 			Request *r = new (&_r_slab) Request(dispatcher, cli, p);
 			_r_list.insert(r);
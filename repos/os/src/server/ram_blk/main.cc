@@ -85,6 +85,8 @@ class Ram_blk : public Block::Driver
 			Block::Session::Operations o;
 			o.set_operation(Block::Packet_descriptor::READ);
 			o.set_operation(Block::Packet_descriptor::WRITE);
+			o.set_operation(Block::Packet_descriptor::TRIM);
+			o.set_operation(Block::Packet_descriptor::FLUSH);
 			return o;
 		}
 
@@ -103,6 +105,16 @@ class Ram_blk : public Block::Driver
 		{
 			_io(block_number, block_count, const_cast<char *>(buffer), packet, false);
 		}
+
+		/*
+		 * The RAM backing store neither benefits from discarded blocks nor
+		 * has a write cache, hence both requests are completed immediately.
+		 */
+
+		void trim(Block::sector_t, Genode::size_t,
+		          Block::Packet_descriptor &packet) { ack_packet(packet); }
+
+		void flush(Block::Packet_descriptor &packet) { ack_packet(packet); }
 };
 
 
@@ -5,7 +5,7 @@
  */
 
 /*
- * Copyright (C) 2012-2013 Genode Labs GmbH
+ * Copyright (C) 2012-2016 Genode Labs GmbH
  *
  * This file is part of the Genode OS framework, which is distributed
  * under the terms of the GNU General Public License version 2.
@@ -198,13 +198,18 @@ namespace File_system {
 					if (dir->has_sub_node_unsynchronized(name.string()))
 						throw Node_already_exists();
 
+					File *file = 0;
 					try {
-						File * const file = new (env()->heap())
-						                    File(*env()->heap(), name.string());
+						file = new (env()->heap())
+						       File(*env()->heap(), name.string());
 
 						dir->adopt_unsynchronized(file);
 					}
-					catch (Allocator::Out_of_memory) { throw No_space(); }
+					catch (Allocator::Out_of_memory) {
+						if (file)
+							destroy(env()->heap(), file);
+						throw No_space();
+					}
 				}
 
 				File *file = dir->lookup_and_lock_file(name.string());
@@ -228,13 +233,17 @@ namespace File_system {
 					if (dir->has_sub_node_unsynchronized(name.string()))
 						throw Node_already_exists();
 
+					Symlink *symlink = 0;
 					try {
-						Symlink * const symlink = new (env()->heap())
-						                    Symlink(name.string());
+						symlink = new (env()->heap()) Symlink(name.string());
 
 						dir->adopt_unsynchronized(symlink);
 					}
-					catch (Allocator::Out_of_memory) { throw No_space(); }
+					catch (Allocator::Out_of_memory) {
+						if (symlink)
+							destroy(env()->heap(), symlink);
+						throw No_space();
+					}
 				}
 
 				Symlink *symlink = dir->lookup_and_lock_symlink(name.string());
@@ -268,9 +277,14 @@ namespace File_system {
 					if (parent->has_sub_node_unsynchronized(name))
 						throw Node_already_exists();
 
+					Directory *dir = 0;
 					try {
-						parent->adopt_unsynchronized(new (env()->heap()) Directory(name));
+						dir = new (env()->heap()) Directory(*env()->heap(), name);
+
+						parent->adopt_unsynchronized(dir);
 					} catch (Allocator::Out_of_memory) {
+						if (dir)
+							destroy(env()->heap(), dir);
 						throw No_space();
 					}
 				}
@@ -377,14 +391,27 @@ namespace File_system {
 
 				Node *node = from_dir->lookup_and_lock(from_name.string());
 				Node_lock_guard node_guard(node);
-				node->name(to_name.string());
 
+				/*
+				 * The directory index refers to the node by its name. So the
+				 * node is taken out of the directory while being renamed.
+				 * Re-adding it to 'from_dir' cannot fail because removing
+				 * an entry never shrinks the index below the former number
+				 * of entries.
+				 */
 				if (!_handle_registry.refer_to_same_node(from_dir_handle, to_dir_handle)) {
 					Directory *to_dir = _handle_registry.lookup_and_lock(to_dir_handle);
 					Node_lock_guard to_dir_guard(to_dir);
 
 					from_dir->discard_unsynchronized(node);
-					to_dir->adopt_unsynchronized(node);
+					node->name(to_name.string());
+
+					try { to_dir->adopt_unsynchronized(node); }
+					catch (Allocator::Out_of_memory) {
+						node->name(from_name.string());
+						from_dir->adopt_unsynchronized(node);
+						throw Permission_denied();
+					}
 
 					/*
 					 * If the file was moved from one directory to another we
@@ -394,6 +421,10 @@ namespace File_system {
 					 */
 					to_dir->mark_as_updated();
 					to_dir->notify_listeners();
+				} else {
+					from_dir->discard_unsynchronized(node);
+					node->name(to_name.string());
+					from_dir->adopt_unsynchronized(node);
 				}
 
 				from_dir->mark_as_updated();
@@ -580,7 +611,7 @@ static void preload_content(Genode::Allocator      &alloc,
 		 */
 		if (sub_node.has_type("dir")) {
 
-			Directory *sub_dir = new (&alloc) Directory(name);
+			Directory *sub_dir = new (&alloc) Directory(alloc, name);
 
 			/* traverse into the new directory */
 			preload_content(alloc, sub_node, *sub_dir);
@@ -626,7 +657,7 @@ struct File_system::Main
 {
 	Server::Entrypoint &ep;
 
-	Directory root_dir = { "" };
+	Directory root_dir = { *env()->heap(), "" };
 
 	/*
 	 * Initialize root interface
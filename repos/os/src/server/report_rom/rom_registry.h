@@ -5,7 +5,7 @@
  */
 
 /*
- * Copyright (C) 2014 Genode Labs GmbH
+ * Copyright (C) 2014-2016 Genode Labs GmbH
  *
  * This file is part of the Genode OS framework, which is distributed
  * under the terms of the GNU General Public License version 2.
@@ -108,32 +108,44 @@ struct Rom::Registry : Registry_for_reader, Registry_for_writer, Genode::Noncopy
 		}
 
 		/**
-		 * Return report name that corresponds to the given ROM session label
+		 * Return policy that matches the given ROM session label
 		 *
-		 * \throw Registry_for_reader::Lookup_failed
+		 * \throw Session_policy::No_policy_defined
 		 */
-		Module::Name _report_name(Module::Name const &rom_label) const
+		Genode::Session_policy _session_policy(Module::Name const &rom_label) const
 		{
 			using namespace Genode;
 
-			String<Rom::Module::Name::capacity()> report;
-
 			try {
-				Session_policy policy(rom_label);
-				policy.attribute("report").value(&report);
-				return Rom::Module::Name(report.string());
+				return Session_policy(rom_label);
 			} catch (Session_policy::No_policy_defined) {
 				/* FIXME backwards compatibility, remove at next release */
 				try {
 					Xml_node rom_node = config()->xml_node().sub_node("rom");
 					PWRN("parsing legacy <rom> policies");
 
-					Session_policy policy(rom_label, rom_node);
-					policy.attribute("report").value(&report);
-					return Rom::Module::Name(report.string());
-				} catch (Xml_node::Nonexistent_sub_node)    { /* no <rom> node */ }
-				  catch (Session_policy::No_policy_defined) { }
+					return Session_policy(rom_label, rom_node);
+				} catch (Xml_node::Nonexistent_sub_node) { /* no <rom> node */ }
 			}
+			throw Session_policy::No_policy_defined();
+		}
+
+		/**
+		 * Return report name that corresponds to the given ROM session label
+		 *
+		 * \throw Registry_for_reader::Lookup_failed
+		 */
+		Module::Name _report_name(Module::Name const &rom_label) const
+		{
+			using namespace Genode;
+
+			String<Rom::Module::Name::capacity()> report;
+
+			try {
+				Session_policy policy = _session_policy(rom_label);
+				policy.attribute("report").value(&report);
+				return Rom::Module::Name(report.string());
+			} catch (Session_policy::No_policy_defined) { }
 
 			PWRN("no valid policy for label \"%s\"", rom_label.string());
 			throw Root::Invalid_args();
@@ -176,6 +188,15 @@ struct Rom::Registry : Registry_for_reader, Registry_for_writer, Genode::Noncopy
 		{
 			return _release(reader, static_cast<Module &>(module));
 		}
+
+		bool shared(Module::Name const &rom_label) override
+		{
+			try {
+				return _session_policy(rom_label).attribute_value("shared", false);
+			} catch (Genode::Session_policy::No_policy_defined) { }
+
+			return false;
+		}
 };
 
 #endif /* _ROM_REGISTRY_H_ */
@@ -0,0 +1,127 @@
+/*
+ * \brief  Benchmark of the alarm scheduler with many alarms
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-23
+ *
+ * The benchmark schedules 100000 one-shot alarms with pseudo-random
+ * deadlines, reschedules them, discards half of them, and lets the
+ * remaining ones expire in batches. It reports the average cost of each
+ * operation and checks that the alarms trigger in the order of their
+ * deadlines.
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+/* Genode includes */
+#include <base/env.h>
+#include <base/printf.h>
+#include <os/alarm.h>
+#include <timer_session/connection.h>
+
+using namespace Genode;
+
+
+enum { NUM_ALARMS = 100000, MAX_DEADLINE = 1000*1000, HANDLE_STEP = 1000 };
+
+
+class Bench_alarm : public Alarm
+{
+	private:
+
+		static Time     _last_triggered;
+		static unsigned _num_triggered;
+		static bool     _in_order;
+
+	public:
+
+		Time timeout = 0;
+
+		static unsigned num_triggered() { return _num_triggered; }
+		static bool     in_order()      { return _in_order; }
+
+	protected:
+
+		bool on_alarm(unsigned) override
+		{
+			if (timeout < _last_triggered)
+				_in_order = false;
+
+			_last_triggered = timeout;
+			_num_triggered++;
+			return false;
+		}
+};
+
+
+Alarm::Time Bench_alarm::_last_triggered = 0;
+unsigned    Bench_alarm::_num_triggered  = 0;
+bool        Bench_alarm::_in_order       = true;
+
+
+static Alarm::Time random_deadline()
+{
+	static unsigned long seed = 42;
+	seed = seed*1103515245 + 12345;
+	return 1 + (seed >> 8) % MAX_DEADLINE;
+}
+
+
+static void print_cost(char const *operation, unsigned long ms, unsigned num)
+{
+	printf("%-10s %u alarms: %lu ns per alarm\n", operation, num, ms*1000*1000/num);
+}
+
+
+int main(int argc, char **argv)
+{
+	printf("--- alarm scheduler benchmark ---\n");
+
+	static Timer::Connection timer;
+	static Alarm_scheduler   scheduler;
+
+	Bench_alarm *alarms = new (env()->heap()) Bench_alarm[NUM_ALARMS];
+
+	/* insert alarms */
+	unsigned long start = timer.elapsed_ms();
+	for (unsigned i = 0; i < NUM_ALARMS; i++) {
+		alarms[i].timeout = random_deadline();
+		scheduler.schedule_absolute(&alarms[i], alarms[i].timeout);
+	}
+	print_cost("schedule", timer.elapsed_ms() - start, NUM_ALARMS);
+
+	/* move alarms to new deadlines */
+	start = timer.elapsed_ms();
+	for (unsigned i = 0; i < NUM_ALARMS; i++) {
+		alarms[i].timeout = random_deadline();
+		scheduler.schedule_absolute(&alarms[i], alarms[i].timeout);
+	}
+	print_cost("reschedule", timer.elapsed_ms() - start, NUM_ALARMS);
+
+	/* cancel every other alarm */
+	start = timer.elapsed_ms();
+	for (unsigned i = 0; i < NUM_ALARMS; i += 2)
+		scheduler.discard(&alarms[i]);
+	print_cost("discard", timer.elapsed_ms() - start, NUM_ALARMS/2);
+
+	/* let the remaining alarms expire */
+	start = timer.elapsed_ms();
+	for (Alarm::Time now = 0; now <= MAX_DEADLINE + HANDLE_STEP; now += HANDLE_STEP)
+		scheduler.handle(now);
+	print_cost("expire", timer.elapsed_ms() - start, NUM_ALARMS/2);
+
+	bool const ok = Bench_alarm::num_triggered() == NUM_ALARMS/2
+	             && Bench_alarm::in_order()
+	             && !scheduler.next_deadline(0);
+
+	if (!ok)
+		printf("%u alarms triggered%s\n", Bench_alarm::num_triggered(),
+		       Bench_alarm::in_order() ? "" : " out of order");
+
+	printf("--- alarm scheduler benchmark %s ---\n", ok ? "finished" : "failed");
+	return ok ? 0 : -1;
+}
@@ -0,0 +1,203 @@
+/*
+ * \brief  Packets-per-second benchmark of a NIC driver
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-20
+ *
+ * The test sends minimum-sized frames as fast as the NIC session
+ * acknowledges them and counts the frames received meanwhile. Received
+ * frames have to be generated externally, e.g., by flood-pinging the
+ * broadcast address of the TAP device on Linux, or by a loopback peer.
+ *
+ * Configuration options are:
+ *
+ * - 'dst_mac' destination MAC address (default is broadcast)
+ * - 'dst_ip' sends IPv4 frames to the given address instead of raw frames
+ * - 'mode' is "pps" (default) for measuring the packet rate, or "latency"
+ *   for measuring the round-trip time of single frames, which requires a
+ *   peer that returns the frames
+ *
+ *  <config dst_mac="01:02:03:04:05:06" dst_ip="10.0.2.55" mode="latency"/>
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+/* Genode includes */
+#include <base/env.h>
+#include <base/printf.h>
+#include <nic/packet_allocator.h>
+#include <nic/xml_node.h>
+#include <nic_session/connection.h>
+#include <net/ipv4.h>
+#include <os/config.h>
+#include <timer_session/connection.h>
+
+using namespace Genode;
+
+
+enum {
+	FRAME_SIZE  = 60,
+	BATCH       = 64,
+	DURATION_MS = 10000,
+	ROUNDS      = 10000,
+	BUF_SIZE    = Nic::Session::QUEUE_SIZE * Nic::Packet_allocator::DEFAULT_PACKET_SIZE,
+};
+
+
+struct Frame_template
+{
+	char data[FRAME_SIZE];
+
+	Frame_template(Nic::Mac_address src)
+	{
+		using namespace Net;
+
+		memset(data, 0, FRAME_SIZE);
+
+		/* broadcast destination, own source address, local experimental type */
+		memset(data, 0xff, 6);
+		memcpy(data + 6, src.addr, 6);
+		data[12] = 0x88;
+		data[13] = 0xb5;
+
+		try {
+			Nic::Mac_address dst;
+			config()->xml_node().attribute("dst_mac").value(&dst);
+			memcpy(data, dst.addr, 6);
+		} catch (...) { }
+
+		try {
+			char ip[16];
+			config()->xml_node().attribute("dst_ip").value(ip, sizeof(ip));
+			Ipv4_packet::Ipv4_address const dst = Ipv4_packet::ip_from_string(ip);
+
+			/* minimal IPv4 header with an experimental protocol number */
+			char *hdr = data + 14;
+			data[12] = 0x08;
+			data[13] = 0x00;
+			hdr[0]   = 0x45;
+			hdr[3]   = FRAME_SIZE - 14;
+			hdr[8]   = 64;
+			hdr[9]   = (char)253;
+			memcpy(hdr + 16, dst.addr, 4);
+		} catch (...) { }
+	}
+};
+
+
+struct Bench
+{
+	Timer::Connection     timer;
+	Nic::Packet_allocator tx_block_alloc { env()->heap() };
+	Nic::Connection       nic { &tx_block_alloc, BUF_SIZE, BUF_SIZE };
+	Frame_template const  frame { nic.mac_address() };
+
+	void release_acked_packets()
+	{
+		while (nic.tx()->ack_avail())
+			nic.tx()->get_acked_packets(BATCH, [&] (Packet_descriptor p) {
+				nic.tx()->release_packet(p); });
+	}
+
+	Packet_descriptor alloc_frame()
+	{
+		Packet_descriptor p = nic.tx()->alloc_packet(FRAME_SIZE);
+		memcpy(nic.tx()->packet_content(p), frame.data, FRAME_SIZE);
+		return p;
+	}
+
+	void measure_rate()
+	{
+		Genode::uint64_t sent = 0, received = 0;
+
+		unsigned long const start = timer.elapsed_ms();
+		unsigned long       now   = start;
+
+		while (now - start < DURATION_MS) {
+
+			release_acked_packets();
+
+			/* submit next batch */
+			Packet_descriptor packets[BATCH];
+			unsigned const max = min((unsigned)BATCH, nic.tx()->submit_slots_free());
+			unsigned count = 0;
+			for (; count < max; count++) {
+				try {
+					packets[count] = alloc_frame();
+				} catch (Nic::Session::Tx::Source::Packet_alloc_failed) { break; }
+			}
+
+			if (count) {
+				nic.tx()->submit_packets(packets, count);
+				sent += count;
+			} else {
+				/* wait for the NIC session to make progress */
+				nic.tx()->get_acked_packets(BATCH, [&] (Packet_descriptor p) {
+					nic.tx()->release_packet(p); });
+			}
+
+			/* count received frames */
+			while (nic.rx()->packet_avail() && nic.rx()->ack_slots_free()) {
+				unsigned const n = min((unsigned)BATCH, nic.rx()->ack_slots_free());
+				Packet_descriptor acks[BATCH];
+				unsigned acked = 0;
+				nic.rx()->get_packets(n, [&] (Packet_descriptor p) {
+					acks[acked++] = p; });
+				nic.rx()->acknowledge_packets(acks, acked);
+				received += acked;
+			}
+
+			now = timer.elapsed_ms();
+		}
+
+		unsigned long const ms = now - start;
+
+		printf("tx: %llu frames in %lu ms, %llu frames/s\n",
+		       (unsigned long long)sent, ms, (unsigned long long)sent*1000/ms);
+		printf("rx: %llu frames in %lu ms, %llu frames/s\n",
+		       (unsigned long long)received, ms, (unsigned long long)received*1000/ms);
+	}
+
+	void measure_latency()
+	{
+		unsigned long const start = timer.elapsed_ms();
+
+		for (unsigned i = 0; i < ROUNDS; i++) {
+			release_acked_packets();
+			nic.tx()->submit_packet(alloc_frame());
+
+			/* wait for the frame to return */
+			nic.rx()->acknowledge_packet(nic.rx()->get_packet());
+		}
+
+		unsigned long const ms = timer.elapsed_ms() - start;
+
+		printf("latency: %u round trips in %lu ms, %lu us per round trip\n",
+		       (unsigned)ROUNDS, ms, ms*1000/ROUNDS);
+	}
+};
+
+
+int main(int, char **)
+{
+	printf("--- NIC packets-per-second benchmark ---\n");
+
+	static Bench bench;
+
+	char mode[16] = "pps";
+	try {
+		config()->xml_node().attribute("mode").value(mode, sizeof(mode));
+	} catch (...) { }
+
+	if (!strcmp(mode, "latency"))
+		bench.measure_latency();
+	else
+		bench.measure_rate();
+
+	printf("--- benchmark finished ---\n");
+	return 0;
+}
@@ -0,0 +1,108 @@
+/*
+ * \brief  Benchmark of the packet allocator at different buffer occupancies
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-16
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+/* Genode includes */
+#include <base/env.h>
+#include <base/printf.h>
+#include <os/packet_allocator.h>
+#include <timer_session/connection.h>
+
+using namespace Genode;
+
+
+enum {
+	BLOCK_SIZE  = 128,
+	BUFFER_SIZE = 4*1024*1024,
+	BASE        = 0x10000000, /* the allocator never touches the buffer */
+	MAX_PACKETS = BUFFER_SIZE / BLOCK_SIZE,
+	ROUNDS      = 1000000,
+};
+
+
+struct Packet { void *addr; size_t size; };
+
+static Packet packets[MAX_PACKETS];
+
+
+static unsigned random()
+{
+	static unsigned seed = 42;
+	seed = seed * 1103515245 + 12345;
+	return seed >> 16;
+}
+
+
+/**
+ * Packet sizes between 64 and 1600 bytes as seen on a NIC session
+ */
+static size_t random_size() { return 64 + random() % 1537; }
+
+
+static void bench(unsigned percent, Timer::Connection &timer)
+{
+	Packet_allocator alloc(env()->heap(), BLOCK_SIZE);
+	alloc.add_range(BASE, BUFFER_SIZE);
+
+	/* fill buffer up to the requested occupancy */
+	size_t const fill = (size_t)BUFFER_SIZE / 100 * percent;
+	size_t used  = 0;
+	unsigned cnt = 0;
+	while (used < fill) {
+		Packet &p = packets[cnt];
+		p.size = random_size();
+		if (!alloc.alloc(p.size, &p.addr))
+			break;
+		used += align_addr(p.size, 7);
+		cnt++;
+	}
+
+	/* fragment the buffer by freeing and reallocating random packets */
+	unsigned failed = 0;
+	unsigned long const start = timer.elapsed_ms();
+
+	for (unsigned r = 0; r < ROUNDS; r++) {
+		Packet &p = packets[random() % cnt];
+		alloc.free(p.addr, p.size);
+
+		p.size = random_size();
+		while (!alloc.alloc(p.size, &p.addr)) {
+			failed++;
+			p.size /= 2;
+		}
+	}
+
+	unsigned long const ms = max(timer.elapsed_ms() - start, 1UL);
+
+	printf("%u%% occupancy: %u packets: %llu alloc/free pairs/s, "
+	       "%u failed allocations\n", percent, cnt,
+	       (unsigned long long)ROUNDS*1000/ms, failed);
+
+	for (unsigned i = 0; i < cnt; i++)
+		alloc.free(packets[i].addr, packets[i].size);
+	alloc.remove_range(BASE, BUFFER_SIZE);
+}
+
+
+int main(int argc, char **argv)
+{
+	printf("--- packet allocator benchmark ---\n");
+
+	static Timer::Connection timer;
+
+	bench(50, timer);
+	bench(90, timer);
+	bench(99, timer);
+
+	printf("--- finished packet allocator benchmark ---\n");
+	return 0;
+}
@@ -297,6 +297,179 @@ void test_2_flood_submit(Timer::Session *timer, Source *source, Sink *sink)
 }
 
 
+/**
+ * Policy used for the throughput benchmark
+ */
+typedef Genode::Packet_stream_policy<Genode::Packet_descriptor, 64, 64, char>
+        Bench_packet_stream_policy;
+
+
+/**
+ * Thread consuming packets as fast as possible in batches
+ */
+class Bench_sink : private Genode::Thread<STACK_SIZE>,
+                   public  Genode::Packet_stream_sink<Bench_packet_stream_policy>
+{
+	public:
+
+		enum { MAX_BATCH = 64 };
+
+	private:
+
+		unsigned volatile _batch = 1;
+
+		void entry()
+		{
+			Packet_descriptor packets[MAX_BATCH];
+
+			for (;;) {
+				unsigned n = 0;
+				get_packets(_batch, [&] (Packet_descriptor packet) {
+					packets[n++] = packet; });
+
+				acknowledge_packets(packets, n);
+			}
+		}
+
+	public:
+
+		Bench_sink(Genode::Dataspace_capability ds_cap)
+		:
+			Thread("bench_sink"),
+			Packet_stream_sink<Bench_packet_stream_policy>(ds_cap)
+		{
+			start();
+		}
+
+		void batch(unsigned batch) { _batch = batch; }
+};
+
+
+/**
+ * Thread producing packets in batches for a given duration
+ */
+class Bench_source : private Genode::Thread<STACK_SIZE>,
+                     private Genode::Allocator_avl,
+                     public  Genode::Packet_stream_source<Bench_packet_stream_policy>
+{
+	private:
+
+		Timer::Session &_timer;
+		Genode::Lock    _start_lock { Genode::Lock::LOCKED };
+		Genode::Lock    _done_lock  { Genode::Lock::LOCKED };
+		unsigned        _batch = 1;
+
+		unsigned long _packets_per_sec = 0;
+
+		enum { PACKET_SIZE = 64, DURATION_MS = 2000, MAX_IN_FLIGHT = 63 };
+
+		void _measure()
+		{
+			Packet_descriptor packets[Bench_sink::MAX_BATCH];
+
+			unsigned long const start_ms = _timer.elapsed_ms();
+			unsigned long       now_ms   = start_ms;
+			unsigned long       cnt      = 0;
+			unsigned            in_flight = 0;
+
+			for (; now_ms - start_ms < DURATION_MS; now_ms = _timer.elapsed_ms()) {
+
+				/* query the timer only once per 1000 batches */
+				for (unsigned round = 0; round < 1000; round++) {
+
+					for (unsigned i = 0; i < _batch; i++)
+						packets[i] = alloc_packet(PACKET_SIZE);
+
+					submit_packets(packets, _batch);
+					in_flight += _batch;
+
+					/*
+					 * Keep the number of packets in flight within the capacity
+					 * of the submit queue. Otherwise, the source could block
+					 * on a full submit queue while the sink blocks on a full
+					 * ack queue.
+					 */
+					do {
+						unsigned const acked =
+							get_acked_packets(in_flight, [&] (Packet_descriptor packet) {
+								release_packet(packet); });
+
+						in_flight -= acked;
+						cnt       += acked;
+
+					} while (in_flight + _batch > MAX_IN_FLIGHT);
+				}
+			}
+
+			/* collect the remaining acknowledgements */
+			while (in_flight)
+				in_flight -= get_acked_packets(in_flight, [&] (Packet_descriptor packet) {
+					release_packet(packet); });
+
+			_packets_per_sec = (cnt*1000)/(now_ms - start_ms);
+		}
+
+		void entry()
+		{
+			for (;;) {
+				_start_lock.lock();
+				_measure();
+				_done_lock.unlock();
+			}
+		}
+
+	public:
+
+		Bench_source(Genode::Dataspace_capability ds_cap, Timer::Session &timer)
+		:
+			Thread("bench_source"),
+			Genode::Allocator_avl(Genode::env()->heap()),
+			Packet_stream_source<Bench_packet_stream_policy>(this, ds_cap),
+			_timer(timer)
+		{
+			start();
+		}
+
+		/**
+		 * Run measurement with the given batch size
+		 *
+		 * \return packets per second
+		 */
+		unsigned long measure(unsigned batch)
+		{
+			_batch = batch;
+			_start_lock.unlock();
+			_done_lock.lock();
+			return _packets_per_sec;
+		}
+};
+
+
+void test_3_throughput(Timer::Session *timer)
+{
+	using namespace Genode;
+
+	enum { TRANSPORT_DS_SIZE = 64*1024 };
+	Dataspace_capability ds_cap = env()->ram_session()->alloc(TRANSPORT_DS_SIZE);
+
+	/* the sink thread never returns, hence the objects are never destructed */
+	static Bench_source source(ds_cap, *timer);
+	static Bench_sink   sink(ds_cap);
+
+	source.register_sigh_packet_avail(sink.sigh_packet_avail());
+	source.register_sigh_ready_to_ack(sink.sigh_ready_to_ack());
+	sink.register_sigh_ready_to_submit(source.sigh_ready_to_submit());
+	sink.register_sigh_ack_avail(source.sigh_ack_avail());
+
+	unsigned const batch_sizes[] = { 1, 2, 4, 8, 16, 32 };
+
+	for (unsigned batch : batch_sizes) {
+		sink.batch(batch);
+		printf("batch size %2u: %lu packets/s\n", batch, source.measure(batch));
+	}
+}
+
+
 using namespace Genode;
 
 int main(int, char **)
@@ -325,6 +498,9 @@ int main(int, char **)
 	printf("\n-- test 2: flood submit queue, sender blocks, gets woken up  --\n");
 	test_2_flood_submit(&timer, &source, &sink);
 
+	printf("\n-- test 3: throughput depending on the batch size --\n");
+	test_3_throughput(&timer);
+
 	printf("waiting to settle down\n");
 	timer.msleep(2*1000);
 
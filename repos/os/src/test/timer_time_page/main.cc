@@ -0,0 +1,76 @@
+/*
+ * \brief  Test and benchmark of the time page of timer sessions
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-22
+ *
+ * The test compares the costs of reading the time via the 'elapsed_ms' RPC
+ * and via the time page, checks that the time read from the page never
+ * decreases, and that it keeps pace with the time reported by the timer
+ * session.
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+/* Genode includes */
+#include <base/printf.h>
+#include <timer_session/connection.h>
+#include <timer_session/time_page.h>
+
+using namespace Genode;
+
+
+enum { ROUNDS = 100000, CALIBRATION_MS = 3000, TOLERANCE_MS = 20 };
+
+
+int main(int argc, char **argv)
+{
+	printf("--- timer time-page test ---\n");
+
+	static Timer::Connection  timer;
+	static Timer::Time_source time_source(timer);
+
+	/* give the driver the chance to calibrate the time counter */
+	timer.msleep(CALIBRATION_MS);
+
+	printf("time page is %s\n", time_source.precise()
+	       ? "precise" : "updated by the timer driver only");
+
+	/* cost of the RPC */
+	uint64_t start = time_source.elapsed_us();
+	for (unsigned i = 0; i < ROUNDS; i++)
+		timer.elapsed_ms();
+	uint64_t const rpc_ns = (time_source.elapsed_us() - start)*1000/ROUNDS;
+
+	/* cost of reading the page, which must never go backwards */
+	bool ok = true;
+	uint64_t last = start = time_source.elapsed_us();
+	for (unsigned i = 0; i < ROUNDS; i++) {
+		uint64_t const now = time_source.elapsed_us();
+		if (now < last)
+			ok = false;
+		last = now;
+	}
+	uint64_t const page_ns = (last - start)*1000/ROUNDS;
+
+	printf("elapsed_ms RPC: %lu ns, time page: %lu ns%s\n",
+	       (unsigned long)rpc_ns, (unsigned long)page_ns,
+	       ok ? "" : " (time went backwards)");
+
+	/* both time sources must agree */
+	uint64_t const page_ms    = time_source.elapsed_us()/1000;
+	unsigned long const rpc_ms = timer.elapsed_ms();
+	unsigned long const diff   = page_ms > rpc_ms ? page_ms - rpc_ms
+	                                               : rpc_ms - page_ms;
+	if (diff > TOLERANCE_MS) {
+		printf("time page deviates by %lu ms from elapsed_ms\n", diff);
+		ok = false;
+	}
+
+	printf("--- timer time-page test %s ---\n", ok ? "finished" : "failed");
+	return ok ? 0 : -1;
+}
@@ -0,0 +1,3 @@
+TARGET = test-timer_time_page
+SRC_CC = main.cc
+LIBS   = base
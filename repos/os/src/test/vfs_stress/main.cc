@@ -5,7 +5,7 @@
  */
 
 /*
- * Copyright (C) 2015 Genode Labs GmbH
+ * Copyright (C) 2015-2016 Genode Labs GmbH
  *
  * This file is part of the Genode OS framework, which is distributed
  * under the terms of the GNU General Public License version 2.
@@ -30,6 +30,13 @@
  * |\ \ \ \
  * . . . . .
  *
+ * Furthermore, each thread streams a file of 'stream_size' bytes to its
+ * directory and reads it back in records of 'record_size' bytes to measure
+ * the throughput of sequential small-record I/O.
+ *
+ * Finally, a single directory with 'dir_entries' files is created,
+ * enumerated, looked up, and removed to measure the cost of operations on
+ * huge directories.
  */
 
 /* Genode includes */
@@ -406,6 +413,89 @@ struct Read_thread : public Stress_thread
 };
 
 
+struct Stream_thread : public Stress_thread
+{
+	enum Mode { WRITE, READ };
+
+	Mode           const mode;
+	Vfs::file_size const stream_size;
+	Vfs::file_size const record_size;
+
+	Stream_thread(Vfs::File_system &vfs, char const *parent,
+	              Affinity::Location affinity, Mode mode,
+	              Vfs::file_size stream_size, Vfs::file_size record_size)
+	:
+		Stress_thread(vfs, parent, affinity), mode(mode),
+		stream_size(stream_size), record_size(record_size)
+	{ start(); }
+
+	/**
+	 * Fill record with a pattern depending on its file offset
+	 */
+	static void pattern(char *record, Vfs::file_size len, Vfs::file_size offset)
+	{
+		for (Vfs::file_size i = 0; i < len; i++)
+			record[i] = (char)((offset + i) % 251);
+	}
+
+	void entry()
+	{
+		using namespace Vfs;
+
+		path.append("/stream");
+
+		unsigned const open_mode = (mode == WRITE)
+			? Directory_service::OPEN_MODE_WRONLY | Directory_service::OPEN_MODE_CREATE
+			: Directory_service::OPEN_MODE_RDONLY;
+
+		char *expected = (char *)env()->heap()->alloc(record_size);
+		char *record   = (char *)env()->heap()->alloc(record_size);
+
+		try {
+			Vfs_handle *handle = nullptr;
+			assert_open(vfs.open(path.base(), open_mode, &handle));
+			Vfs_handle::Guard guard(handle);
+
+			while (count < stream_size) {
+
+				file_size const len = min(record_size, stream_size - count);
+				file_size n = 0;
+
+				if (mode == WRITE) {
+					pattern(record, len, count);
+					assert_write(handle->fs().write(handle, record, len, n));
+				} else {
+					pattern(expected, len, count);
+					assert_read(handle->fs().read(handle, record, len, n));
+					if (n != len || memcmp(record, expected, len)) {
+						PERR("read returned bad data at offset %llu", count);
+						throw Exception();
+					}
+				}
+
+				if (!n) {
+					PERR("no progress at offset %llu", count);
+					throw Exception();
+				}
+				count += n;
+				handle->advance_seek(n);
+			}
+		} catch (...) {
+			PERR("streaming %s failed after %llu bytes", path.base(), count);
+		}
+
+		env()->heap()->free(record,   record_size);
+		env()->heap()->free(expected, record_size);
+	}
+
+	Vfs::file_size wait()
+	{
+		join();
+		return count;
+	}
+};
+
+
 struct Unlink_thread : public Stress_thread
 {
 	Unlink_thread(Vfs::File_system &vfs, char const *parent, Affinity::Location affinity)
@@ -627,6 +717,134 @@ int main()
 	}
 
 
+	/******************
+	 ** Stream files **
+	 ******************/
+
+	if (config()->xml_node().attribute_value("stream", true)) {
+
+		Vfs::file_size const stream_size =
+			config()->xml_node().attribute_value("stream_size",
+			                                     Number_of_bytes(1024*1024));
+		Vfs::file_size const record_size =
+			config()->xml_node().attribute_value("record_size",
+			                                     Number_of_bytes(512));
+
+		Stream_thread::Mode const modes[] = { Stream_thread::WRITE,
+		                                      Stream_thread::READ };
+
+		for (Stream_thread::Mode mode : modes) {
+
+			Vfs::file_size count = 0;
+			Stream_thread *threads[thread_count];
+			PLOG("%s streams...", mode == Stream_thread::WRITE ? "writing" : "reading");
+			elapsed_ms = timer.elapsed_ms();
+
+			for (size_t i = 0; i < thread_count; ++i) {
+				snprintf(path, 3, "/%zu", i);
+				threads[i] = new (Genode::env()->heap())
+					Stream_thread(vfs_root, path, space.location_of_index(i),
+					              mode, stream_size, record_size);
+			}
+
+			for (size_t i = 0; i < thread_count; ++i) {
+				count += threads[i]->wait();
+				destroy(Genode::env()->heap(), threads[i]);
+			}
+
+			elapsed_ms = timer.elapsed_ms() - elapsed_ms;
+
+			vfs_root.sync("/");
+
+			PINF("%s %llu bytes in %llu-byte records, %llukB/s, %zuKB consumed",
+			     mode == Stream_thread::WRITE ? "streamed" : "read back",
+			     count, record_size, count/(elapsed_ms ? elapsed_ms : 1),
+			     env()->ram_session()->used()/1024);
+		}
+	}
+
+
+	/********************
+	 ** Huge directory **
+	 ********************/
+
+	if (unsigned const entries =
+	    config()->xml_node().attribute_value("dir_entries", 10000U)) {
+
+		typedef Vfs::Directory_service Ds;
+
+		PLOG("populating directory with %u entries...", entries);
+
+		if (vfs_root.mkdir("/huge", 0) != Ds::MKDIR_OK) {
+			PERR("mkdir /huge failed");
+			return -1;
+		}
+
+		unsigned long const create_start = timer.elapsed_ms();
+
+		for (unsigned i = 0; i < entries; i++) {
+			snprintf(path, sizeof(path), "/huge/%u", i);
+
+			Vfs::Vfs_handle *handle = nullptr;
+			if (vfs_root.open(path, Ds::OPEN_MODE_WRONLY | Ds::OPEN_MODE_CREATE,
+			                  &handle) != Ds::OPEN_OK) {
+				PERR("creating %s failed", path);
+				return -1;
+			}
+			Vfs::Vfs_handle::Guard guard(handle);
+		}
+
+		unsigned long const enum_start = timer.elapsed_ms();
+
+		Vfs::file_size const num_dirent = vfs_root.num_dirent("/huge");
+		for (Vfs::file_size i = 0; i < num_dirent; i++) {
+			Ds::Dirent dirent;
+			if (vfs_root.dirent("/huge", i, dirent) != Ds::DIRENT_OK
+			 || dirent.type != Ds::DIRENT_TYPE_FILE) {
+				PERR("bad directory entry %llu", i);
+				return -1;
+			}
+		}
+
+		if (num_dirent != entries) {
+			PERR("directory has %llu instead of %u entries", num_dirent, entries);
+			return -1;
+		}
+
+		unsigned long const lookup_start = timer.elapsed_ms();
+
+		for (unsigned i = 0; i < entries; i++) {
+			snprintf(path, sizeof(path), "/huge/%u", i);
+
+			Ds::Stat stat;
+			if (vfs_root.stat(path, stat) != Ds::STAT_OK) {
+				PERR("stat %s failed", path);
+				return -1;
+			}
+		}
+
+		unsigned long const unlink_start = timer.elapsed_ms();
+
+		for (unsigned i = 0; i < entries; i++) {
+			snprintf(path, sizeof(path), "/huge/%u", i);
+			assert_unlink(vfs_root.unlink(path));
+		}
+		assert_unlink(vfs_root.unlink("/huge"));
+
+		unsigned long const end = timer.elapsed_ms();
+
+		vfs_root.sync("/");
+
+		PINF("huge directory: create %luμs/op, readdir %luμs/entry, "
+		     "lookup %luμs/op, unlink %luμs/op, %zuKB consumed",
+		     (enum_start - create_start)*1000/entries,
+		     (lookup_start - enum_start)*1000/entries,
+		     (unlink_start - lookup_start)*1000/entries,
+		     (end - unlink_start)*1000/entries,
+		     env()->ram_session()->used()/1024);
+	}
+
+
 	/******************
 	 ** Unlink files **
 	 ******************/
@@ -665,6 +883,11 @@ int main()
 		     count, elapsed_ms, env()->ram_session()->used()/1024);
 	}
 
+	Vfs::Lookup_cache::Stats const cache = vfs_root.lookup_cache_stats();
+	PINF("lookup cache: %lu hits, %lu negative hits, %lu misses, "
+	     "%lu evictions, %lu invalidations", cache.hits, cache.negative_hits,
+	     cache.misses, cache.evictions, cache.invalidations);
+
 	PINF("total: %lums, %zuKB consumed",
 	     timer.elapsed_ms(), env()->ram_session()->used()/1024);
 
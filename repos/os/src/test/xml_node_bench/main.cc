@@ -0,0 +1,138 @@
+/*
+ * \brief  Benchmark of sub-node and attribute access of XML nodes
+ * \author Reinier Millo Sánchez <rmillo@uclv.cu>
+ * \date   2016-04-21
+ *
+ * The benchmark generates configs resembling init configurations with up
+ * to 10000 '<start>' nodes and compares the access via 'Xml_node' to the
+ * access via 'Xml_index'. Because accessing all sub nodes of a large node
+ * via 'Xml_node::sub_node(idx)' takes minutes, only a sample of indices is
+ * accessed that way.
+ */
+
+/*
+ * Copyright (C) 2016 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU General Public License version 2.
+ */
+
+/* Genode includes */
+#include <base/env.h>
+#include <base/printf.h>
+#include <base/snprintf.h>
+#include <timer_session/connection.h>
+#include <util/xml_index.h>
+
+using namespace Genode;
+
+
+enum { SAMPLES = 100, ROUNDS = 100, MAX_NODES = 10000, NODE_LEN = 96 };
+
+
+/**
+ * Generate config with 'num' start nodes
+ *
+ * \return length of the config
+ */
+static size_t generate_config(char *dst, size_t dst_len, unsigned num)
+{
+	size_t len = snprintf(dst, dst_len, "<config>\n");
+
+	for (unsigned i = 0; i < num; i++)
+		len += snprintf(dst + len, dst_len - len,
+		                " <start name=\"child%u\" caps=\"%u\">"
+		                "<resource name=\"RAM\" quantum=\"1M\"/></start>\n",
+		                i, i);
+
+	len += snprintf(dst + len, dst_len - len, "</config>");
+	return len;
+}
+
+
+static bool check(unsigned idx, unsigned caps)
+{
+	if (idx == caps)
+		return true;
+
+	PERR("node %u has unexpected caps value %u", idx, caps);
+	return false;
+}
+
+
+static bool bench(Timer::Connection &timer, char const *config, size_t len,
+                  unsigned num)
+{
+	bool ok = true;
+
+	/* parse and walk the config linearly via 'Xml_node' */
+	unsigned long start = timer.elapsed_ms();
+
+	Xml_node const node(config, len);
+
+	unsigned long const parse_ms = timer.elapsed_ms() - start;
+
+	start = timer.elapsed_ms();
+
+	unsigned idx = 0;
+	node.for_each_sub_node("start", [&] (Xml_node const &start_node) {
+		ok &= check(idx++, start_node.attribute_value("caps", 0U)); });
+
+	unsigned long const walk_ms = timer.elapsed_ms() - start;
+
+	/* access sampled sub nodes by index via 'Xml_node' */
+	start = timer.elapsed_ms();
+
+	for (unsigned i = 0; i < SAMPLES; i++) {
+		unsigned const idx = (unsigned long)i*num/SAMPLES;
+		ok &= check(idx, node.sub_node(idx).attribute_value("caps", 0U));
+	}
+
+	unsigned long const node_us = (timer.elapsed_ms() - start)*1000/SAMPLES;
+
+	/* build index */
+	start = timer.elapsed_ms();
+
+	Xml_index const index(*env()->heap(), node);
+
+	unsigned long const index_ms = timer.elapsed_ms() - start;
+
+	/* access all sub nodes by index via 'Xml_index' */
+	start = timer.elapsed_ms();
+
+	Xml_index::Node const indexed = index.node();
+	for (unsigned r = 0; r < ROUNDS; r++)
+		for (unsigned i = 0; i < num; i++)
+			ok &= check(i, indexed.sub_node(i).attribute_value("caps", 0U));
+
+	unsigned long const indexed_ns =
+		(timer.elapsed_ms() - start)*1000*1000/(num*ROUNDS);
+
+	printf("%5u nodes: parse %lu ms, walk %lu ms, index %lu ms, "
+	       "sub_node(idx) %lu us (Xml_node) / %lu ns (Xml_index)\n",
+	       num, parse_ms, walk_ms, index_ms, node_us, indexed_ns);
+
+	return ok;
+}
+
+
+int main(int argc, char **argv)
+{
+	printf("--- Xml_node benchmark ---\n");
+
+	static Timer::Connection timer;
+
+	size_t const buf_len = MAX_NODES*NODE_LEN + 64;
+	char *buf = (char *)env()->heap()->alloc(buf_len);
+
+	bool ok = true;
+	for (unsigned num = 100; num <= MAX_NODES; num *= 10) {
+		size_t const len = generate_config(buf, buf_len, num);
+		ok &= bench(timer, buf, len, num);
+	}
+
+	env()->heap()->free(buf, buf_len);
+
+	printf("--- Xml_node benchmark %s ---\n", ok ? "finished" : "failed");
+	return ok ? 0 : -1;
+}
@@ -0,0 +1,3 @@
+TARGET = test-xml_node_bench
+SRC_CC = main.cc
+LIBS   = base